@@ -0,0 +1,43 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+// Counts heap allocations made through global operator new, so a run can
+// check that a stretch of play never touched the heap. The replacement
+// operators below are real definitions: include this header from exactly
+// one translation unit per program.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long long> g_heapAllocations(0);
+
+inline unsigned long long heapAllocationCount() {
+    return g_heapAllocations.load(std::memory_order_relaxed);
+}
+
+static void* countedAlloc(std::size_t size) {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#endif
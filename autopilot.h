@@ -0,0 +1,156 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+// Plays the game by looking ahead, for unattended soak and balance runs.
+// Each tick choose() tries the six moves open to a player (left, right or
+// stay, each with or without firing): it snapshots the simulation, and on
+// every thread of a pool loads the snapshot into a scratch copy and plays
+// short random continuations ("rollouts") that start with one of the moves.
+// When the tick's time budget is spent it picks the move whose rollouts
+// scored best on average, a lost life costing more than any kill is worth.
+//
+// Rollouts reseed their copy's RNG, so they cannot see the real game's
+// enemy fire coming and have to play the odds. The rollouts are spread
+// over the pool with work stealing (some end early when the player dies),
+// and more cores fit more of them into the same budget, so play gets
+// stronger with core count. With no budget every tick runs the full
+// rollout count, and since the totals are integers the choice, and so the
+// whole game, is the same on any machine and thread count.
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "simulation.h"
+#include "thread_pool.h"
+
+class Autopilot {
+public:
+    static const int ACTIONS = 6;
+
+private:
+    static const int COMMIT_TICKS = 8;     // A rollout holds its first move this long
+    static const int POLICY_TICKS = 8;     // then changes random move this often
+    static const int LIFE_COST = 500;      // Points a lost life is worth
+    static const int CLEAR_BONUS = 200;    // Points for clearing the level
+
+    // Per-thread move totals, padded apart so threads don't share lines
+    struct Tally {
+        long long total[ACTIONS];
+        int count[ACTIONS];
+        char pad[64];
+    };
+
+    ThreadPool& pool;
+    int horizon;                     // Ticks per rollout
+    int maxRollouts;                 // Per tick, when the budget allows
+    std::chrono::nanoseconds budget; // Per tick; zero runs every rollout
+    std::vector<Simulation> scratch; // One per pool thread
+    std::vector<Tally> tallies;
+    std::vector<uint8_t> root;       // The state being decided from
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t salt;
+    int player;
+    long long rolloutsRun;
+    long long decisions;
+
+    static InputBits actionInput(int action) {
+        static const InputBits inputs[ACTIONS] = {
+            INPUT_FIRE, INPUT_LEFT | INPUT_FIRE, INPUT_RIGHT | INPUT_FIRE, 0, INPUT_LEFT, INPUT_RIGHT
+        };
+        return inputs[action];
+    }
+
+    static int livesLeft(const Simulation& sim) {
+        int lives = 0;
+        for (const Player& p : sim.players) lives += p.active ? p.lives : 0;
+        return lives;
+    }
+
+    void rollout(int thread, int task) {
+        if (budget.count() > 0 && std::chrono::steady_clock::now() >= deadline) return;
+
+        Simulation& sim = scratch[thread];
+        sim.loadState(root.data(), root.size());
+        uint64_t seed = salt ^ ((uint64_t)task * 0x9E3779B97F4A7C15ULL);
+        sim.rng.reseed(seed);
+        Rng policy(seed + 1);
+
+        int action = task % ACTIONS;
+        int startScore = sim.score;
+        int startLives = livesLeft(sim);
+        InputBits inputs[MAX_PLAYERS] = {0};
+        for (int t = 0; t < horizon && !sim.gameOver && !sim.victory && !sim.levelTransition; t++) {
+            if (t % POLICY_TICKS == 0) {
+                for (int p = 0; p < (int)sim.players.size(); p++) {
+                    inputs[p] = actionInput(policy.nextInt(ACTIONS));
+                }
+            }
+            if (t < COMMIT_TICKS) inputs[player] = actionInput(action);
+            sim.step(inputs);
+        }
+
+        long long value = sim.score - startScore - (long long)LIFE_COST * (startLives - livesLeft(sim));
+        if (sim.victory) value += CLEAR_BONUS;
+        Tally& tally = tallies[thread];
+        tally.total[action] += value;
+        tally.count[action]++;
+    }
+
+public:
+    // `like` sets the player count; `budgetMs` 0 always runs `rollouts`
+    Autopilot(ThreadPool& threads, const Simulation& like, double budgetMs = 4, int rollouts = 4096,
+              int horizonTicks = 60)
+        : pool(threads), horizon(horizonTicks), maxRollouts(rollouts),
+          budget((long long)(budgetMs * 1e6)), tallies(threads.threadCount()), salt(0), player(0),
+          rolloutsRun(0), decisions(0) {
+        scratch.reserve(threads.threadCount());
+        for (int t = 0; t < threads.threadCount(); t++) {
+            scratch.push_back(Simulation(1, (int)like.players.size()));
+        }
+        root.reserve(like.stateSize() + MAX_FORMATION_SIZE * 64);
+    }
+
+    // The move for `playerIndex` this tick
+    InputBits choose(const Simulation& sim, int playerIndex) {
+        sim.saveState(root);
+        player = playerIndex;
+        salt = sim.rng.rawState() ^ ((uint64_t)sim.frameCount << 32) ^ (uint64_t)playerIndex;
+        deadline = std::chrono::steady_clock::now() + budget;
+        for (Tally& tally : tallies) {
+            std::fill(tally.total, tally.total + ACTIONS, 0LL);
+            std::fill(tally.count, tally.count + ACTIONS, 0);
+        }
+
+        // The rollouts' own ticks would otherwise land in this thread's
+        // phase timings
+        Profiler& profiler = frameProfiler();
+        bool profiling = profiler.isActive();
+        profiler.setActive(false);
+        pool.stealingFor(maxRollouts, [this](int thread, int task) { rollout(thread, task); });
+        profiler.setActive(profiling);
+
+        long long total[ACTIONS] = {0};
+        int count[ACTIONS] = {0};
+        for (const Tally& tally : tallies) {
+            for (int a = 0; a < ACTIONS; a++) {
+                total[a] += tally.total[a];
+                count[a] += tally.count[a];
+            }
+        }
+        // Best mean; compared by cross-multiplying to stay in integers
+        int best = -1;
+        for (int a = 0; a < ACTIONS; a++) {
+            rolloutsRun += count[a];
+            if (count[a] == 0) continue;
+            if (best < 0 || total[a] * count[best] > total[best] * count[a]) best = a;
+        }
+        decisions++;
+        return actionInput(best < 0 ? 0 : best);
+    }
+
+    long long rollouts() const { return rolloutsRun; }
+    double rolloutsPerDecision() const { return decisions > 0 ? (double)rolloutsRun / decisions : 0; }
+    int threadCount() const { return pool.threadCount(); }
+};
+
+#endif
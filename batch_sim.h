@@ -0,0 +1,166 @@
+#ifndef BATCH_SIM_H
+#define BATCH_SIM_H
+
+// Many independent games stepped together, for agents that play the game
+// as an environment. step() advances every instance one tick across a
+// thread pool, and each instance writes its observation straight into its
+// own slice of one caller-owned float buffer (instance i at
+// i * BATCH_OBS_SIZE), so results need no gathering or copying.
+//
+// Instances restart on their own when a game ends (the "done" field says
+// so for that tick) and skip the level intro and level-complete screens,
+// so every tick is play. Each Simulation reserves room for the largest
+// formation up front, so after construction stepping does not allocate.
+
+#include <cstdint>
+#include <vector>
+#include "simulation.h"
+#include "thread_pool.h"
+
+// Observation layout, in floats. Positions are in screen pixels; unused
+// enemy and bullet slots are all zero.
+const int BATCH_OBS_ENEMIES = MAX_FORMATION_SIZE;
+const int BATCH_OBS_BULLETS = 64;       // Nearest the bottom of the screen first
+
+enum {
+    OBS_SCORE,          // Score so far this episode
+    OBS_REWARD,         // Score gained on this tick
+    OBS_LEVEL,
+    OBS_DONE,           // 1 on the tick a game ended (the instance has restarted)
+    OBS_ENEMIES_ALIVE,
+    OBS_BULLET_COUNT,   // Bullets in flight (may exceed BATCH_OBS_BULLETS)
+    OBS_ENEMY_DIRECTION,
+    OBS_RESERVED,
+    OBS_PLAYERS,        // MAX_PLAYERS x (x, y, lives, active)
+    OBS_ENEMIES = OBS_PLAYERS + MAX_PLAYERS * 4,       // x, y, type per enemy
+    OBS_BULLETS = OBS_ENEMIES + BATCH_OBS_ENEMIES * 3, // x, y, +1 player / -1 enemy
+    BATCH_OBS_SIZE = OBS_BULLETS + BATCH_OBS_BULLETS * 3
+};
+
+class BatchSimulator {
+private:
+    std::vector<Simulation> sims;
+    std::vector<long long> instanceEpisodes;   // Finished episodes, per instance
+    int playersPerGame;
+    ThreadPool pool;
+
+    void writeObservation(const Simulation& sim, int reward, bool done, float* obs) const {
+        std::fill(obs, obs + BATCH_OBS_SIZE, 0.0f);
+        obs[OBS_SCORE] = (float)sim.score;
+        obs[OBS_REWARD] = (float)reward;
+        obs[OBS_LEVEL] = (float)sim.level;
+        obs[OBS_DONE] = done ? 1.0f : 0.0f;
+        obs[OBS_ENEMIES_ALIVE] = (float)sim.enemies.aliveCount();
+        obs[OBS_BULLET_COUNT] = (float)sim.bullets.size();
+        obs[OBS_ENEMY_DIRECTION] = coordToFloat(sim.enemyDirection);
+
+        float* p = obs + OBS_PLAYERS;
+        for (const Player& player : sim.players) {
+            p[0] = coordToFloat(player.x);
+            p[1] = coordToFloat(player.y);
+            p[2] = (float)player.lives;
+            p[3] = player.active ? 1.0f : 0.0f;
+            p += 4;
+        }
+
+        float* e = obs + OBS_ENEMIES;
+        float* enemiesEnd = e + BATCH_OBS_ENEMIES * 3;
+        const EnemyFormation& enemies = sim.enemies;
+        enemies.forEachAlive([&](int i) {
+            if (e == enemiesEnd) return;
+            e[0] = coordToFloat(enemies.x[i]);
+            e[1] = coordToFloat(enemies.y[i]);
+            e[2] = (float)enemies.type[i];
+            e += 3;
+        });
+
+        // The pool is unordered; keep the bullets lowest on screen, which
+        // are the ones closest to the players
+        float* b = obs + OBS_BULLETS;
+        int kept = 0;
+        for (const Bullet& bullet : sim.bullets) {
+            int slot = kept;
+            if (kept == BATCH_OBS_BULLETS) {
+                // Replace the highest kept bullet if this one is lower
+                slot = 0;
+                for (int k = 1; k < BATCH_OBS_BULLETS; k++) {
+                    if (b[k * 3 + 1] < b[slot * 3 + 1]) slot = k;
+                }
+                if (coordToFloat(bullet.y) <= b[slot * 3 + 1]) continue;
+            } else {
+                kept++;
+            }
+            b[slot * 3] = coordToFloat(bullet.x);
+            b[slot * 3 + 1] = coordToFloat(bullet.y);
+            b[slot * 3 + 2] = bullet.fromPlayer ? 1.0f : -1.0f;
+        }
+    }
+
+    // One tick of instance i; `actions` holds playersPerGame inputs
+    void stepInstance(int i, const InputBits* actions, float* obs) {
+        Simulation& sim = sims[i];
+        InputBits inputs[MAX_PLAYERS] = {0};
+        for (int p = 0; p < playersPerGame; p++) inputs[p] = actions[p];
+
+        // Overlays only wait for fire; press it for the agent
+        if (sim.levelTransition || sim.victory) inputs[0] |= INPUT_FIRE;
+
+        int scoreBefore = sim.score;
+        sim.step(inputs);
+
+        bool done = sim.gameOver;
+        int reward = sim.score - scoreBefore;
+        if (done) instanceEpisodes[i]++;
+        writeObservation(sim, reward, done, obs);
+        if (done) sim.restart();
+    }
+
+public:
+    // `count` games with `players` players each. Instance i is seeded from
+    // seed + i. `threads` = 0 uses every hardware thread.
+    BatchSimulator(int count, uint64_t seed, int players = 1, int threads = 0)
+        : instanceEpisodes(count, 0),
+          playersPerGame(std::max(1, std::min(players, MAX_PLAYERS))), pool(threads) {
+        sims.reserve(count);
+        for (int i = 0; i < count; i++) {
+            sims.push_back(Simulation(seed + (uint64_t)i, playersPerGame));
+            sims.back().levelTransition = false;
+        }
+    }
+
+    int size() const { return (int)sims.size(); }
+    int playerCount() const { return playersPerGame; }
+    int threadCount() const { return pool.threadCount(); }
+    static int observationSize() { return BATCH_OBS_SIZE; }
+    const Simulation& instance(int i) const { return sims[i]; }
+
+    long long episodesFinished() const {
+        long long total = 0;
+        for (long long episodes : instanceEpisodes) total += episodes;
+        return total;
+    }
+
+    // Observations of the current state without stepping (e.g. after
+    // construction). `observations` holds size() * BATCH_OBS_SIZE floats.
+    void observe(float* observations) {
+        pool.parallelFor(size(), [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                writeObservation(sims[i], 0, false, observations + (size_t)i * BATCH_OBS_SIZE);
+            }
+        });
+    }
+
+    // Advance every instance one tick. `actions` holds size() * playerCount()
+    // inputs (instance-major); `observations` holds size() * BATCH_OBS_SIZE
+    // floats and receives the state after the tick.
+    void step(const InputBits* actions, float* observations) {
+        pool.parallelFor(size(), [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                stepInstance(i, actions + (size_t)i * playersPerGame,
+                             observations + (size_t)i * BATCH_OBS_SIZE);
+            }
+        });
+    }
+};
+
+#endif
@@ -0,0 +1,492 @@
+// Benchmarks for the game: each simulation phase on its own, then whole
+// frames stepped headless, rendered offscreen with SDL's software renderer
+// and rasterized on the CPU with SoftRaster, at 1x, 10x and 100x the
+// largest formation a level builds. Results are written as JSON (ns per
+// operation, frames per second, heap allocations per operation) so runs can
+// be compared between releases.
+//
+//   ./space_invaders_bench [--out FILE] [--seed N] [--quick]
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include "simulation.h"
+#include "event_log.h"
+#include "particle_system.h"
+#include "game_renderer.h"
+#include "sdl_backend.h"
+#include "soft_raster.h"
+#include "alloc_counter.h"
+using namespace std;
+
+const int BASE_ENEMY_COUNT = MAX_FORMATION_SIZE;
+const int SCALES[] = {1, 10, 100};
+
+struct BenchResult {
+    string name;
+    string variant;          // Pattern name, or empty
+    int scale;
+    int entities;            // Enemies plus bullets at the start of a round
+    long long ops;
+    double nsPerOp;
+    double allocsPerOp;
+    double drawCallsPerOp;   // Render scenarios only, otherwise < 0
+};
+
+struct Measurement {
+    long long ops;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+// Run setup() then `opsPerRound` calls of op(), `rounds` times. Only the
+// op() calls are timed and have their heap allocations counted.
+template <typename Setup, typename Op>
+Measurement measure(int rounds, int opsPerRound, Setup setup, Op op) {
+    double ns = 0;
+    unsigned long long allocations = 0;
+    for (int r = 0; r < rounds; r++) {
+        setup();
+        unsigned long long allocationsBefore = heapAllocationCount();
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < opsPerRound; i++) {
+            op(i);
+        }
+        auto end = chrono::steady_clock::now();
+        allocations += heapAllocationCount() - allocationsBefore;
+        ns += chrono::duration<double, nano>(end - start).count();
+    }
+    Measurement m;
+    m.ops = (long long)rounds * opsPerRound;
+    m.nsPerOp = ns / m.ops;
+    m.allocsPerOp = (double)allocations / m.ops;
+    return m;
+}
+
+// Fill `sim` with `count` enemies in rows over the top of the screen,
+// squeezing the spacing as the count grows so all of them stay in play
+void buildStressFormation(Simulation& sim, int count) {
+    sim.enemies.clear();
+    int cols = max(1, (int)lround(12 * sqrt((double)count / BASE_ENEMY_COUNT)));
+    int rows = (count + cols - 1) / cols;
+    for (int i = 0; i < count; i++) {
+        int col = i % cols, row = i / cols;
+        int x = 50 + min(col * ENEMY_SPACING_X, col * (SCREEN_WIDTH - 100 - ENEMY_WIDTH) / max(1, cols - 1));
+        int y = 50 + min(row * ENEMY_SPACING_Y, row * 320 / rows);
+        sim.enemies.add(x, y, row % 4);
+    }
+    sim.formationChanged();
+    sim.enemyDirection = 1;
+    sim.levelTransition = false;
+    sim.gameOver = false;
+    sim.victory = false;
+}
+
+// Scatter `count` bullets over the screen, alternating player and enemy shots
+void spawnStressBullets(Simulation& sim, int count, Rng& rng) {
+    sim.bullets.clear();
+    for (int i = 0; i < count; i++) {
+        int x = rng.nextInt(SCREEN_WIDTH - BULLET_WIDTH);
+        int y = rng.nextInt(SCREEN_HEIGHT - BULLET_HEIGHT);
+        sim.bullets.spawn(x, y, (i & 1) == 0);
+    }
+}
+
+// Players that cannot die, so a frame benchmark measures play rather than
+// the game-over screen
+void makePlayersImmortal(Simulation& sim) {
+    for (auto& player : sim.players) {
+        player.active = true;
+        player.lives = 1 << 30;
+    }
+}
+
+// Same scripted input as the headless game run
+InputBits benchInput(long long tick, int playerIndex) {
+    tick += playerIndex * 60;
+    InputBits input = ((tick / 120) & 1) ? INPUT_LEFT : INPUT_RIGHT;
+    if (tick % 8 == 0) input |= INPUT_FIRE;
+    return input;
+}
+
+const char* simdName() {
+#if defined(SI_SIMD_AVX2)
+    return "avx2";
+#elif defined(SI_SIMD_SSE2)
+    return "sse2";
+#elif defined(SI_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+class BenchSuite {
+private:
+    uint64_t seed;
+    int roundScale;   // Divides round counts for --quick
+    vector<BenchResult> results;
+
+    void record(const string& name, const string& variant, int scale, int entities,
+                const Measurement& m, double drawCallsPerOp = -1) {
+        BenchResult r;
+        r.name = name;
+        r.variant = variant;
+        r.scale = scale;
+        r.entities = entities;
+        r.ops = m.ops;
+        r.nsPerOp = m.nsPerOp;
+        r.allocsPerOp = m.allocsPerOp;
+        r.drawCallsPerOp = drawCallsPerOp;
+        results.push_back(r);
+        cerr << "  " << name << (variant.empty() ? "" : " " + variant) << " x" << scale
+             << ": " << m.nsPerOp << " ns/op, " << m.allocsPerOp << " allocs/op" << endl;
+    }
+
+    int rounds(int full) const { return max(1, full / roundScale); }
+
+public:
+    BenchSuite(uint64_t benchSeed, bool quick) : seed(benchSeed), roundScale(quick ? 10 : 1) {}
+
+    void runInitEnemies() {
+        Simulation sim(seed);
+        const Pattern patterns[] = {PATTERN_CLASSIC, PATTERN_DIAMOND, PATTERN_V_SHAPE,
+                                    PATTERN_CIRCLE, PATTERN_WAVE};
+        for (Pattern pattern : patterns) {
+            sim.level = pattern == PATTERN_CLASSIC ? 5 : (int)pattern;  // level % 5 picks the pattern
+            sim.initEnemies();  // Warm up the formation's storage
+            Measurement m = measure(rounds(100), 100, [](){}, [&](int) { sim.initEnemies(); });
+            record("initEnemies", patternName(pattern), 1, sim.enemies.size(), m);
+        }
+    }
+
+    void runUpdateEnemies(int scale) {
+        int count = BASE_ENEMY_COUNT * scale;
+        Simulation sim(seed, 1, DEFAULT_BULLET_CAPACITY * scale);
+        Measurement m = measure(rounds(200), 100,
+            [&]() { buildStressFormation(sim, count); },
+            [&](int) { sim.updateEnemies(); });
+        record("updateEnemies", "", scale, count, m);
+    }
+
+    void runUpdateBullets(int scale) {
+        int count = DEFAULT_BULLET_CAPACITY / 2 * scale;
+        Simulation sim(seed, 1, DEFAULT_BULLET_CAPACITY * scale);
+        Rng rng(seed);
+        Measurement m = measure(rounds(200), 20,
+            [&]() { spawnStressBullets(sim, count, rng); },
+            [&](int) { sim.updateBullets(); });
+        record("updateBullets", "", scale, count, m);
+    }
+
+    void runCheckCollisions(int scale) {
+        int enemyCount = BASE_ENEMY_COUNT * scale;
+        int bulletCount = DEFAULT_BULLET_CAPACITY / 2 * scale;
+        Simulation sim(seed, 1, DEFAULT_BULLET_CAPACITY * scale);
+        Rng rng(seed);
+        Measurement m = measure(rounds(500), 1,
+            [&]() {
+                buildStressFormation(sim, enemyCount);
+                spawnStressBullets(sim, bulletCount, rng);
+                makePlayersImmortal(sim);
+            },
+            [&](int) { sim.checkCollisions(); });
+        record("checkCollisions", "", scale, enemyCount + bulletCount, m);
+    }
+
+    // Snapshot save/load/hash of a mid-game state (a level in progress
+    // with bullets in flight)
+    // One event logged from the game thread, with the writer draining to a
+    // scratch file. Rounds are spaced out so the ring never fills, as in
+    // play, where a tick logs a handful at most.
+    void runEventLog() {
+        const char* path = "space_invaders_bench.siev";
+        EventLog log;
+        if (!log.open(path)) return;
+        GameEvent event = {0, EVENT_KILL, EVENT_NO_PLAYER, 1, PATTERN_CLASSIC, 1, 100, 200, 30};
+        Measurement m = measure(rounds(100), 1000,
+            [&]() { this_thread::sleep_for(chrono::milliseconds(2)); },
+            [&](int i) {
+                event.tick = (uint32_t)i;
+                log.record(event);
+            });
+        log.close();
+        remove(path);
+        record("eventLog_record", "", 1, 1, m);
+    }
+
+    // A full particle budget: one frame's integration and compaction, then
+    // culling and building the quads (the atlas is never built, so nothing
+    // is rasterized). Frames are 1 ms so almost every particle lives through
+    // the round; the budget is refilled with explosions before each.
+    void runParticles() {
+        ParticleSystem particles;
+        SpriteAtlas sprites;
+        SoftRaster unused;
+        Rng rng(seed);
+        auto refill = [&]() {
+            particles.clear();
+            GameEvent event = {0, EVENT_PLAYER_HIT, 0, 0, PATTERN_CLASSIC, 1, 0, 0, 2};
+            while (particles.size() < particles.budget()) {
+                event.x = (int16_t)rng.nextInt(SCREEN_WIDTH - PLAYER_WIDTH);
+                event.y = (int16_t)rng.nextInt(SCREEN_HEIGHT - PLAYER_HEIGHT);
+                particles.spawn(event);
+            }
+        };
+        Measurement m = measure(rounds(20), 10, refill, [&](int) { particles.update(0.001f); });
+        record("particles_update", "", 1, particles.budget(), m);
+        m = measure(rounds(20), 10, refill, [&](int) {
+            particles.draw(sprites, unused);
+        });
+        record("particles_draw", "", 1, particles.budget(), m);
+    }
+
+    void runSnapshots() {
+        Simulation sim(seed);
+        for (long long tick = 0; tick < 600; tick++) sim.step(benchInput(tick, 0));
+        vector<uint8_t> blob;
+        sim.saveState(blob);
+        int entities = sim.enemies.aliveCount() + sim.bullets.size();
+
+        Measurement m = measure(rounds(100), 100, [](){}, [&](int) { sim.saveState(blob); });
+        record("saveState", "", 1, entities, m);
+        m = measure(rounds(100), 100, [](){}, [&](int) { sim.loadState(blob); });
+        record("loadState", "", 1, entities, m);
+        volatile uint64_t sink = 0;
+        m = measure(rounds(100), 100, [](){}, [&](int) { sink = sink + sim.stateHash(); });
+        record("stateHash", "", 1, entities, m);
+    }
+
+    // Whole sim ticks through step(), as the game runs them
+    void runHeadlessFrames(int scale) {
+        int count = BASE_ENEMY_COUNT * scale;
+        Simulation sim(seed, 1, DEFAULT_BULLET_CAPACITY * scale);
+        long long tick = 0;
+        Measurement m = measure(rounds(50), 240,
+            [&]() {
+                buildStressFormation(sim, count);
+                sim.bullets.clear();
+                makePlayersImmortal(sim);
+            },
+            [&](int) { sim.step(benchInput(tick++, 0)); });
+        record("frame_headless", "", scale, count, m);
+    }
+
+    // Step and draw into a software renderer; false if SDL could not set one up
+    bool runRenderedFrames(int scale) {
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+                                                              SDL_PIXELFORMAT_RGBA32);
+        SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+        if (!renderer) {
+            cerr << "  Offscreen renderer unavailable: " << SDL_GetError() << endl;
+            if (surface) SDL_FreeSurface(surface);
+            return false;
+        }
+
+        TTF_Font* font = openSystemFont(24);
+        TTF_Font* largeFont = openSystemFont(48);
+        SdlBackend backend(renderer);
+        GameRenderer view;
+        view.init(&backend, font, largeFont);
+
+        int count = BASE_ENEMY_COUNT * scale;
+        Simulation sim(seed, 1, DEFAULT_BULLET_CAPACITY * scale);
+        FrameSnapshot frame;
+        long long tick = 0;
+        long long drawCalls = 0;
+        frame.capture(sim, tick);
+        view.drawFrame(frame, 1.0f);  // Warm up the batches
+        Measurement m = measure(rounds(10), 120,
+            [&]() {
+                buildStressFormation(sim, count);
+                sim.bullets.clear();
+                makePlayersImmortal(sim);
+            },
+            [&](int) {
+                sim.step(benchInput(tick++, 0));
+                frame.capture(sim, tick);
+                drawCalls += view.drawFrame(frame, 1.0f);
+                SDL_RenderPresent(renderer);
+            });
+        record("frame_render", "", scale, count, m, (double)drawCalls / m.ops);
+
+        // The CPU rasterizer must draw the same pixels, overlays included
+        long long mismatched = rasterMismatches(view, backend, renderer, surface, frame);
+        frame.levelTransition = true;
+        mismatched += rasterMismatches(view, backend, renderer, surface, frame);
+        frame.levelTransition = false;
+        frame.gameOver = true;
+        mismatched += rasterMismatches(view, backend, renderer, surface, frame);
+        cerr << "  SoftRaster vs software renderer x" << scale << ": "
+             << mismatched << " mismatched pixels in 3 frames" << endl;
+
+        view.destroy();
+        if (largeFont) TTF_CloseFont(largeFont);
+        if (font) TTF_CloseFont(font);
+        SDL_DestroyRenderer(renderer);
+        SDL_FreeSurface(surface);
+        return true;
+    }
+
+    // Draw `frame` with SDL into `surface` and with SoftRaster into a
+    // buffer of the same format, and count the pixels that differ
+    long long rasterMismatches(GameRenderer& view, SdlBackend& backend, SDL_Renderer* renderer,
+                               SDL_Surface* surface, const FrameSnapshot& frame) {
+        view.drawFrame(frame, 1.0f);
+        SDL_RenderPresent(renderer);
+
+        vector<uint8_t> pixels(SoftRaster::bufferSize(SCREEN_WIDTH, SCREEN_HEIGHT, RASTER_RGBA32));
+        SoftRaster raster(pixels.data(), SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_WIDTH * 4, RASTER_RGBA32);
+        view.setBackend(&raster);
+        view.drawFrame(frame, 1.0f);
+        view.setBackend(&backend);
+
+        long long mismatched = 0;
+        SDL_LockSurface(surface);
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            const uint8_t* sdlRow = (const uint8_t*)surface->pixels + (size_t)y * surface->pitch;
+            const uint8_t* rasterRow = pixels.data() + (size_t)y * SCREEN_WIDTH * 4;
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                if (memcmp(sdlRow + x * 4, rasterRow + x * 4, 4) != 0) mismatched++;
+            }
+        }
+        SDL_UnlockSurface(surface);
+        return mismatched;
+    }
+
+    // Step and rasterize on the CPU, in RGBA, in grayscale, and in
+    // grayscale box-filtered down to a 100x75 observation
+    void runRasterFrames(int scale) {
+        TTF_Font* font = openSystemFont(24);
+        TTF_Font* largeFont = openSystemFont(48);
+        GameRenderer view;
+        view.init(nullptr, font, largeFont);
+
+        int count = BASE_ENEMY_COUNT * scale;
+        vector<uint8_t> pixels(SoftRaster::bufferSize(SCREEN_WIDTH, SCREEN_HEIGHT, RASTER_RGBA32));
+        vector<uint8_t> observation(100 * 75);
+        const char* variants[3] = {"rgba", "gray", "gray_100x75"};
+
+        for (int v = 0; v < 3; v++) {
+            RasterFormat format = v == 0 ? RASTER_RGBA32 : RASTER_GRAY8;
+            int pitch = format == RASTER_RGBA32 ? SCREEN_WIDTH * 4 : SCREEN_WIDTH;
+            SoftRaster raster(pixels.data(), SCREEN_WIDTH, SCREEN_HEIGHT, pitch, format);
+            view.setBackend(&raster);
+
+            Simulation sim(seed, 1, DEFAULT_BULLET_CAPACITY * scale);
+            FrameSnapshot frame;
+            long long tick = 0;
+            frame.capture(sim, tick);
+            view.drawFrame(frame, 1.0f);  // Warm up the batches
+            raster.downsample(observation.data(), 100, 75);
+            Measurement m = measure(rounds(10), 120,
+                [&]() {
+                    buildStressFormation(sim, count);
+                    sim.bullets.clear();
+                    makePlayersImmortal(sim);
+                },
+                [&](int) {
+                    sim.step(benchInput(tick++, 0));
+                    frame.capture(sim, tick);
+                    view.drawFrame(frame, 1.0f);
+                    if (v == 2) raster.downsample(observation.data(), 100, 75);
+                });
+            record("frame_raster", variants[v], scale, count, m);
+        }
+
+        view.destroy();
+        if (largeFont) TTF_CloseFont(largeFont);
+        if (font) TTF_CloseFont(font);
+    }
+
+    void run() {
+        cerr << "Simulation phases" << endl;
+        runInitEnemies();
+        for (int scale : SCALES) runUpdateEnemies(scale);
+        for (int scale : SCALES) runUpdateBullets(scale);
+        for (int scale : SCALES) runCheckCollisions(scale);
+        runSnapshots();
+        runEventLog();
+        runParticles();
+
+        cerr << "Frames" << endl;
+        for (int scale : SCALES) runHeadlessFrames(scale);
+        bool ttf = TTF_Init() == 0;
+        for (int scale : SCALES) runRasterFrames(scale);
+        for (int scale : SCALES) {
+            if (!runRenderedFrames(scale)) break;
+        }
+        if (ttf) TTF_Quit();
+    }
+
+    void writeJson(ostream& out) const {
+        out << "{\n";
+        out << "  \"suite\": \"space_invaders\",\n";
+        out << "  \"seed\": " << seed << ",\n";
+        out << "  \"simd\": \"" << simdName() << "\",\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            out << "    {\"name\": \"" << r.name << "\"";
+            if (!r.variant.empty()) out << ", \"variant\": \"" << r.variant << "\"";
+            out << ", \"scale\": " << r.scale
+                << ", \"entities\": " << r.entities
+                << ", \"ops\": " << r.ops
+                << ", \"ns_per_op\": " << r.nsPerOp
+                << ", \"allocs_per_op\": " << r.allocsPerOp;
+            if (r.name.compare(0, 6, "frame_") == 0) {
+                out << ", \"frames_per_second\": " << (r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0);
+            }
+            if (r.drawCallsPerOp >= 0) {
+                out << ", \"draw_calls_per_frame\": " << r.drawCallsPerOp;
+            }
+            out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+};
+
+int main(int argc, char* argv[]) {
+    const char* outPath = nullptr;
+    uint64_t seed = 1;
+    bool quick = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            cerr << "Usage: " << argv[0] << " [--out FILE] [--seed N] [--quick]" << endl;
+            return 1;
+        }
+    }
+
+    BenchSuite suite(seed, quick);
+    suite.run();
+
+    if (outPath) {
+        ofstream out(outPath);
+        if (!out) {
+            cerr << "Cannot write " << outPath << endl;
+            return 1;
+        }
+        suite.writeJson(out);
+        cerr << "Results written to " << outPath << endl;
+    } else {
+        suite.writeJson(cout);
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+// Uniform grid broadphase for collision checks. Entities are bucketed by the
+// grid cells their bounding box overlaps; a query visits only the entities
+// in the cells the query box overlaps. The grid is rebuilt every tick with a
+// counting sort, which is O(entities) and reuses its buffers, so it does not
+// allocate once warmed up.
+//
+// Boxes outside the grid are clamped into the border cells. Clamping keeps
+// overlapping boxes in shared cells, so queries stay exact for anything
+// on or off screen.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "fixed_point.h"
+
+class UniformGrid {
+private:
+    struct Item {
+        int index;
+        short cx0, cy0, cx1, cy1;   // Inclusive cell range covered
+    };
+
+    Coord originX, originY;
+    int cellSize;
+    float invCellSize;
+    int64_t cellScale;              // 2^32 / cell size in Fixed units, rounded up
+    int cols, rows;
+
+    std::vector<Item> items;        // Inserted since the last clear()
+    std::vector<int> cellStart;     // cols * rows + 1 offsets into entries
+    std::vector<int> entries;       // Entity indices, grouped by cell
+
+    // Cell of an offset from the origin, before clamping, which takes care
+    // of negatives. The fixed version multiplies rather than divides; it
+    // may round differently at a cell's edge, but the same way for every
+    // box, which is all the grid needs.
+#ifdef SI_FIXED_POINT
+    int cellOf(Coord offset) const { return (int)(((int64_t)offset.raw * cellScale) >> 32); }
+#else
+    int cellOf(float offset) const { return (int)(offset * invCellSize); }
+#endif
+
+    int cellX(Coord x) const {
+        int c = cellOf(x - originX);
+        return c < 0 ? 0 : (c >= cols ? cols - 1 : c);
+    }
+
+    int cellY(Coord y) const {
+        int c = cellOf(y - originY);
+        return c < 0 ? 0 : (c >= rows ? rows - 1 : c);
+    }
+
+public:
+    UniformGrid(int x, int y, int width, int height, int cellPixels)
+        : originX(x), originY(y), cellSize(cellPixels), invCellSize(1.0f / cellPixels),
+          cellScale((((int64_t)1 << 32) + cellPixels * Fixed::ONE - 1) / (cellPixels * Fixed::ONE)) {
+        cols = width / cellSize + 1;
+        rows = height / cellSize + 1;
+        cellStart.assign(cols * rows + 1, 0);
+    }
+
+    // Preallocate for up to maxItems boxes covering maxEntries cells in total
+    void reserve(int maxItems, int maxEntries) {
+        items.reserve(maxItems);
+        entries.reserve(maxEntries);
+    }
+
+    void clear() {
+        items.clear();
+    }
+
+    void insert(int index, Coord x, Coord y, int w, int h) {
+        Item item;
+        item.index = index;
+        item.cx0 = (short)cellX(x);
+        item.cy0 = (short)cellY(y);
+        item.cx1 = (short)cellX(x + w);
+        item.cy1 = (short)cellY(y + h);
+        items.push_back(item);
+    }
+
+    // Sort everything inserted since clear() into cells
+    void build() {
+        const int cellCount = cols * rows;
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+
+        // Count entries per cell, then turn counts into each cell's end offset
+        for (const Item& item : items) {
+            for (int cy = item.cy0; cy <= item.cy1; cy++) {
+                for (int cx = item.cx0; cx <= item.cx1; cx++) {
+                    cellStart[cy * cols + cx]++;
+                }
+            }
+        }
+        for (int c = 1; c < cellCount; c++) {
+            cellStart[c] += cellStart[c - 1];
+        }
+        int total = cellStart[cellCount - 1];
+        cellStart[cellCount] = total;
+
+        // Scatter back to front; each cell's offset walks down to its start
+        entries.resize(total);
+        for (size_t i = items.size(); i-- > 0; ) {
+            const Item& item = items[i];
+            for (int cy = item.cy0; cy <= item.cy1; cy++) {
+                for (int cx = item.cx0; cx <= item.cx1; cx++) {
+                    entries[--cellStart[cy * cols + cx]] = item.index;
+                }
+            }
+        }
+    }
+
+    int size() const { return (int)items.size(); }
+
+    // Call visit(index) for every entity sharing a cell with the box. An
+    // entity spanning several cells may be visited more than once.
+    template <typename Visitor>
+    void query(Coord x, Coord y, int w, int h, Visitor visit) const {
+        int cx0 = cellX(x), cx1 = cellX(x + w);
+        int cy0 = cellY(y), cy1 = cellY(y + h);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                int cell = cy * cols + cx;
+                for (int e = cellStart[cell]; e < cellStart[cell + 1]; e++) {
+                    visit(entries[e]);
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef BULLET_POOL_H
+#define BULLET_POOL_H
+
+// Fixed-capacity bullet storage. All memory is allocated up front; spawning
+// and removing bullets never touches the heap.
+//
+// Live bullets are packed densely at the front of one array, so updates and
+// collision checks iterate them like a plain vector (range-for works).
+// Removal swaps the last bullet into the hole, which is O(1) but reorders.
+// Code that needs to refer to one particular bullet across ticks holds a
+// BulletHandle: a slot plus the slot's generation, which goes stale as soon
+// as that bullet is removed, even if the slot is reused.
+
+#include <cstdint>
+#include <vector>
+#include "game_types.h"
+
+struct BulletHandle {
+    uint32_t slot;
+    uint32_t generation;
+
+    bool operator==(const BulletHandle& other) const {
+        return slot == other.slot && generation == other.generation;
+    }
+    bool operator!=(const BulletHandle& other) const { return !(*this == other); }
+};
+
+const BulletHandle NULL_BULLET_HANDLE = {0xFFFFFFFFu, 0};
+
+class BulletPool {
+private:
+    std::vector<Bullet> bullets;        // Live bullets packed in [0, count)
+    std::vector<uint32_t> denseSlot;    // Dense index -> slot
+    std::vector<uint32_t> slotDense;    // Slot -> dense index, while live
+    std::vector<uint32_t> generations;  // Bumped every time a slot is freed
+    std::vector<uint32_t> freeSlots;    // Stack of unused slots
+    int count;
+    long long dropped;                  // Spawns refused because the pool was full
+
+public:
+    explicit BulletPool(int capacity)
+        : bullets(capacity, Bullet(0, 0, true)), denseSlot(capacity), slotDense(capacity),
+          generations(capacity, 0), count(0), dropped(0) {
+        freeSlots.reserve(capacity);
+        clear();
+    }
+
+    int capacity() const { return (int)bullets.size(); }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    long long droppedSpawns() const { return dropped; }
+
+    Bullet& operator[](int i) { return bullets[i]; }
+    const Bullet& operator[](int i) const { return bullets[i]; }
+
+    Bullet* begin() { return bullets.data(); }
+    Bullet* end() { return bullets.data() + count; }
+    const Bullet* begin() const { return bullets.data(); }
+    const Bullet* end() const { return bullets.data() + count; }
+
+    // Free every bullet. Outstanding handles go stale.
+    void clear() {
+        for (int i = 0; i < count; i++) {
+            generations[denseSlot[i]]++;
+        }
+        count = 0;
+        freeSlots.clear();
+        for (int slot = capacity() - 1; slot >= 0; slot--) {
+            freeSlots.push_back((uint32_t)slot);
+        }
+    }
+
+    // Empty the pool, then make the first n bullets live for the caller to
+    // fill in (e.g. from a snapshot). Returns null if n exceeds capacity.
+    Bullet* resetTo(int n) {
+        clear();
+        if (n > capacity()) return nullptr;
+        for (int i = 0; i < n; i++) {
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            denseSlot[i] = slot;
+            slotDense[slot] = (uint32_t)i;
+        }
+        count = n;
+        return bullets.data();
+    }
+
+    // Add a bullet; returns NULL_BULLET_HANDLE (and counts a drop) when full
+    BulletHandle spawn(Coord x, Coord y, bool fromPlayer) {
+        if (freeSlots.empty()) {
+            dropped++;
+            return NULL_BULLET_HANDLE;
+        }
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+
+        bullets[count] = Bullet(x, y, fromPlayer);
+        denseSlot[count] = slot;
+        slotDense[slot] = (uint32_t)count;
+        count++;
+
+        BulletHandle handle = {slot, generations[slot]};
+        return handle;
+    }
+
+    BulletHandle handleAt(int i) const {
+        BulletHandle handle = {denseSlot[i], generations[denseSlot[i]]};
+        return handle;
+    }
+
+    bool valid(BulletHandle handle) const {
+        return handle.slot < (uint32_t)capacity() &&
+               generations[handle.slot] == handle.generation &&
+               slotDense[handle.slot] < (uint32_t)count &&
+               denseSlot[slotDense[handle.slot]] == handle.slot;
+    }
+
+    Bullet* get(BulletHandle handle) {
+        return valid(handle) ? &bullets[slotDense[handle.slot]] : nullptr;
+    }
+
+    // Remove the bullet at dense index i; the last bullet moves into i
+    void removeAt(int i) {
+        uint32_t slot = denseSlot[i];
+        int last = count - 1;
+        if (i != last) {
+            bullets[i] = bullets[last];
+            denseSlot[i] = denseSlot[last];
+            slotDense[denseSlot[i]] = (uint32_t)i;
+        }
+        count--;
+        generations[slot]++;
+        freeSlots.push_back(slot);
+    }
+
+    void release(BulletHandle handle) {
+        if (valid(handle)) removeAt((int)slotDense[handle.slot]);
+    }
+
+    // Remove every bullet whose active flag has been cleared
+    int removeInactive() {
+        int removed = 0;
+        for (int i = 0; i < count; ) {
+            if (bullets[i].active) {
+                i++;
+            } else {
+                removeAt(i);
+                removed++;
+            }
+        }
+        return removed;
+    }
+};
+
+#endif
@@ -0,0 +1,719 @@
+#ifndef ENEMY_FORMATION_H
+#define ENEMY_FORMATION_H
+
+// Structure-of-arrays enemy storage and the SIMD kernels that move it.
+//
+// Each enemy has a slot that marches with the formation and a path offset
+// (see formation_tables.h) that puts it somewhere around that slot; its
+// position is always slot + offset.
+//
+// A kill only clears the slot's alive flag and its bit in the packed alive
+// mask; slots are squeezed out (in order) once half of them are dead. The
+// kernels process every slot branch-free and use the mask only where dead
+// enemies must not count (bounds, reaching the player), so one pass moves
+// the whole formation.
+//
+// Alongside the mask, a live index answers "pick a shooter" without a scan:
+// a dense, slot-ordered list of live enemies, and for layouts with columns
+// the bottom-most live enemy of each column. Kills keep the columns current
+// in O(1) and only mark the list stale; nthAlive() rebuilds it from the
+// mask, at most once per shooting tick. Everything is derived from `alive`
+// and `column`, so rebuildIndex() restores it exactly.
+//
+// Kernels pick AVX2, SSE2 or NEON from the compiler's target flags, with a
+// scalar fallback. Define SI_NO_SIMD to force the scalar path. With
+// SI_FIXED_POINT the coordinates are int32 (see fixed_point.h) and the
+// kernels run on integer lanes, whose adds and min/max are exact and no
+// slower than the float ones.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "formation_tables.h"
+#include "simd_config.h"
+
+class EnemyFormation {
+public:
+    std::vector<Coord> x, y;                  // Current top-left corners
+    std::vector<Coord> prevX, prevY;          // Before the last step, for interpolation
+    std::vector<Coord> slotX, slotY;          // Formation slots, carried by the march
+    std::vector<Coord> pathX, pathY;          // This tick's path offsets from the slot
+    std::vector<uint16_t> pathPhase;          // Where on the path this enemy starts
+    std::vector<uint8_t> type;                // Row colour / score class, 0-3
+    std::vector<uint8_t> column;              // Layout column, or NO_COLUMN
+    std::vector<uint16_t> layoutSlot;         // Order added: the slot's index in its layout
+    std::vector<uint8_t> alive;               // 1 while the enemy is alive
+    std::vector<uint64_t> aliveMask;          // Bit i set while enemy i is alive
+
+    // Live index (see above)
+    std::vector<int> columnBottom;            // Per column: bottom-most live slot, or -1
+    std::vector<uint8_t> liveColumns;         // Columns with a live enemy, ascending
+
+    static const int MAX_COLUMNS = NO_COLUMN;   // Column ids are 0 to NO_COLUMN - 1
+
+    EnemyFormation() : liveCount(0), aliveListStale(false) {}
+
+    int size() const { return (int)x.size(); }
+    int aliveCount() const { return liveCount; }
+    bool empty() const { return liveCount == 0; }
+    bool isAlive(int i) const { return alive[i] != 0; }
+
+    // Make room for n enemies, so adding up to n never allocates
+    void reserve(int n) {
+        x.reserve(n); y.reserve(n);
+        prevX.reserve(n); prevY.reserve(n);
+        slotX.reserve(n); slotY.reserve(n);
+        pathX.reserve(n); pathY.reserve(n);
+        pathPhase.reserve(n);
+        type.reserve(n);
+        column.reserve(n);
+        layoutSlot.reserve(n);
+        alive.reserve(n);
+        aliveMask.reserve((n + 63) / 64);
+        aliveList.reserve(n);
+        above.reserve(n);
+        below.reserve(n);
+        columnBottom.reserve(MAX_COLUMNS);
+        liveColumns.reserve(MAX_COLUMNS);
+    }
+
+    // Size every array for n slots, e.g. before copying a snapshot in. Call
+    // rebuildIndex() once `alive` and `column` are filled.
+    void resize(int n) {
+        x.resize(n); y.resize(n);
+        prevX.resize(n); prevY.resize(n);
+        slotX.resize(n); slotY.resize(n);
+        pathX.resize(n); pathY.resize(n);
+        pathPhase.resize(n);
+        type.resize(n);
+        column.resize(n);
+        layoutSlot.resize(n);
+        alive.resize(n);
+    }
+
+    // Recompute the alive mask and live index from `alive` and `column`
+    void rebuildIndex() {
+        int n = size();
+        aliveMask.assign((n + 63) / 64, 0);
+        aliveList.clear();
+        aliveListStale = false;
+        above.assign(n, -1);
+        below.assign(n, -1);
+        columnBottom.clear();
+        liveColumns.clear();
+        liveCount = 0;
+        for (int i = 0; i < n; i++) {
+            if (!alive[i]) continue;
+            aliveMask[i >> 6] |= 1ULL << (i & 63);
+            aliveList.push_back(i);
+            liveCount++;
+            linkIntoColumn(i);
+        }
+        for (int c = 0; c < (int)columnBottom.size(); c++) {
+            if (columnBottom[c] >= 0) liveColumns.push_back((uint8_t)c);
+        }
+    }
+
+    void clear() {
+        x.clear(); y.clear();
+        prevX.clear(); prevY.clear();
+        slotX.clear(); slotY.clear();
+        pathX.clear(); pathY.clear();
+        pathPhase.clear();
+        type.clear();
+        column.clear();
+        layoutSlot.clear();
+        alive.clear();
+        aliveMask.clear();
+        aliveList.clear();
+        aliveListStale = false;
+        above.clear();
+        below.clear();
+        columnBottom.clear();
+        liveColumns.clear();
+        liveCount = 0;
+    }
+
+    // An enemy at slot (ex, ey), with no path offset until samplePath().
+    // Within a column, later enemies are further down.
+    void add(Coord ex, Coord ey, int enemyType, int phase = 0, int enemyColumn = NO_COLUMN) {
+        int i = size();
+        x.push_back(ex);
+        y.push_back(ey);
+        prevX.push_back(ex);
+        prevY.push_back(ey);
+        slotX.push_back(ex);
+        slotY.push_back(ey);
+        pathX.push_back(0);
+        pathY.push_back(0);
+        pathPhase.push_back((uint16_t)phase);
+        type.push_back((uint8_t)enemyType);
+        column.push_back((uint8_t)enemyColumn);
+        layoutSlot.push_back((uint16_t)i);
+        alive.push_back(1);
+        if ((i >> 6) >= (int)aliveMask.size()) aliveMask.push_back(0);
+        aliveMask[i >> 6] |= 1ULL << (i & 63);
+        liveCount++;
+        aliveList.push_back(i);  // The highest slot, so the list stays in order
+        above.push_back(-1);
+        below.push_back(-1);
+        bool newColumn = enemyColumn != NO_COLUMN &&
+                         (enemyColumn >= (int)columnBottom.size() || columnBottom[enemyColumn] < 0);
+        linkIntoColumn(i);
+        if (newColumn) {
+            liveColumns.insert(std::lower_bound(liveColumns.begin(), liveColumns.end(), (uint8_t)enemyColumn),
+                               (uint8_t)enemyColumn);
+        }
+    }
+
+    void kill(int i) {
+        if (!alive[i]) return;
+        alive[i] = 0;
+        aliveMask[i >> 6] &= ~(1ULL << (i & 63));
+        liveCount--;
+
+        // Rebuilt in slot order before the next pick, so picks do not depend
+        // on the order enemies died in
+        aliveListStale = true;
+
+        // Unlink from the column; the enemy above becomes the bottom
+        int c = column[i];
+        if (c == NO_COLUMN) return;
+        if (below[i] >= 0) above[below[i]] = above[i];
+        if (above[i] >= 0) below[above[i]] = below[i];
+        if (columnBottom[c] == i) {
+            columnBottom[c] = above[i];
+            if (above[i] < 0) {
+                liveColumns.erase(std::lower_bound(liveColumns.begin(), liveColumns.end(), (uint8_t)c));
+            }
+        }
+    }
+
+    // Squeeze out dead slots, keeping survivors in order. Worth it once at
+    // least half the slots are dead so the sweeps stop visiting them.
+    void compactIfSparse() {
+        int n = size();
+        if (liveCount * 2 > n) return;
+
+        int out = 0;
+        for (int i = 0; i < n; i++) {
+            if (!alive[i]) continue;
+            x[out] = x[i];
+            y[out] = y[i];
+            prevX[out] = prevX[i];
+            prevY[out] = prevY[i];
+            slotX[out] = slotX[i];
+            slotY[out] = slotY[i];
+            pathX[out] = pathX[i];
+            pathY[out] = pathY[i];
+            pathPhase[out] = pathPhase[i];
+            type[out] = type[i];
+            column[out] = column[i];
+            layoutSlot[out] = layoutSlot[i];
+            out++;
+        }
+        x.resize(out); y.resize(out);
+        prevX.resize(out); prevY.resize(out);
+        slotX.resize(out); slotY.resize(out);
+        pathX.resize(out); pathY.resize(out);
+        pathPhase.resize(out);
+        type.resize(out);
+        column.resize(out);
+        layoutSlot.resize(out);
+        alive.assign(out, 1);
+        rebuildIndex();
+    }
+
+    void savePreviousPositions() {
+        if (x.empty()) return;
+        memcpy(prevX.data(), x.data(), x.size() * sizeof(Coord));
+        memcpy(prevY.data(), y.data(), y.size() * sizeof(Coord));
+    }
+
+    // Look up every enemy's offset at `clock` samples into `path`, scaled
+    // by `scale`. Positions follow at the next moveFormation().
+    void samplePath(const FormationPath& path, int scale, int clock) {
+        for (int i = 0, n = size(); i < n; i++) {
+            int sample = (pathPhase[i] + clock) & PATH_MASK;
+            pathX[i] = path.offsetX(sample, scale);
+            pathY[i] = path.offsetY(sample, scale);
+        }
+    }
+
+    // Call visit(i) for each live enemy in slot order
+    template <typename Visitor>
+    void forEachAlive(Visitor visit) const {
+        for (size_t w = 0; w < aliveMask.size(); w++) {
+            uint64_t bits = aliveMask[w];
+            while (bits) {
+                int i = (int)(w * 64) + countTrailingZeros(bits);
+                visit(i);
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    // Slot index of the k-th live enemy (0-based, in slot order)
+    int nthAlive(int k) {
+        if (aliveListStale) refreshAliveList();
+        return aliveList[k];
+    }
+
+    // Bottom-most live enemy of the k-th column that still has one
+    int nthColumnBottom(int k) const { return columnBottom[liveColumns[k]]; }
+
+    static int countTrailingZeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int n = 0;
+        while (!(bits & 1)) { bits >>= 1; n++; }
+        return n;
+#endif
+    }
+
+    // Alive bits for slots [i, i + 8); i must be a multiple of 8
+    uint32_t aliveBits8(int i) const {
+        return (uint32_t)(aliveMask[i >> 6] >> (i & 63)) & 0xFF;
+    }
+
+private:
+    int liveCount;
+    std::vector<int> aliveList;     // Live slots, in slot order, unless aliveListStale
+    bool aliveListStale;            // Kills since aliveList was last built
+    std::vector<int> above, below;  // Next live slot up / down the same column, or -1
+
+    // Refill aliveList from the mask; never allocates, as it only shrinks
+    void refreshAliveList() {
+        aliveList.resize(liveCount);
+        int* out = aliveList.data();
+        forEachAlive([&out](int i) { *out++ = i; });
+        aliveListStale = false;
+    }
+
+    // Append live slot i at the bottom of its column
+    void linkIntoColumn(int i) {
+        int c = column[i];
+        if (c == NO_COLUMN) return;
+        if (c >= (int)columnBottom.size()) columnBottom.resize(c + 1, -1);
+        int previous = columnBottom[c];
+        above[i] = previous;
+        below[i] = -1;
+        if (previous >= 0) below[previous] = i;
+        columnBottom[c] = i;
+    }
+};
+
+// Extent of the live enemies' top-left corners
+struct FormationBounds {
+    Coord minX, maxX;
+    Coord maxY;
+
+    // Whether the enemy at (ex, ey) is one of the extremes, so removing it
+    // could shrink the bounds
+    bool touches(Coord ex, Coord ey) const { return ex <= minX || ex >= maxX || ey >= maxY; }
+};
+
+// Result of one formation move
+struct FormationMove {
+    FormationBounds bounds;   // Live enemies' extent after the move
+    bool reachedLine;         // A live enemy's bottom is at or below lineY
+};
+
+#if defined(SI_FIXED_POINT) && defined(SI_SIMD_SSE2)
+// SSE2 has no 32-bit integer min/max (SSE4.1 added them)
+inline __m128i selectInt32(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+inline __m128i minInt32(__m128i a, __m128i b) { return selectInt32(_mm_cmpgt_epi32(a, b), b, a); }
+inline __m128i maxInt32(__m128i a, __m128i b) { return selectInt32(_mm_cmpgt_epi32(a, b), a, b); }
+#endif
+
+// Min/max x and max y over live enemies. Returns {+big, -big, -big} when
+// none are alive.
+inline FormationBounds formationBounds(const EnemyFormation& f) {
+    const Coord BIG = largestCoord();
+    const int n = f.size();
+    const Coord* x = f.x.data();
+    const Coord* y = f.y.data();
+    Coord minX = BIG, maxX = -BIG, maxY = -BIG;
+    int i = 0;
+
+#if defined(SI_FIXED_POINT) && defined(SI_SIMD_AVX2)
+    const int32_t* rx = reinterpret_cast<const int32_t*>(x);
+    const int32_t* ry = reinterpret_cast<const int32_t*>(y);
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i big = _mm256_set1_epi32(BIG.raw), negBig = _mm256_set1_epi32(-BIG.raw);
+    __m256i vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        __m256i live = _mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)f.aliveBits8(i)), lanes), lanes);
+        __m256i vx = _mm256_loadu_si256((const __m256i*)(rx + i));
+        __m256i vy = _mm256_loadu_si256((const __m256i*)(ry + i));
+        vmin = _mm256_min_epi32(vmin, _mm256_blendv_epi8(big, vx, live));
+        vmax = _mm256_max_epi32(vmax, _mm256_blendv_epi8(negBig, vx, live));
+        vmaxY = _mm256_max_epi32(vmaxY, _mm256_blendv_epi8(negBig, vy, live));
+    }
+    int32_t lo[8], hi[8], low[8];
+    _mm256_storeu_si256((__m256i*)lo, vmin);
+    _mm256_storeu_si256((__m256i*)hi, vmax);
+    _mm256_storeu_si256((__m256i*)low, vmaxY);
+    for (int k = 0; k < 8; k++) {
+        if (lo[k] < minX.raw) minX = Fixed::fromRaw(lo[k]);
+        if (hi[k] > maxX.raw) maxX = Fixed::fromRaw(hi[k]);
+        if (low[k] > maxY.raw) maxY = Fixed::fromRaw(low[k]);
+    }
+#elif defined(SI_FIXED_POINT) && defined(SI_SIMD_SSE2)
+    const int32_t* rx = reinterpret_cast<const int32_t*>(x);
+    const int32_t* ry = reinterpret_cast<const int32_t*>(y);
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i big = _mm_set1_epi32(BIG.raw), negBig = _mm_set1_epi32(-BIG.raw);
+    __m128i vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            __m128i live = _mm_cmpeq_epi32(
+                _mm_and_si128(_mm_set1_epi32((int)(bits >> (half * 4))), lanes), lanes);
+            __m128i vx = _mm_loadu_si128((const __m128i*)(rx + i + half * 4));
+            __m128i vy = _mm_loadu_si128((const __m128i*)(ry + i + half * 4));
+            vmin = minInt32(vmin, selectInt32(live, vx, big));
+            vmax = maxInt32(vmax, selectInt32(live, vx, negBig));
+            vmaxY = maxInt32(vmaxY, selectInt32(live, vy, negBig));
+        }
+    }
+    int32_t lo[4], hi[4], low[4];
+    _mm_storeu_si128((__m128i*)lo, vmin);
+    _mm_storeu_si128((__m128i*)hi, vmax);
+    _mm_storeu_si128((__m128i*)low, vmaxY);
+    for (int k = 0; k < 4; k++) {
+        if (lo[k] < minX.raw) minX = Fixed::fromRaw(lo[k]);
+        if (hi[k] > maxX.raw) maxX = Fixed::fromRaw(hi[k]);
+        if (low[k] > maxY.raw) maxY = Fixed::fromRaw(low[k]);
+    }
+#elif defined(SI_FIXED_POINT) && defined(SI_SIMD_NEON)
+    const int32_t* rx = reinterpret_cast<const int32_t*>(x);
+    const int32_t* ry = reinterpret_cast<const int32_t*>(y);
+    const uint32x4_t lanes = {1, 2, 4, 8};
+    const int32x4_t big = vdupq_n_s32(BIG.raw), negBig = vdupq_n_s32(-BIG.raw);
+    int32x4_t vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            uint32x4_t live = vtstq_u32(vdupq_n_u32(bits >> (half * 4)), lanes);
+            int32x4_t vx = vld1q_s32(rx + i + half * 4);
+            int32x4_t vy = vld1q_s32(ry + i + half * 4);
+            vmin = vminq_s32(vmin, vbslq_s32(live, vx, big));
+            vmax = vmaxq_s32(vmax, vbslq_s32(live, vx, negBig));
+            vmaxY = vmaxq_s32(vmaxY, vbslq_s32(live, vy, negBig));
+        }
+    }
+    minX = Fixed::fromRaw(vminvq_s32(vmin));
+    maxX = Fixed::fromRaw(vmaxvq_s32(vmax));
+    maxY = Fixed::fromRaw(vmaxvq_s32(vmaxY));
+#elif defined(SI_SIMD_AVX2)
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256 vmin = _mm256_set1_ps(BIG), vmax = _mm256_set1_ps(-BIG), vmaxY = vmax;
+    for (; i + 8 <= n; i += 8) {
+        __m256 live = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)f.aliveBits8(i)), lanes), lanes));
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        vmin = _mm256_min_ps(vmin, _mm256_blendv_ps(_mm256_set1_ps(BIG), vx, live));
+        vmax = _mm256_max_ps(vmax, _mm256_blendv_ps(_mm256_set1_ps(-BIG), vx, live));
+        vmaxY = _mm256_max_ps(vmaxY, _mm256_blendv_ps(_mm256_set1_ps(-BIG), vy, live));
+    }
+    float lo[8], hi[8], low[8];
+    _mm256_storeu_ps(lo, vmin);
+    _mm256_storeu_ps(hi, vmax);
+    _mm256_storeu_ps(low, vmaxY);
+    for (int k = 0; k < 8; k++) {
+        if (lo[k] < minX) minX = lo[k];
+        if (hi[k] > maxX) maxX = hi[k];
+        if (low[k] > maxY) maxY = low[k];
+    }
+#elif defined(SI_SIMD_SSE2)
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128 big = _mm_set1_ps(BIG), negBig = _mm_set1_ps(-BIG);
+    __m128 vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            __m128 live = _mm_castsi128_ps(_mm_cmpeq_epi32(
+                _mm_and_si128(_mm_set1_epi32((int)(bits >> (half * 4))), lanes), lanes));
+            __m128 vx = _mm_loadu_ps(x + i + half * 4);
+            __m128 vy = _mm_loadu_ps(y + i + half * 4);
+            vmin = _mm_min_ps(vmin, _mm_or_ps(_mm_and_ps(live, vx), _mm_andnot_ps(live, big)));
+            vmax = _mm_max_ps(vmax, _mm_or_ps(_mm_and_ps(live, vx), _mm_andnot_ps(live, negBig)));
+            vmaxY = _mm_max_ps(vmaxY, _mm_or_ps(_mm_and_ps(live, vy), _mm_andnot_ps(live, negBig)));
+        }
+    }
+    float lo[4], hi[4], low[4];
+    _mm_storeu_ps(lo, vmin);
+    _mm_storeu_ps(hi, vmax);
+    _mm_storeu_ps(low, vmaxY);
+    for (int k = 0; k < 4; k++) {
+        if (lo[k] < minX) minX = lo[k];
+        if (hi[k] > maxX) maxX = hi[k];
+        if (low[k] > maxY) maxY = low[k];
+    }
+#elif defined(SI_SIMD_NEON)
+    const uint32x4_t lanes = {1, 2, 4, 8};
+    float32x4_t vmin = vdupq_n_f32(BIG), vmax = vdupq_n_f32(-BIG), vmaxY = vmax;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            uint32x4_t live = vtstq_u32(vdupq_n_u32(bits >> (half * 4)), lanes);
+            float32x4_t vx = vld1q_f32(x + i + half * 4);
+            float32x4_t vy = vld1q_f32(y + i + half * 4);
+            vmin = vminq_f32(vmin, vbslq_f32(live, vx, vdupq_n_f32(BIG)));
+            vmax = vmaxq_f32(vmax, vbslq_f32(live, vx, vdupq_n_f32(-BIG)));
+            vmaxY = vmaxq_f32(vmaxY, vbslq_f32(live, vy, vdupq_n_f32(-BIG)));
+        }
+    }
+    minX = vminvq_f32(vmin);
+    maxX = vmaxvq_f32(vmax);
+    maxY = vmaxvq_f32(vmaxY);
+#endif
+
+    for (; i < n; i++) {
+        if (!f.alive[i]) continue;
+        if (x[i] < minX) minX = x[i];
+        if (x[i] > maxX) maxX = x[i];
+        if (y[i] > maxY) maxY = y[i];
+    }
+
+    FormationBounds bounds = {minX, maxX, maxY};
+    return bounds;
+}
+
+// Shift every slot by (dx, dy) and put each enemy at its slot plus path
+// offset, in a single sweep. Returns the new bounds and, if checkLine is
+// set, whether a live enemy's bottom (maxY + enemyHeight) reached lineY.
+inline FormationMove moveFormation(EnemyFormation& f, Coord dx, Coord dy,
+                                   bool checkLine, Coord lineY, int enemyHeight) {
+    const Coord BIG = largestCoord();
+    const int n = f.size();
+    Coord* x = f.x.data();
+    Coord* y = f.y.data();
+    Coord* sx = f.slotX.data();
+    Coord* sy = f.slotY.data();
+    const Coord* px = f.pathX.data();
+    const Coord* py = f.pathY.data();
+    Coord minX = BIG, maxX = -BIG, maxY = -BIG;
+    int i = 0;
+
+#if defined(SI_FIXED_POINT) && defined(SI_SIMD_AVX2)
+    int32_t* rx = reinterpret_cast<int32_t*>(x);
+    int32_t* ry = reinterpret_cast<int32_t*>(y);
+    int32_t* rsx = reinterpret_cast<int32_t*>(sx);
+    int32_t* rsy = reinterpret_cast<int32_t*>(sy);
+    const int32_t* rpx = reinterpret_cast<const int32_t*>(px);
+    const int32_t* rpy = reinterpret_cast<const int32_t*>(py);
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i vdx = _mm256_set1_epi32(dx.raw), vdy = _mm256_set1_epi32(dy.raw);
+    const __m256i big = _mm256_set1_epi32(BIG.raw), negBig = _mm256_set1_epi32(-BIG.raw);
+    __m256i vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        __m256i live = _mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)f.aliveBits8(i)), lanes), lanes);
+        __m256i vsx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(rsx + i)), vdx);
+        __m256i vsy = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(rsy + i)), vdy);
+        _mm256_storeu_si256((__m256i*)(rsx + i), vsx);
+        _mm256_storeu_si256((__m256i*)(rsy + i), vsy);
+        __m256i vx = _mm256_add_epi32(vsx, _mm256_loadu_si256((const __m256i*)(rpx + i)));
+        __m256i vy = _mm256_add_epi32(vsy, _mm256_loadu_si256((const __m256i*)(rpy + i)));
+        _mm256_storeu_si256((__m256i*)(rx + i), vx);
+        _mm256_storeu_si256((__m256i*)(ry + i), vy);
+        vmin = _mm256_min_epi32(vmin, _mm256_blendv_epi8(big, vx, live));
+        vmax = _mm256_max_epi32(vmax, _mm256_blendv_epi8(negBig, vx, live));
+        vmaxY = _mm256_max_epi32(vmaxY, _mm256_blendv_epi8(negBig, vy, live));
+    }
+    int32_t lo[8], hi[8], low[8];
+    _mm256_storeu_si256((__m256i*)lo, vmin);
+    _mm256_storeu_si256((__m256i*)hi, vmax);
+    _mm256_storeu_si256((__m256i*)low, vmaxY);
+    for (int k = 0; k < 8; k++) {
+        if (lo[k] < minX.raw) minX = Fixed::fromRaw(lo[k]);
+        if (hi[k] > maxX.raw) maxX = Fixed::fromRaw(hi[k]);
+        if (low[k] > maxY.raw) maxY = Fixed::fromRaw(low[k]);
+    }
+#elif defined(SI_FIXED_POINT) && defined(SI_SIMD_SSE2)
+    int32_t* rx = reinterpret_cast<int32_t*>(x);
+    int32_t* ry = reinterpret_cast<int32_t*>(y);
+    int32_t* rsx = reinterpret_cast<int32_t*>(sx);
+    int32_t* rsy = reinterpret_cast<int32_t*>(sy);
+    const int32_t* rpx = reinterpret_cast<const int32_t*>(px);
+    const int32_t* rpy = reinterpret_cast<const int32_t*>(py);
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i vdx = _mm_set1_epi32(dx.raw), vdy = _mm_set1_epi32(dy.raw);
+    const __m128i big = _mm_set1_epi32(BIG.raw), negBig = _mm_set1_epi32(-BIG.raw);
+    __m128i vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            int j = i + half * 4;
+            __m128i live = _mm_cmpeq_epi32(
+                _mm_and_si128(_mm_set1_epi32((int)(bits >> (half * 4))), lanes), lanes);
+            __m128i vsx = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(rsx + j)), vdx);
+            __m128i vsy = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(rsy + j)), vdy);
+            _mm_storeu_si128((__m128i*)(rsx + j), vsx);
+            _mm_storeu_si128((__m128i*)(rsy + j), vsy);
+            __m128i vx = _mm_add_epi32(vsx, _mm_loadu_si128((const __m128i*)(rpx + j)));
+            __m128i vy = _mm_add_epi32(vsy, _mm_loadu_si128((const __m128i*)(rpy + j)));
+            _mm_storeu_si128((__m128i*)(rx + j), vx);
+            _mm_storeu_si128((__m128i*)(ry + j), vy);
+            vmin = minInt32(vmin, selectInt32(live, vx, big));
+            vmax = maxInt32(vmax, selectInt32(live, vx, negBig));
+            vmaxY = maxInt32(vmaxY, selectInt32(live, vy, negBig));
+        }
+    }
+    int32_t lo[4], hi[4], low[4];
+    _mm_storeu_si128((__m128i*)lo, vmin);
+    _mm_storeu_si128((__m128i*)hi, vmax);
+    _mm_storeu_si128((__m128i*)low, vmaxY);
+    for (int k = 0; k < 4; k++) {
+        if (lo[k] < minX.raw) minX = Fixed::fromRaw(lo[k]);
+        if (hi[k] > maxX.raw) maxX = Fixed::fromRaw(hi[k]);
+        if (low[k] > maxY.raw) maxY = Fixed::fromRaw(low[k]);
+    }
+#elif defined(SI_FIXED_POINT) && defined(SI_SIMD_NEON)
+    int32_t* rx = reinterpret_cast<int32_t*>(x);
+    int32_t* ry = reinterpret_cast<int32_t*>(y);
+    int32_t* rsx = reinterpret_cast<int32_t*>(sx);
+    int32_t* rsy = reinterpret_cast<int32_t*>(sy);
+    const int32_t* rpx = reinterpret_cast<const int32_t*>(px);
+    const int32_t* rpy = reinterpret_cast<const int32_t*>(py);
+    const uint32x4_t lanes = {1, 2, 4, 8};
+    const int32x4_t vdx = vdupq_n_s32(dx.raw), vdy = vdupq_n_s32(dy.raw);
+    const int32x4_t big = vdupq_n_s32(BIG.raw), negBig = vdupq_n_s32(-BIG.raw);
+    int32x4_t vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            int j = i + half * 4;
+            uint32x4_t live = vtstq_u32(vdupq_n_u32(bits >> (half * 4)), lanes);
+            int32x4_t vsx = vaddq_s32(vld1q_s32(rsx + j), vdx);
+            int32x4_t vsy = vaddq_s32(vld1q_s32(rsy + j), vdy);
+            vst1q_s32(rsx + j, vsx);
+            vst1q_s32(rsy + j, vsy);
+            int32x4_t vx = vaddq_s32(vsx, vld1q_s32(rpx + j));
+            int32x4_t vy = vaddq_s32(vsy, vld1q_s32(rpy + j));
+            vst1q_s32(rx + j, vx);
+            vst1q_s32(ry + j, vy);
+            vmin = vminq_s32(vmin, vbslq_s32(live, vx, big));
+            vmax = vmaxq_s32(vmax, vbslq_s32(live, vx, negBig));
+            vmaxY = vmaxq_s32(vmaxY, vbslq_s32(live, vy, negBig));
+        }
+    }
+    minX = Fixed::fromRaw(vminvq_s32(vmin));
+    maxX = Fixed::fromRaw(vmaxvq_s32(vmax));
+    maxY = Fixed::fromRaw(vmaxvq_s32(vmaxY));
+#elif defined(SI_SIMD_AVX2)
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256 vdx = _mm256_set1_ps(dx), vdy = _mm256_set1_ps(dy);
+    __m256 vmin = _mm256_set1_ps(BIG), vmax = _mm256_set1_ps(-BIG), vmaxY = vmax;
+    for (; i + 8 <= n; i += 8) {
+        __m256 live = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32((int)f.aliveBits8(i)), lanes), lanes));
+        __m256 vsx = _mm256_add_ps(_mm256_loadu_ps(sx + i), vdx);
+        __m256 vsy = _mm256_add_ps(_mm256_loadu_ps(sy + i), vdy);
+        _mm256_storeu_ps(sx + i, vsx);
+        _mm256_storeu_ps(sy + i, vsy);
+        __m256 vx = _mm256_add_ps(vsx, _mm256_loadu_ps(px + i));
+        __m256 vy = _mm256_add_ps(vsy, _mm256_loadu_ps(py + i));
+        _mm256_storeu_ps(x + i, vx);
+        _mm256_storeu_ps(y + i, vy);
+        vmin = _mm256_min_ps(vmin, _mm256_blendv_ps(_mm256_set1_ps(BIG), vx, live));
+        vmax = _mm256_max_ps(vmax, _mm256_blendv_ps(_mm256_set1_ps(-BIG), vx, live));
+        vmaxY = _mm256_max_ps(vmaxY, _mm256_blendv_ps(_mm256_set1_ps(-BIG), vy, live));
+    }
+    float lo[8], hi[8], low[8];
+    _mm256_storeu_ps(lo, vmin);
+    _mm256_storeu_ps(hi, vmax);
+    _mm256_storeu_ps(low, vmaxY);
+    for (int k = 0; k < 8; k++) {
+        if (lo[k] < minX) minX = lo[k];
+        if (hi[k] > maxX) maxX = hi[k];
+        if (low[k] > maxY) maxY = low[k];
+    }
+#elif defined(SI_SIMD_SSE2)
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128 vdx = _mm_set1_ps(dx), vdy = _mm_set1_ps(dy);
+    const __m128 big = _mm_set1_ps(BIG), negBig = _mm_set1_ps(-BIG);
+    __m128 vmin = big, vmax = negBig, vmaxY = negBig;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            int j = i + half * 4;
+            __m128 live = _mm_castsi128_ps(_mm_cmpeq_epi32(
+                _mm_and_si128(_mm_set1_epi32((int)(bits >> (half * 4))), lanes), lanes));
+            __m128 vsx = _mm_add_ps(_mm_loadu_ps(sx + j), vdx);
+            __m128 vsy = _mm_add_ps(_mm_loadu_ps(sy + j), vdy);
+            _mm_storeu_ps(sx + j, vsx);
+            _mm_storeu_ps(sy + j, vsy);
+            __m128 vx = _mm_add_ps(vsx, _mm_loadu_ps(px + j));
+            __m128 vy = _mm_add_ps(vsy, _mm_loadu_ps(py + j));
+            _mm_storeu_ps(x + j, vx);
+            _mm_storeu_ps(y + j, vy);
+            vmin = _mm_min_ps(vmin, _mm_or_ps(_mm_and_ps(live, vx), _mm_andnot_ps(live, big)));
+            vmax = _mm_max_ps(vmax, _mm_or_ps(_mm_and_ps(live, vx), _mm_andnot_ps(live, negBig)));
+            vmaxY = _mm_max_ps(vmaxY, _mm_or_ps(_mm_and_ps(live, vy), _mm_andnot_ps(live, negBig)));
+        }
+    }
+    float lo[4], hi[4], low[4];
+    _mm_storeu_ps(lo, vmin);
+    _mm_storeu_ps(hi, vmax);
+    _mm_storeu_ps(low, vmaxY);
+    for (int k = 0; k < 4; k++) {
+        if (lo[k] < minX) minX = lo[k];
+        if (hi[k] > maxX) maxX = hi[k];
+        if (low[k] > maxY) maxY = low[k];
+    }
+#elif defined(SI_SIMD_NEON)
+    const uint32x4_t lanes = {1, 2, 4, 8};
+    const float32x4_t vdx = vdupq_n_f32(dx), vdy = vdupq_n_f32(dy);
+    float32x4_t vmin = vdupq_n_f32(BIG), vmax = vdupq_n_f32(-BIG), vmaxY = vmax;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t bits = f.aliveBits8(i);
+        for (int half = 0; half < 2; half++) {
+            int j = i + half * 4;
+            uint32x4_t live = vtstq_u32(vdupq_n_u32(bits >> (half * 4)), lanes);
+            float32x4_t vsx = vaddq_f32(vld1q_f32(sx + j), vdx);
+            float32x4_t vsy = vaddq_f32(vld1q_f32(sy + j), vdy);
+            vst1q_f32(sx + j, vsx);
+            vst1q_f32(sy + j, vsy);
+            float32x4_t vx = vaddq_f32(vsx, vld1q_f32(px + j));
+            float32x4_t vy = vaddq_f32(vsy, vld1q_f32(py + j));
+            vst1q_f32(x + j, vx);
+            vst1q_f32(y + j, vy);
+            vmin = vminq_f32(vmin, vbslq_f32(live, vx, vdupq_n_f32(BIG)));
+            vmax = vmaxq_f32(vmax, vbslq_f32(live, vx, vdupq_n_f32(-BIG)));
+            vmaxY = vmaxq_f32(vmaxY, vbslq_f32(live, vy, vdupq_n_f32(-BIG)));
+        }
+    }
+    minX = vminvq_f32(vmin);
+    maxX = vmaxvq_f32(vmax);
+    maxY = vmaxvq_f32(vmaxY);
+#endif
+
+    for (; i < n; i++) {
+        sx[i] += dx;
+        sy[i] += dy;
+        x[i] = sx[i] + px[i];
+        y[i] = sy[i] + py[i];
+        if (!f.alive[i]) continue;
+        if (x[i] < minX) minX = x[i];
+        if (x[i] > maxX) maxX = x[i];
+        if (y[i] > maxY) maxY = y[i];
+    }
+
+    FormationMove move;
+    move.bounds.minX = minX;
+    move.bounds.maxX = maxX;
+    move.bounds.maxY = maxY;
+    move.reachedLine = checkLine && maxY + enemyHeight >= lineY;
+    return move;
+}
+
+#endif
@@ -0,0 +1,60 @@
+// Converts a gameplay event log (see game_events.h) to CSV, one row per
+// event, on stdout or into a file:
+//
+//   ./event_csv events.siev [out.csv]
+
+#include <cstdio>
+#include <cstring>
+#include "game_events.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s LOG [CSV]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return 1;
+    }
+    uint8_t header[EVENT_HEADER_SIZE];
+    uint64_t startTime = 0;
+    if (fread(header, 1, sizeof(header), in) != sizeof(header) || !decodeEventHeader(header, startTime)) {
+        fprintf(stderr, "%s is not an event log\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    FILE* out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    fprintf(out, "tick,event,player,enemy_type,pattern,level,x,y,value\n");
+    uint8_t records[1024 * EVENT_RECORD_SIZE];
+    long long count = 0;
+    size_t n;
+    while ((n = fread(records, EVENT_RECORD_SIZE, 1024, in)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            GameEvent event = decodeEvent(records + i * EVENT_RECORD_SIZE);
+            fprintf(out, "%u,%s,", event.tick, eventTypeName(event.type));
+            if (event.player != EVENT_NO_PLAYER) fprintf(out, "%d", event.player + 1);
+            fprintf(out, ",");
+            if (event.type == EVENT_KILL || event.type == EVENT_ENEMY_SHOT) fprintf(out, "%d", event.enemyType);
+            fprintf(out, ",%s,%d,%d,%d,%d\n", patternName((Pattern)event.pattern), event.level, event.x, event.y,
+                    event.value);
+        }
+        count += (long long)n;
+    }
+    fclose(in);
+
+    if (out != stdout && fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    fprintf(stderr, "%lld events, logged from %llu (Unix time)\n", count, (unsigned long long)startTime);
+    return 0;
+}
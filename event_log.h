@@ -0,0 +1,154 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+// Writes gameplay events (game_events.h) to a binary log on a background
+// thread. record() runs on the game thread inside a tick: it copies the
+// event into a preallocated SPSC ring and returns, a few nanoseconds with
+// no locks, syscalls or allocation. If the writer has fallen so far behind
+// that the ring is full, the event is dropped and counted instead.
+//
+// The writer wakes every couple of milliseconds, encodes whatever is in
+// the ring, appends it to the file, and flushes it to disk with fsync once
+// per sync interval, so a crash loses at most that much of the log.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "game_events.h"
+#include "spsc_queue.h"
+
+class EventLog : public GameEventSink {
+private:
+    static const int RING_CAPACITY = 1 << 16;  // Events in flight
+    static const int BATCH = 1024;             // Events encoded per write
+
+    SpscQueue<GameEvent> ring;                 // Game -> writer
+    std::atomic<long long> dropped;            // Written by the game thread only
+
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> closing;
+    std::atomic<long long> written;
+    std::atomic<long long> syncs;
+    std::atomic<bool> failed;
+
+    FILE* file;
+    std::string path;
+    std::chrono::milliseconds syncInterval;
+    uint8_t batch[BATCH * EVENT_RECORD_SIZE];  // Writer-side encoding buffer
+    std::string error;
+
+    // ---- Writer thread ----
+
+    // Encode and write up to BATCH events; returns how many there were
+    int drain() {
+        GameEvent event;
+        int n = 0;
+        while (n < BATCH && ring.pop(event)) {
+            encodeEvent(event, batch + n * EVENT_RECORD_SIZE);
+            n++;
+        }
+        if (n > 0) {
+            if (fwrite(batch, EVENT_RECORD_SIZE, n, file) == (size_t)n) {
+                written += n;
+            } else {
+                failed = true;
+            }
+        }
+        return n;
+    }
+
+    void sync() {
+        if (fflush(file) != 0 || fsync(fileno(file)) != 0) failed = true;
+        syncs++;
+    }
+
+    void writerLoop() {
+        std::chrono::steady_clock::time_point lastSync = std::chrono::steady_clock::now();
+        for (;;) {
+            // Read the flag first: everything pushed before close() is in
+            // the ring by then, so an empty drain after it means done
+            bool finishing = closing;
+            int n = drain();
+            if (std::chrono::steady_clock::now() - lastSync >= syncInterval) {
+                sync();
+                lastSync = std::chrono::steady_clock::now();
+            }
+            if (n == BATCH) continue;
+            if (finishing) break;
+            // The game thread never notifies (that could cost a syscall in
+            // a tick); close() does
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(2));
+        }
+        sync();
+    }
+
+public:
+    EventLog()
+        : ring(RING_CAPACITY), dropped(0), closing(false), written(0), syncs(0), failed(false),
+          file(nullptr), syncInterval(1000) {}
+
+    ~EventLog() { close(); }
+
+    // Start a log at `path`, fsyncing every `syncMs` milliseconds
+    bool open(const std::string& logPath, int syncMs = 1000) {
+        close();
+        path = logPath;
+        file = fopen(path.c_str(), "wb");
+        if (!file) {
+            error = "cannot write " + path;
+            return false;
+        }
+        uint8_t header[EVENT_HEADER_SIZE];
+        encodeEventHeader((uint64_t)time(nullptr), header);
+        if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+            error = "cannot write " + path;
+            fclose(file);
+            file = nullptr;
+            return false;
+        }
+        syncInterval = std::chrono::milliseconds(syncMs);
+        closing = false;
+        dropped = 0;
+        written = 0;
+        syncs = 0;
+        failed = false;
+        writer = std::thread(&EventLog::writerLoop, this);
+        return true;
+    }
+
+    bool isOpen() const { return writer.joinable(); }
+
+    // Game thread: queue `event` for writing
+    void record(const GameEvent& event) override {
+        if (!ring.push(event)) dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Write out everything queued, sync, and stop the writer
+    void close() {
+        if (!isOpen()) return;
+        closing = true;
+        wake.notify_one();
+        writer.join();
+        if (fclose(file) != 0) failed = true;
+        file = nullptr;
+    }
+
+    const std::string& target() const { return path; }
+    long long eventsWritten() const { return written; }
+    long long eventsDropped() const { return dropped; }
+    long long syncCount() const { return syncs; }
+    bool writeFailed() const { return failed; }
+    const std::string& lastError() const { return error; }
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+// The simulation's coordinate type. Positions, speeds and formation
+// offsets are Coords: floats by default, or with SI_FIXED_POINT defined,
+// Fixed values, 24.8 fixed point in an int32. Float results can change
+// with the compiler, its flags (FMA contraction, x87) and the maths
+// library, so two builds may drift apart; integer arithmetic cannot, so
+// fixed-point builds replay and hash identically everywhere.
+//
+// Fixed converts implicitly from int (whole pixels) but never from float,
+// so a float that creeps into the simulation fails to compile in that
+// mode. Code outside the simulation reads Coords through coordToFloat().
+
+#include <cstdint>
+
+struct Fixed {
+    static const int FRACTION_BITS = 8;
+    static const int32_t ONE = 1 << FRACTION_BITS;
+
+    int32_t raw;
+
+    Fixed() : raw(0) {}
+    Fixed(int pixels) : raw(pixels * ONE) {}
+
+    static Fixed fromRaw(int32_t value) {
+        Fixed f;
+        f.raw = value;
+        return f;
+    }
+
+    // num / den pixels, rounded to nearest (den > 0)
+    static Fixed ratio(int num, int den) {
+        int64_t scaled = (int64_t)num * ONE * 2;
+        return fromRaw((int32_t)((scaled >= 0 ? scaled + den : scaled - den) / (2 * den)));
+    }
+
+    float toFloat() const { return raw * (1.0f / ONE); }
+    int toInt() const { return raw / ONE; }   // Toward zero, like a float cast
+
+    Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+    Fixed& operator-=(Fixed o) { raw -= o.raw; return *this; }
+    Fixed& operator*=(int k) { raw *= k; return *this; }
+    Fixed operator-() const { return fromRaw(-raw); }
+};
+
+inline Fixed operator+(Fixed a, Fixed b) { return Fixed::fromRaw(a.raw + b.raw); }
+inline Fixed operator-(Fixed a, Fixed b) { return Fixed::fromRaw(a.raw - b.raw); }
+inline Fixed operator*(Fixed a, int k) { return Fixed::fromRaw(a.raw * k); }
+inline Fixed operator*(int k, Fixed a) { return Fixed::fromRaw(a.raw * k); }
+inline Fixed operator/(Fixed a, int k) { return Fixed::fromRaw(a.raw / k); }
+inline Fixed operator*(Fixed a, Fixed b) {
+    return Fixed::fromRaw((int32_t)(((int64_t)a.raw * b.raw) >> Fixed::FRACTION_BITS));
+}
+
+inline bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+inline bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+inline bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+inline bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+inline bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+inline bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+inline float coordToFloat(Fixed c) { return c.toFloat(); }
+inline int coordToInt(Fixed c) { return c.toInt(); }
+inline float coordToFloat(float c) { return c; }
+inline int coordToInt(float c) { return (int)c; }
+
+// largestCoord() is beyond any position, for empty extents
+#ifdef SI_FIXED_POINT
+typedef Fixed Coord;
+const uint32_t COORD_MODE = 1;    // Recorded in snapshots and replays
+inline Coord largestCoord() { return Fixed::fromRaw(INT32_MAX); }
+#else
+typedef float Coord;
+const uint32_t COORD_MODE = 0;
+inline Coord largestCoord() { return 3.0e38f; }
+#endif
+
+inline const char* coordModeName(uint32_t mode) { return mode ? "fixed point" : "float"; }
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef FORMATION_TABLES_H
+#define FORMATION_TABLES_H
+
+// Formations and their motion as data. Every layout a level can ask for
+// (each pattern at each size) is laid out once, the first time any game
+// needs one, as a list of slots. Each pattern also has a closed path
+// sampled at PATH_SAMPLES points that every enemy traces around its slot,
+// starting at its own phase. Starting a level copies a layout; a tick
+// looks up one path sample per enemy. Neither calls sin or cos.
+//
+// Fixed-point builds (see fixed_point.h) keep path samples as integers
+// and compute them with integer arithmetic only, so the tables, like the
+// rest of the simulation, come out the same on every compiler and libm.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "game_types.h"
+
+const int PATH_SAMPLES = 1024;            // Samples per cycle, a power of two
+const int PATH_MASK = PATH_SAMPLES - 1;
+const int NO_COLUMN = 0xFF;               // Slot that is not part of a column
+
+#ifdef SI_FIXED_POINT
+typedef int32_t PathSample;               // Units of 1 / (1 << PATH_FRACTION_BITS)
+const int PATH_FRACTION_BITS = 14;
+
+inline Coord scalePathSample(PathSample sample, int scale) {
+    return Fixed::fromRaw((int32_t)(((int64_t)sample * scale) >> (PATH_FRACTION_BITS - Fixed::FRACTION_BITS)));
+}
+#else
+typedef float PathSample;
+
+inline Coord scalePathSample(PathSample sample, int scale) { return sample * scale; }
+#endif
+
+// One enemy of a layout: where it starts, where on the path it begins and,
+// for layouts in rows and columns, which column it is in. Slots come in
+// row order, top row first. Slots sit on whole pixels.
+struct FormationSlot {
+    int x, y;
+    uint8_t type;
+    uint8_t column;
+    uint16_t phase;
+};
+
+// A closed trajectory, as offsets from the slot. Samples are unit-sized and
+// scaled per level (see pathScale()); `step` is the samples advanced per
+// tick, 0 for a formation that only marches.
+struct FormationPath {
+    PathSample x[PATH_SAMPLES];
+    PathSample y[PATH_SAMPLES];
+    int step;
+
+    // Offset of sample `s` at path size `scale`
+    Coord offsetX(int s, int scale) const { return scalePathSample(x[s], scale); }
+    Coord offsetY(int s, int scale) const { return scalePathSample(y[s], scale); }
+};
+
+class FormationTables {
+public:
+    // Built on first use; safe to call from several threads
+    static const FormationTables& instance() {
+        static const FormationTables tables;
+        return tables;
+    }
+
+    // The layout `pattern` uses at `level`
+    const std::vector<FormationSlot>& layout(Pattern pattern, int level) const {
+        int rows = std::min(4 + level / 3, MAX_ROWS);   // More rows every 3 levels
+        int cols = std::min(8 + level / 2, MAX_COLS);   // More columns every 2 levels
+        switch (pattern) {
+            case PATTERN_CLASSIC: return grids[0][rows - MIN_ROWS][cols - MIN_COLS];
+            case PATTERN_WAVE: return grids[1][rows - MIN_ROWS][cols - MIN_COLS];
+            case PATTERN_DIAMOND: return diamonds[std::min(5 + level / 2, 8) - 5];
+            case PATTERN_V_SHAPE: return vees[std::min(6 + level / 2, 10) - 6];
+            case PATTERN_CIRCLE: return circles[std::min(12 + level * 2, MAX_CIRCLE) - MIN_CIRCLE];
+        }
+        return grids[0][0][0];
+    }
+
+    const FormationPath& path(Pattern pattern) const { return paths[pattern]; }
+
+    // Path size at `level`; the circle's radius grows with the level
+    static int pathScale(Pattern pattern, int level) {
+        switch (pattern) {
+            case PATTERN_CLASSIC: return 0;
+            case PATTERN_DIAMOND: return 12;
+            case PATTERN_V_SHAPE: return 14;
+            case PATTERN_CIRCLE: return 100 + level * 10;
+            case PATTERN_WAVE: return 30;
+        }
+        return 0;
+    }
+
+private:
+    static const int MIN_ROWS = 4, MAX_ROWS = 8;
+    static const int MIN_COLS = 8, MAX_COLS = 12;
+    static const int MIN_CIRCLE = 14, MAX_CIRCLE = 30;  // Level 1 has 14 enemies
+
+    std::vector<FormationSlot> grids[2][MAX_ROWS - MIN_ROWS + 1][MAX_COLS - MIN_COLS + 1];
+    std::vector<FormationSlot> diamonds[4];
+    std::vector<FormationSlot> vees[5];
+    std::vector<FormationSlot> circles[MAX_CIRCLE - MIN_CIRCLE + 1];
+    FormationPath paths[PATTERN_COUNT];
+
+    static void addSlot(std::vector<FormationSlot>& slots, int x, int y, int type, int phase,
+                        int column = NO_COLUMN) {
+        FormationSlot slot = {x, y, (uint8_t)type, (uint8_t)column, (uint16_t)(phase & PATH_MASK)};
+        slots.push_back(slot);
+    }
+
+    FormationTables() {
+        for (int rows = MIN_ROWS; rows <= MAX_ROWS; rows++) {
+            for (int cols = MIN_COLS; cols <= MAX_COLS; cols++) {
+                buildGrid(grids[0][rows - MIN_ROWS][cols - MIN_COLS], rows, cols, false);
+                buildGrid(grids[1][rows - MIN_ROWS][cols - MIN_COLS], rows, cols, true);
+            }
+        }
+        for (int size = 5; size <= 8; size++) buildDiamond(diamonds[size - 5], size);
+        for (int size = 6; size <= 10; size++) buildV(vees[size - 6], size);
+        for (int n = MIN_CIRCLE; n <= MAX_CIRCLE; n++) buildCircle(circles[n - MIN_CIRCLE], n);
+        buildPaths();
+    }
+
+    // Classic rows stand still. Wave columns bob on a sine that runs along
+    // the rows, so at phase 0 column c sits sin(2 pi c / cols) down. Both
+    // fire classic style, from the bottom of a column.
+    static void buildGrid(std::vector<FormationSlot>& slots, int rows, int cols, bool wave) {
+        int startX = (SCREEN_WIDTH - (cols * ENEMY_SPACING_X)) / 2;
+        int startY = 80;
+        for (int row = 0; row < rows; row++) {
+            for (int col = 0; col < cols; col++) {
+                int phase = wave ? (col * PATH_SAMPLES + cols / 2) / cols : 0;
+                addSlot(slots, startX + col * ENEMY_SPACING_X, startY + row * ENEMY_SPACING_Y,
+                        row % 4, phase, col);
+            }
+        }
+    }
+
+    // Each row of the diamond loops a figure eight, a quarter cycle behind
+    // the row above
+    static void buildDiamond(std::vector<FormationSlot>& slots, int size) {
+        int centerX = SCREEN_WIDTH / 2;
+        int startY = 80;
+        for (int row = 0; row < size; row++) {
+            int enemiesInRow = (row < size/2) ? (row * 2 + 1) : ((size - row - 1) * 2 + 1);
+            int startX = centerX - enemiesInRow * ENEMY_SPACING_X / 2;  // Rows are odd, so exact
+            for (int i = 0; i < enemiesInRow; i++) {
+                addSlot(slots, startX + i * ENEMY_SPACING_X, startY + row * ENEMY_SPACING_Y,
+                        row % 4, row * PATH_SAMPLES / 4);
+            }
+        }
+    }
+
+    // The V's arms flap: a bob that travels from the tip out along both arms
+    static void buildV(std::vector<FormationSlot>& slots, int size) {
+        int centerX = SCREEN_WIDTH / 2;
+        int startY = 80;
+        for (int row = 0; row < size; row++) {
+            int y = startY + row * ENEMY_SPACING_Y;
+            int phase = PATH_SAMPLES - row * PATH_SAMPLES / 12;
+            addSlot(slots, centerX - row * 30, y, row % 4, phase);  // Left arm
+            addSlot(slots, centerX + row * 30, y, row % 4, phase);  // Right arm
+        }
+    }
+
+    // All circle slots are the centre; the path (a unit circle scaled to
+    // the radius) spreads the enemies out evenly and turns the ring
+    static void buildCircle(std::vector<FormationSlot>& slots, int n) {
+        int x = SCREEN_WIDTH / 2 - ENEMY_WIDTH / 2;
+        int y = 150 - ENEMY_HEIGHT / 2;
+        for (int i = 0; i < n; i++) {
+            addSlot(slots, x, y, i % 4, (i * PATH_SAMPLES + n / 2) / n);
+        }
+    }
+
+#ifdef SI_FIXED_POINT
+    // Product of two non-negative 2.30 values, rounded down
+    static int64_t mulQ30(int64_t a, int64_t b) { return (a * b) >> 30; }
+
+    // num / den rounded to nearest, halves away from zero (den > 0)
+    static int64_t divideRounded(int64_t num, int64_t den) {
+        return num >= 0 ? (num + den / 2) / den : -((-num + den / 2) / den);
+    }
+
+    // sin(2 pi s / PATH_SAMPLES) in path units, by a Taylor series in
+    // 2.30 fixed point over the first quadrant. Accurate to the last bit
+    // of a sample.
+    static PathSample pathSin(int s) {
+        const int64_t HALF_PI = 1686629713;       // pi / 2 in 2.30
+        const int QUADRANT = PATH_SAMPLES / 4;
+        s &= PATH_MASK;
+        int q = s % QUADRANT;
+        if ((s / QUADRANT) & 1) q = QUADRANT - q;
+        int64_t angle = HALF_PI * q / QUADRANT;
+        int64_t square = mulQ30(angle, angle);
+        int64_t term = angle, sum = angle;
+        for (int k = 1; k <= 6; k++) {
+            term = mulQ30(term, square) / ((2 * k) * (2 * k + 1));
+            sum += (k & 1) ? -term : term;
+        }
+        int32_t value = (int32_t)((sum + (1 << (29 - PATH_FRACTION_BITS))) >> (30 - PATH_FRACTION_BITS));
+        return s >= PATH_SAMPLES / 2 ? -value : value;
+    }
+
+    static PathSample pathCos(int s) { return pathSin(s + PATH_SAMPLES / 4); }
+#else
+    static PathSample pathSin(int s) {
+        const double TWO_PI = 6.283185307179586;
+        return (float)sin(TWO_PI * s / PATH_SAMPLES);
+    }
+
+    static PathSample pathCos(int s) {
+        const double TWO_PI = 6.283185307179586;
+        return (float)cos(TWO_PI * s / PATH_SAMPLES);
+    }
+#endif
+
+    void buildPaths() {
+        // Figure eight: a Catmull-Rom spline through eight control points,
+        // sampled uniformly in its parameter
+        const int PER_SEGMENT = PATH_SAMPLES / 8;
+#ifdef SI_FIXED_POINT
+        // (0.7, 0.6) and so on in path units. Each sample is the spline
+        // evaluated with t scaled up by PER_SEGMENT, divided back down once.
+        static const int EIGHT[8][2] = {
+            {0, 0}, {11469, -9830}, {16384, 0}, {11469, 9830},
+            {0, 0}, {-11469, -9830}, {-16384, 0}, {-11469, 9830}
+        };
+        const int64_t T = PER_SEGMENT;
+        for (int s = 0; s < PATH_SAMPLES; s++) {
+            int k = s / PER_SEGMENT;
+            int64_t r = s % PER_SEGMENT;
+            const int* p0 = EIGHT[(k + 7) & 7];
+            const int* p1 = EIGHT[k];
+            const int* p2 = EIGHT[(k + 1) & 7];
+            const int* p3 = EIGHT[(k + 2) & 7];
+            for (int axis = 0; axis < 2; axis++) {
+                int64_t v = 2 * p1[axis] * T * T * T + (p2[axis] - p0[axis]) * r * T * T +
+                            (2 * p0[axis] - 5 * p1[axis] + 4 * p2[axis] - p3[axis]) * r * r * T +
+                            (3 * p1[axis] - p0[axis] - 3 * p2[axis] + p3[axis]) * r * r * r;
+                (axis == 0 ? paths[PATTERN_DIAMOND].x : paths[PATTERN_DIAMOND].y)[s] =
+                    (PathSample)divideRounded(v, 2 * T * T * T);
+            }
+        }
+#else
+        static const float EIGHT[8][2] = {
+            {0, 0}, {0.7f, -0.6f}, {1, 0}, {0.7f, 0.6f},
+            {0, 0}, {-0.7f, -0.6f}, {-1, 0}, {-0.7f, 0.6f}
+        };
+        for (int s = 0; s < PATH_SAMPLES; s++) {
+            int k = s / PER_SEGMENT;
+            float t = (s % PER_SEGMENT) / (float)PER_SEGMENT;
+            const float* p0 = EIGHT[(k + 7) & 7];
+            const float* p1 = EIGHT[k];
+            const float* p2 = EIGHT[(k + 1) & 7];
+            const float* p3 = EIGHT[(k + 2) & 7];
+            float t2 = t * t, t3 = t2 * t;
+            for (int axis = 0; axis < 2; axis++) {
+                float v = 0.5f * (2 * p1[axis] + (p2[axis] - p0[axis]) * t +
+                                  (2 * p0[axis] - 5 * p1[axis] + 4 * p2[axis] - p3[axis]) * t2 +
+                                  (3 * p1[axis] - p0[axis] - 3 * p2[axis] + p3[axis]) * t3);
+                (axis == 0 ? paths[PATTERN_DIAMOND].x : paths[PATTERN_DIAMOND].y)[s] = v;
+            }
+        }
+#endif
+        paths[PATTERN_DIAMOND].step = 4;
+
+        for (int s = 0; s < PATH_SAMPLES; s++) {
+            PathSample c = pathCos(s), sn = pathSin(s);
+            paths[PATTERN_CLASSIC].x[s] = 0;
+            paths[PATTERN_CLASSIC].y[s] = 0;
+            paths[PATTERN_V_SHAPE].x[s] = 0;
+            paths[PATTERN_V_SHAPE].y[s] = sn;
+            paths[PATTERN_CIRCLE].x[s] = c;
+            paths[PATTERN_CIRCLE].y[s] = sn;
+            paths[PATTERN_WAVE].x[s] = 0;
+            paths[PATTERN_WAVE].y[s] = sn;
+        }
+        paths[PATTERN_CLASSIC].step = 0;
+        paths[PATTERN_V_SHAPE].step = 12;
+        paths[PATTERN_CIRCLE].step = 2;
+        paths[PATTERN_WAVE].step = 6;
+    }
+};
+
+#endif
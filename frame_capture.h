@@ -0,0 +1,345 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+// Records frames to disk on a background thread. The game asks for a free
+// buffer with acquire(), fills it with an 800x600 RGBA32 frame (a readback
+// of the presented frame, or a SoftRaster drawing straight into it) and
+// hands it over with submit(). Buffers are preallocated in a small ring and
+// move between the two threads through SPSC queues, so the game never waits
+// on the disk: if every buffer is still queued for writing, acquire()
+// returns null and the frame is dropped and counted. A frame that cannot be
+// filled is given back with abandon() and counted the same way.
+//
+// Output is a raw Y4M video (4:2:0, full-range BT.601), or one PNG per
+// frame. PNGs are stored uncompressed (no zlib dependency); re-encode them
+// for archiving. PNG names carry the frame number, so dropped frames show
+// as gaps.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_queue.h"
+
+enum CaptureFormat {
+    CAPTURE_Y4M,    // One .y4m file
+    CAPTURE_PNG     // One .png per frame
+};
+
+class FrameCapture {
+private:
+    struct Slot {
+        std::vector<uint8_t> pixels;   // RGBA32, tightly packed
+        int frame;                     // Frames offered before this one
+    };
+
+    std::vector<Slot> slots;
+    SpscQueue<int> freeSlots;          // Writer -> game
+    SpscQueue<int> readySlots;         // Game -> writer
+    int current;                       // Slot from acquire() not yet submitted, or -1
+    int abandoned;                     // Slot given back by abandon(), reused first, or -1
+    int framesOffered;                 // acquire() calls, written or not
+
+    std::thread writer;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> closing;
+    std::atomic<long long> written;
+    std::atomic<long long> dropped;
+    std::atomic<bool> failed;
+
+    CaptureFormat format;
+    std::string path;                  // Y4M file, or PNG name pattern with one %d
+    int width, height;
+    FILE* video;
+    std::vector<uint8_t> scratch;      // Writer-side conversion buffer
+    uint32_t crcTable[256];
+    std::string error;
+
+    // ---- Writer thread ----
+
+    void writerLoop() {
+        int slot;
+        for (;;) {
+            if (readySlots.pop(slot)) {
+                writeFrame(slots[slot]);
+                freeSlots.push(slot);
+                continue;
+            }
+            if (closing) {
+                while (readySlots.pop(slot)) writeFrame(slots[slot]);
+                break;
+            }
+            // Woken by submit(); the timeout covers a wakeup sent just
+            // before we started waiting
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(5));
+        }
+    }
+
+    void writeFrame(const Slot& slot) {
+        bool ok = format == CAPTURE_Y4M ? writeY4mFrame(slot.pixels.data())
+                                        : writePngFrame(slot.pixels.data(), slot.frame);
+        if (ok) {
+            written++;
+        } else {
+            failed = true;
+        }
+    }
+
+    // RGBA to planar 4:2:0: luma per pixel, chroma per 2x2 block
+    bool writeY4mFrame(const uint8_t* rgba) {
+        int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+        uint8_t* luma = scratch.data();
+        uint8_t* cb = luma + (size_t)width * height;
+        uint8_t* cr = cb + (size_t)chromaWidth * chromaHeight;
+
+        for (int i = 0; i < width * height; i++) {
+            const uint8_t* p = rgba + (size_t)i * 4;
+            luma[i] = (uint8_t)((77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8);
+        }
+        for (int cy = 0; cy < chromaHeight; cy++) {
+            for (int cx = 0; cx < chromaWidth; cx++) {
+                int r = 0, g = 0, b = 0, n = 0;
+                for (int y = cy * 2; y < cy * 2 + 2 && y < height; y++) {
+                    for (int x = cx * 2; x < cx * 2 + 2 && x < width; x++) {
+                        const uint8_t* p = rgba + ((size_t)y * width + x) * 4;
+                        r += p[0];
+                        g += p[1];
+                        b += p[2];
+                        n++;
+                    }
+                }
+                r /= n;
+                g /= n;
+                b /= n;
+                cb[cy * chromaWidth + cx] = (uint8_t)(128 + ((-43 * r - 85 * g + 128 * b) >> 8));
+                cr[cy * chromaWidth + cx] = (uint8_t)(128 + ((128 * r - 107 * g - 21 * b) >> 8));
+            }
+        }
+
+        size_t bytes = (size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight;
+        return fputs("FRAME\n", video) >= 0 && fwrite(scratch.data(), 1, bytes, video) == bytes;
+    }
+
+    uint32_t crc(uint32_t c, const uint8_t* data, size_t bytes) const {
+        c = ~c;
+        for (size_t i = 0; i < bytes; i++) c = crcTable[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        return ~c;
+    }
+
+    static void putBE32(uint8_t* out, uint32_t v) {
+        out[0] = (uint8_t)(v >> 24);
+        out[1] = (uint8_t)(v >> 16);
+        out[2] = (uint8_t)(v >> 8);
+        out[3] = (uint8_t)v;
+    }
+
+    // One chunk with its length and CRC; `data` may be null if `bytes` is 0
+    bool writeChunk(FILE* file, const char* type, const uint8_t* data, uint32_t bytes) {
+        uint8_t header[8];
+        putBE32(header, bytes);
+        memcpy(header + 4, type, 4);
+        uint8_t tail[4];
+        putBE32(tail, crc(crc(0, header + 4, 4), data, bytes));
+        return fwrite(header, 1, 8, file) == 8 && fwrite(data, 1, bytes, file) == bytes &&
+               fwrite(tail, 1, 4, file) == 4;
+    }
+
+    // RGB PNG whose zlib stream is a run of stored (uncompressed) blocks
+    bool writePngFrame(const uint8_t* rgba, int frame) {
+        char name[1024];
+        snprintf(name, sizeof(name), path.c_str(), frame);
+        FILE* file = fopen(name, "wb");
+        if (!file) return false;
+
+        // Scanlines: filter byte 0, then RGB
+        size_t rowBytes = 1 + (size_t)width * 3;
+        size_t raw = rowBytes * height;
+        uint8_t* lines = scratch.data();
+        for (int y = 0; y < height; y++) {
+            uint8_t* out = lines + y * rowBytes;
+            const uint8_t* in = rgba + (size_t)y * width * 4;
+            *out++ = 0;
+            for (int x = 0; x < width; x++, in += 4, out += 3) {
+                out[0] = in[0];
+                out[1] = in[1];
+                out[2] = in[2];
+            }
+        }
+
+        // zlib header, stored blocks of up to 65535 bytes, Adler-32
+        uint8_t* z = lines + raw;
+        size_t zBytes = 0;
+        z[zBytes++] = 0x78;
+        z[zBytes++] = 0x01;
+        uint32_t a = 1, b = 0;
+        for (size_t offset = 0; offset < raw;) {
+            uint32_t block = (uint32_t)std::min<size_t>(65535, raw - offset);
+            z[zBytes++] = offset + block == raw ? 1 : 0;
+            z[zBytes++] = (uint8_t)block;
+            z[zBytes++] = (uint8_t)(block >> 8);
+            z[zBytes++] = (uint8_t)~block;
+            z[zBytes++] = (uint8_t)(~block >> 8);
+            memcpy(z + zBytes, lines + offset, block);
+            // 5552 bytes is the most Adler-32 can sum before b overflows
+            for (uint32_t done = 0; done < block;) {
+                uint32_t run = std::min<uint32_t>(5552, block - done);
+                const uint8_t* p = lines + offset + done;
+                for (uint32_t i = 0; i < run; i++) {
+                    a += p[i];
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+                done += run;
+            }
+            zBytes += block;
+            offset += block;
+        }
+        putBE32(z + zBytes, (b << 16) | a);
+        zBytes += 4;
+
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        uint8_t ihdr[13];
+        putBE32(ihdr, (uint32_t)width);
+        putBE32(ihdr + 4, (uint32_t)height);
+        ihdr[8] = 8;    // Bits per channel
+        ihdr[9] = 2;    // RGB
+        ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+        bool ok = fwrite(signature, 1, 8, file) == 8 && writeChunk(file, "IHDR", ihdr, 13) &&
+                  writeChunk(file, "IDAT", z, (uint32_t)zBytes) && writeChunk(file, "IEND", nullptr, 0);
+        return fclose(file) == 0 && ok;
+    }
+
+public:
+    explicit FrameCapture(int slotCount = 8)
+        : slots(slotCount), freeSlots(slotCount), readySlots(slotCount), current(-1), abandoned(-1), framesOffered(0),
+          closing(false), written(0), dropped(0), failed(false), format(CAPTURE_Y4M),
+          width(0), height(0), video(nullptr) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crcTable[n] = c;
+        }
+    }
+
+    ~FrameCapture() { close(); }
+
+    // Start the writer. A .y4m path is one video file; any other path is a
+    // PNG name pattern with one integer conversion (e.g. shots/f%05d.png),
+    // or a prefix that frame numbers and ".png" are appended to.
+    bool open(const std::string& target, int frameWidth, int frameHeight, int fps) {
+        close();
+        width = frameWidth;
+        height = frameHeight;
+        bool y4m = target.size() >= 4 && target.compare(target.size() - 4, 4, ".y4m") == 0;
+        format = y4m ? CAPTURE_Y4M : CAPTURE_PNG;
+        path = y4m || target.find('%') != std::string::npos ? target : target + "%06d.png";
+
+        if (format == CAPTURE_Y4M) {
+            video = fopen(path.c_str(), "wb");
+            if (!video) {
+                error = "cannot write " + path;
+                return false;
+            }
+            fprintf(video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps > 0 ? fps : 60);
+            scratch.resize((size_t)width * height + 2 * (size_t)((width + 1) / 2) * ((height + 1) / 2));
+        } else {
+            size_t raw = (1 + (size_t)width * 3) * height;
+            scratch.resize(raw * 2 + (raw / 65535 + 1) * 5 + 6);
+        }
+
+        for (size_t i = 0; i < slots.size(); i++) {
+            slots[i].pixels.assign((size_t)width * height * 4, 0);
+            freeSlots.push((int)i);
+        }
+        current = -1;
+        abandoned = -1;
+        framesOffered = 0;
+        closing = false;
+        written = 0;
+        dropped = 0;
+        failed = false;
+        writer = std::thread(&FrameCapture::writerLoop, this);
+        return true;
+    }
+
+    bool isOpen() const { return writer.joinable(); }
+
+    // A buffer for the next frame (width x height RGBA32, tightly packed),
+    // or null if the writer is behind and the frame must be dropped. With
+    // `wait`, blocks for the writer instead; for runs without a frame
+    // deadline. Calling again before submit() returns the same buffer.
+    uint8_t* acquire(bool wait = false) {
+        if (!isOpen()) return nullptr;
+        if (current < 0) {
+            framesOffered++;
+            if (abandoned >= 0) {
+                current = abandoned;
+                abandoned = -1;
+            }
+            while (current < 0 && !freeSlots.pop(current)) {
+                if (!wait) {
+                    dropped++;
+                    return nullptr;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            slots[current].frame = framesOffered - 1;
+        }
+        return slots[current].pixels.data();
+    }
+
+    // Queue the buffer from acquire() for writing
+    void submit() {
+        if (current < 0) return;
+        readySlots.push(current);
+        current = -1;
+        wake.notify_one();
+    }
+
+    // Give up on the buffer from acquire() (e.g. the readback failed): the
+    // frame counts as dropped and the buffer goes to the next acquire().
+    // It is held here rather than pushed to freeSlots, whose only producer
+    // is the writer.
+    void abandon() {
+        if (current < 0) return;
+        abandoned = current;
+        current = -1;
+        dropped++;
+    }
+
+    // Write out everything queued, then stop the writer
+    void close() {
+        if (!isOpen()) return;
+        closing = true;
+        wake.notify_one();
+        writer.join();
+        if (video) {
+            if (fclose(video) != 0) failed = true;
+            video = nullptr;
+        }
+        // Reset the queues for a later open()
+        int slot;
+        while (freeSlots.pop(slot)) {}
+        while (readySlots.pop(slot)) {}
+    }
+
+    CaptureFormat outputFormat() const { return format; }
+    const std::string& target() const { return path; }
+    long long framesWritten() const { return written; }
+    long long framesDropped() const { return dropped; }
+    bool writeFailed() const { return failed; }
+    const std::string& lastError() const { return error; }
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+// Everything a frame draws, copied out of the Simulation after a tick: the
+// entities (with their previous positions, for interpolation) and the HUD
+// values. The renderer only ever reads snapshots, so the simulation can run
+// on another thread and hand them over through a TripleBuffer.
+//
+// Only live enemies and bullets are copied. The vectors keep their capacity,
+// so capturing into a reused snapshot does not allocate.
+
+#include <cstdint>
+#include <vector>
+#include "simulation.h"
+#include "profiler.h"
+
+struct FrameSnapshot {
+    struct PlayerView {
+        float x, y, prevX, prevY;
+        int lives;
+        bool active;
+
+        float lerpX(float alpha) const { return prevX + (x - prevX) * alpha; }
+        float lerpY(float alpha) const { return prevY + (y - prevY) * alpha; }
+    };
+
+    struct BulletView {
+        float x, y, prevX, prevY;
+        bool fromPlayer;
+
+        float lerpX(float alpha) const { return prevX + (x - prevX) * alpha; }
+        float lerpY(float alpha) const { return prevY + (y - prevY) * alpha; }
+    };
+
+    long long tick;          // Sim ticks run when this was captured
+    int64_t tickDueNs;       // When that tick was due (steady clock), for interpolation
+    int64_t inputNs;         // Oldest key event first applied by this tick (steady clock; 0: none)
+
+    int score;
+    int level;
+    bool gameOver;
+    bool victory;
+    bool levelTransition;
+    Pattern currentPattern;
+
+    int playerCount;
+    PlayerView players[MAX_PLAYERS];
+
+    std::vector<float> enemyX, enemyY, enemyPrevX, enemyPrevY;
+    std::vector<uint8_t> enemyType;
+    std::vector<BulletView> bullets;
+
+    // Simulation phase timings, filled in when the simulation runs on a
+    // thread whose profiler the renderer cannot read
+    bool hasSimStats;
+    PhaseStats simStats[3];  // updateEnemies, updateBullets, checkCollisions
+
+    FrameSnapshot()
+        : tick(0), tickDueNs(0), inputNs(0), score(0), level(1), gameOver(false), victory(false),
+          levelTransition(false), currentPattern(PATTERN_CLASSIC), playerCount(0), hasSimStats(false) {}
+
+    void capture(const Simulation& sim, long long tickCount, int64_t dueNs = 0) {
+        tick = tickCount;
+        tickDueNs = dueNs;
+        inputNs = 0;
+        score = sim.score;
+        level = sim.level;
+        gameOver = sim.gameOver;
+        victory = sim.victory;
+        levelTransition = sim.levelTransition;
+        currentPattern = sim.currentPattern;
+
+        playerCount = (int)sim.players.size();
+        for (int i = 0; i < playerCount; i++) {
+            const Player& player = sim.players[i];
+            PlayerView& view = players[i];
+            view.x = coordToFloat(player.x);
+            view.y = coordToFloat(player.y);
+            view.prevX = coordToFloat(player.prevX);
+            view.prevY = coordToFloat(player.prevY);
+            view.lives = player.lives;
+            view.active = player.active;
+        }
+
+        const EnemyFormation& enemies = sim.enemies;
+        int alive = enemies.aliveCount();
+        enemyX.resize(alive);
+        enemyY.resize(alive);
+        enemyPrevX.resize(alive);
+        enemyPrevY.resize(alive);
+        enemyType.resize(alive);
+        int out = 0;
+        enemies.forEachAlive([&](int i) {
+            enemyX[out] = coordToFloat(enemies.x[i]);
+            enemyY[out] = coordToFloat(enemies.y[i]);
+            enemyPrevX[out] = coordToFloat(enemies.prevX[i]);
+            enemyPrevY[out] = coordToFloat(enemies.prevY[i]);
+            enemyType[out] = enemies.type[i];
+            out++;
+        });
+
+        bullets.clear();
+        for (const Bullet& bullet : sim.bullets) {
+            if (!bullet.active) continue;
+            BulletView view = {coordToFloat(bullet.x), coordToFloat(bullet.y), coordToFloat(bullet.prevX),
+                               coordToFloat(bullet.prevY), bullet.fromPlayer};
+            bullets.push_back(view);
+        }
+    }
+
+    int enemyCount() const { return (int)enemyX.size(); }
+};
+
+#endif
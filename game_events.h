@@ -0,0 +1,143 @@
+#ifndef GAME_EVENTS_H
+#define GAME_EVENTS_H
+
+// Gameplay events: what happened during a tick, as fixed-size records. The
+// simulation hands each one to a GameEventSink if it has one (EventLog in
+// event_log.h writes them to disk). The log file is
+//
+//   offset  size  field
+//   0       4     magic "SIEV"
+//   4       2     format version (EVENT_LOG_VERSION)
+//   6       2     record size (EVENT_RECORD_SIZE)
+//   8       8     when logging started, Unix seconds
+//   16      ...   records:
+//                   0   4  tick (Simulation::frameCount)
+//                   4   1  event type (GameEventType)
+//                   5   1  player, or EVENT_NO_PLAYER
+//                   6   1  enemy type (kills, enemy shots)
+//                   7   1  formation pattern
+//                   8   2  level
+//                   10  2  x, whole pixels (signed)
+//                   12  2  y, whole pixels (signed)
+//                   14  4  value (signed; see GameEventType)
+//
+// All integers are little-endian.
+
+#include <cstdint>
+#include <cstring>
+#include "game_types.h"
+
+const uint16_t EVENT_LOG_VERSION = 1;
+const int EVENT_HEADER_SIZE = 16;
+const int EVENT_RECORD_SIZE = 18;
+const uint8_t EVENT_NO_PLAYER = 0xFF;
+
+enum GameEventType {
+    EVENT_SHOT = 1,       // A player fired; x, y are the bullet's
+    EVENT_ENEMY_SHOT,     // An enemy fired; x, y are the bullet's
+    EVENT_KILL,           // An enemy died; x, y: its top left; value: points scored
+    EVENT_PLAYER_HIT,     // x, y: the player's top left; value: lives left
+    EVENT_LEVEL_START,    // A formation was built; value: its size
+    EVENT_LEVEL_END,      // The formation was cleared; value: score
+    EVENT_GAME_OVER       // value: score
+};
+
+inline const char* eventTypeName(int type) {
+    switch (type) {
+        case EVENT_SHOT: return "shot";
+        case EVENT_ENEMY_SHOT: return "enemy_shot";
+        case EVENT_KILL: return "kill";
+        case EVENT_PLAYER_HIT: return "player_hit";
+        case EVENT_LEVEL_START: return "level_start";
+        case EVENT_LEVEL_END: return "level_end";
+        case EVENT_GAME_OVER: return "game_over";
+    }
+    return "unknown";
+}
+
+struct GameEvent {
+    uint32_t tick;
+    uint8_t type;
+    uint8_t player;
+    uint8_t enemyType;
+    uint8_t pattern;
+    uint16_t level;
+    int16_t x;
+    int16_t y;
+    int32_t value;
+};
+
+// Receives events from the game thread, in order. Called from inside a
+// tick, so implementations must be quick and must not allocate.
+class GameEventSink {
+public:
+    virtual ~GameEventSink() {}
+    virtual void record(const GameEvent& event) = 0;
+};
+
+// Hands every event to two sinks (either may be null), for a simulation
+// with more than one listener
+class GameEventTee : public GameEventSink {
+private:
+    GameEventSink* first;
+    GameEventSink* second;
+
+public:
+    GameEventTee(GameEventSink* a = nullptr, GameEventSink* b = nullptr) : first(a), second(b) {}
+
+    void record(const GameEvent& event) override {
+        if (first) first->record(event);
+        if (second) second->record(event);
+    }
+};
+
+inline void encodeEventHeader(uint64_t startTime, uint8_t* out) {
+    memcpy(out, "SIEV", 4);
+    out[4] = (uint8_t)EVENT_LOG_VERSION;
+    out[5] = (uint8_t)(EVENT_LOG_VERSION >> 8);
+    out[6] = (uint8_t)EVENT_RECORD_SIZE;
+    out[7] = 0;
+    for (int i = 0; i < 8; i++) out[8 + i] = (uint8_t)(startTime >> (8 * i));
+}
+
+// False if `in` is not a log this build can read
+inline bool decodeEventHeader(const uint8_t* in, uint64_t& startTime) {
+    if (memcmp(in, "SIEV", 4) != 0) return false;
+    if ((in[4] | in[5] << 8) != EVENT_LOG_VERSION || (in[6] | in[7] << 8) != EVENT_RECORD_SIZE) return false;
+    startTime = 0;
+    for (int i = 0; i < 8; i++) startTime |= (uint64_t)in[8 + i] << (8 * i);
+    return true;
+}
+
+inline void encodeEvent(const GameEvent& event, uint8_t* out) {
+    uint16_t level = event.level, x = (uint16_t)event.x, y = (uint16_t)event.y;
+    uint32_t value = (uint32_t)event.value;
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(event.tick >> (8 * i));
+    out[4] = event.type;
+    out[5] = event.player;
+    out[6] = event.enemyType;
+    out[7] = event.pattern;
+    out[8] = (uint8_t)level;
+    out[9] = (uint8_t)(level >> 8);
+    out[10] = (uint8_t)x;
+    out[11] = (uint8_t)(x >> 8);
+    out[12] = (uint8_t)y;
+    out[13] = (uint8_t)(y >> 8);
+    for (int i = 0; i < 4; i++) out[14 + i] = (uint8_t)(value >> (8 * i));
+}
+
+inline GameEvent decodeEvent(const uint8_t* in) {
+    GameEvent event;
+    event.tick = (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+    event.type = in[4];
+    event.player = in[5];
+    event.enemyType = in[6];
+    event.pattern = in[7];
+    event.level = (uint16_t)(in[8] | in[9] << 8);
+    event.x = (int16_t)(in[10] | in[11] << 8);
+    event.y = (int16_t)(in[12] | in[13] << 8);
+    event.value = (int32_t)((uint32_t)in[14] | (uint32_t)in[15] << 8 | (uint32_t)in[16] << 16 | (uint32_t)in[17] << 24);
+    return event;
+}
+
+#endif
@@ -0,0 +1,387 @@
+#ifndef GAME_RENDERER_H
+#define GAME_RENDERER_H
+
+// Draws one frame through a RenderBackend: entities, HUD and the
+// level/game-over overlays, all read from a FrameSnapshot of the
+// simulation. It owns no window, so the game draws into its window with
+// SdlBackend, and headless runs and benchmarks into pixel buffers with
+// SoftRaster, with the same code.
+//
+// The HUD and the overlay boxes are panels: each is drawn into a cached
+// layer (render_layer.h) and copied from it, one draw call a frame, until
+// the few values it shows change. The translucent shade behind an overlay
+// stays a plain fill, so every cached texel is opaque or transparent and a
+// copy gives exactly the pixels drawing directly would.
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <cstdio>
+#include "frame_snapshot.h"
+#include "particle_system.h"
+#include "render_backend.h"
+#include "render_layer.h"
+#include "glyph_atlas.h"
+#include "sprite_atlas.h"
+#include "profiler.h"
+
+// Open the first available system font at `size`; sets *path to the file used
+inline TTF_Font* openSystemFont(int size, const char** path = nullptr) {
+    static const char* fontPaths[] = {
+        "/System/Library/Fonts/Helvetica.ttc",
+        "/System/Library/Fonts/Supplemental/Arial.ttf",
+        "/Library/Fonts/Arial.ttf",
+        "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+    };
+
+    for (const char* fontPath : fontPaths) {
+        TTF_Font* font = TTF_OpenFont(fontPath, size);
+        if (font) {
+            if (path) *path = fontPath;
+            return font;
+        }
+    }
+    return nullptr;
+}
+
+class GameRenderer {
+private:
+    RenderBackend* backend;
+    GlyphAtlas textAtlas;       // Glyphs of the regular font
+    GlyphAtlas largeTextAtlas;  // Glyphs of the large font
+
+    SpriteAtlas sprites;        // Players, enemies and bullets
+
+    static const int ENEMY_ANIMATION_TICKS = 30;  // Ticks per enemy animation frame
+
+    // Cached panels. A new one needs an id here, and a draw function that
+    // calls drawPanel() with its screen area, the values it shows and the
+    // code that paints it.
+    enum PanelId {
+        PANEL_HUD,            // Lives, score and level
+        PANEL_LEVEL_START,    // Level and pattern box between levels
+        PANEL_LEVEL_END,      // Game over / level complete box
+        PANEL_COUNT
+    };
+
+    // What a panel was painted from; any change repaints it
+    struct PanelKey {
+        int values[4];
+
+        bool operator==(const PanelKey& other) const {
+            for (int i = 0; i < 4; i++) {
+                if (values[i] != other.values[i]) return false;
+            }
+            return true;
+        }
+    };
+
+    struct Panel {
+        RenderLayer layer;
+        PanelKey key;
+        bool valid;        // The layer holds `key`'s content for the current backend
+    };
+
+    int drawCalls;         // Renderer submissions this frame
+    bool showProfile;      // Phase timing overlay (F3)
+    Panel panels[PANEL_COUNT];
+    SDL_Point origin;      // Screen position of the layer being painted, else (0, 0)
+
+    static PanelKey panelKey(int a, int b = 0, int c = 0, int d = 0) {
+        PanelKey key = {{a, b, c, d}};
+        return key;
+    }
+
+    void renderText(const char* text, int x, int y, SDL_Color color, GlyphAtlas* atlas = nullptr) {
+        if (atlas == nullptr) atlas = &textAtlas;
+        atlas->queueText(text, x - origin.x, y - origin.y, color);
+    }
+
+    void renderTextCentered(const char* text, int centerX, int y, SDL_Color color, GlyphAtlas* atlas = nullptr) {
+        if (atlas == nullptr) atlas = &textAtlas;
+        atlas->queueText(text, centerX - atlas->textWidth(text) / 2 - origin.x, y - origin.y, color);
+    }
+
+    // Draw all text queued so far; call before drawing anything over it
+    void flushText() {
+        drawCalls += textAtlas.flush(*backend);
+        drawCalls += largeTextAtlas.flush(*backend);
+    }
+
+    // Single rectangle fill for overlays, counted like the batches
+    void fillRect(SDL_Color color, const SDL_Rect& rect) {
+        SDL_Rect moved = {rect.x - origin.x, rect.y - origin.y, rect.w, rect.h};
+        backend->fillRects(color, &moved, 1);
+        drawCalls++;
+    }
+
+    // Draw panel `id` over `area` (in screen coordinates) from its layer,
+    // first calling `paint` to repaint the layer if it was painted from
+    // anything but `key`. Backends without layers get `paint` every frame.
+    template <typename Paint>
+    void drawPanel(PanelId id, const SDL_Rect& area, const PanelKey& key, Paint paint) {
+        Panel& panel = panels[id];
+        if (panel.layer.resize(area.w, area.h)) panel.valid = false;
+        if (!panel.valid || !(panel.key == key)) {
+            if (!backend->beginLayer(panel.layer)) {
+                paint();
+                flushText();
+                return;
+            }
+            origin.x = area.x;
+            origin.y = area.y;
+            paint();
+            flushText();
+            origin.x = origin.y = 0;
+            backend->endLayer();
+            panel.key = key;
+            panel.valid = true;
+        }
+        backend->drawLayer(panel.layer, area.x, area.y);
+        drawCalls++;
+    }
+
+    void drawPlayers(const FrameSnapshot& frame, float alpha) {
+        for (int i = 0; i < frame.playerCount; i++) {
+            const FrameSnapshot::PlayerView& player = frame.players[i];
+            if (!player.active) continue;
+            sprites.queue(SpriteAtlas::SPRITE_PLAYER, (int)player.lerpX(alpha), (int)player.lerpY(alpha));
+        }
+    }
+
+    void drawEnemies(const FrameSnapshot& frame, float alpha) {
+        // The whole formation steps between animation frames together
+        int animationFrame = (int)(frame.tick / ENEMY_ANIMATION_TICKS % SpriteAtlas::ENEMY_FRAMES);
+
+        for (int i = 0; i < frame.enemyCount(); i++) {
+            int ex = (int)(frame.enemyPrevX[i] + (frame.enemyX[i] - frame.enemyPrevX[i]) * alpha);
+            int ey = (int)(frame.enemyPrevY[i] + (frame.enemyY[i] - frame.enemyPrevY[i]) * alpha);
+            sprites.queue(SpriteAtlas::enemySprite(frame.enemyType[i], animationFrame), ex, ey);
+        }
+    }
+
+    void drawBullets(const FrameSnapshot& frame, float alpha) {
+        for (const auto& bullet : frame.bullets) {
+            sprites.queue(bullet.fromPlayer ? SpriteAtlas::SPRITE_PLAYER_BULLET : SpriteAtlas::SPRITE_ENEMY_BULLET,
+                          (int)bullet.lerpX(alpha), (int)bullet.lerpY(alpha));
+        }
+    }
+
+    void drawEntities(const FrameSnapshot& frame, float alpha, ParticleSystem* particles) {
+        PROFILE_SCOPE(PHASE_DRAW_ENTITIES);
+
+        drawPlayers(frame, alpha);
+        drawEnemies(frame, alpha);
+        drawBullets(frame, alpha);
+        drawCalls += sprites.flush(*backend);  // One draw call however many entities
+        if (particles) drawCalls += particles->draw(sprites, *backend);  // And one for the particles
+    }
+
+    // Phase timings over the last few seconds, below the HUD
+    void drawProfile(const FrameSnapshot& frame) {
+        const Profiler& profiler = frameProfiler();
+        SDL_Color grey = {160, 160, 160, 255};
+        int lineHeight = textAtlas.height();
+        int x = 10, y = 45;
+
+        SDL_Color shade = {0, 0, 0, 160};
+        SDL_Rect panel = {x - 5, y - 5, 400, lineHeight * (PHASE_COUNT + 1) + 10};
+        fillRect(shade, panel);
+
+#ifdef SI_PROFILE
+        SDL_Color white = {255, 255, 255, 255};
+
+        // Proportional font, so each column starts at a fixed x
+        const int columns[4] = {x, x + 180, x + 255, x + 330};
+        const char* headings[4] = {"phase", "min", "avg", "p99 ms"};
+        for (int c = 0; c < 4; c++) renderText(headings[c], columns[c], y, grey);
+
+        char value[16];
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            y += lineHeight;
+            PhaseStats s = profiler.stats((ProfilePhase)p);
+            if (frame.hasSimStats && p >= PHASE_UPDATE_ENEMIES && p <= PHASE_COLLISIONS) {
+                s = frame.simStats[p - PHASE_UPDATE_ENEMIES];  // From the sim thread
+            }
+            double values[3] = {s.minMs, s.avgMs, s.p99Ms};
+            renderText(profilePhaseName((ProfilePhase)p), columns[0], y, white);
+            for (int c = 0; c < 3; c++) {
+                snprintf(value, sizeof(value), "%.2f", values[c]);
+                renderText(value, columns[c + 1], y, white);
+            }
+        }
+#else
+        (void)profiler;
+        (void)frame;
+        renderText("Profiler compiled out (release build)", x, y, grey);
+#endif
+        flushText();
+    }
+
+    void paintHud(const FrameSnapshot& frame) {
+        SDL_Color white = {255, 255, 255, 255};
+        SDL_Color yellow = {255, 255, 0, 255};
+
+        char text[32];
+
+        // Draw lives text and count
+        snprintf(text, sizeof(text), "Lives: %d", frame.players[0].lives);
+        renderText(text, 10, 10, white);
+
+        // Draw score
+        snprintf(text, sizeof(text), "Score: %d", frame.score);
+        renderText(text, SCREEN_WIDTH / 2 - 60, 10, white);
+
+        // Draw level
+        snprintf(text, sizeof(text), "Level: %d", frame.level);
+        renderText(text, SCREEN_WIDTH - 120, 10, yellow);
+    }
+
+    void drawUI(const FrameSnapshot& frame) {
+        PROFILE_SCOPE(PHASE_DRAW_UI);
+
+        if (textAtlas.ready()) {
+            SDL_Rect strip = {0, 0, SCREEN_WIDTH, 10 + textAtlas.height()};
+            drawPanel(PANEL_HUD, strip, panelKey(frame.players[0].lives, frame.score, frame.level),
+                      [&]() { paintHud(frame); });
+        }
+        if (showProfile) drawProfile(frame);
+    }
+
+    // Darken the playfield behind an overlay box
+    void drawShade() {
+        SDL_Color shade = {0, 0, 0, 180};
+        SDL_Rect overlay = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        fillRect(shade, overlay);
+    }
+
+    void drawLevelTransition(const FrameSnapshot& frame) {
+        PROFILE_SCOPE(PHASE_DRAW_OVERLAY);
+
+        drawShade();
+        SDL_Rect box = {SCREEN_WIDTH/2 - 200, SCREEN_HEIGHT/2 - 100, 400, 200};
+        drawPanel(PANEL_LEVEL_START, box, panelKey(frame.level, frame.currentPattern),
+                  [&]() { paintLevelTransition(frame, box); });
+    }
+
+    void paintLevelTransition(const FrameSnapshot& frame, const SDL_Rect& box) {
+        // Draw box
+        SDL_Color boxColor = {0, 150, 255, 255};
+        fillRect(boxColor, box);
+
+        SDL_Color black = {0, 0, 0, 255};
+        SDL_Rect innerBox = {SCREEN_WIDTH/2 - 195, SCREEN_HEIGHT/2 - 95, 390, 190};
+        fillRect(black, innerBox);
+
+        // Draw text
+        SDL_Color white = {255, 255, 255, 255};
+        SDL_Color cyan = {0, 255, 255, 255};
+
+        char levelText[32];
+        char patternText[48];
+        snprintf(levelText, sizeof(levelText), "LEVEL %d", frame.level);
+        snprintf(patternText, sizeof(patternText), "Pattern: %s", patternName(frame.currentPattern));
+        const char* readyText = "Press SPACE to continue";
+
+        renderTextCentered(levelText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 60, cyan, &largeTextAtlas);
+        renderTextCentered(patternText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 10, white);
+        renderTextCentered(readyText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 40, white);
+    }
+
+    void drawGameOver(const FrameSnapshot& frame) {
+        PROFILE_SCOPE(PHASE_DRAW_OVERLAY);
+
+        drawShade();
+        SDL_Rect box = {SCREEN_WIDTH/2 - 200, SCREEN_HEIGHT/2 - 120, 400, 240};
+        drawPanel(PANEL_LEVEL_END, box, panelKey(frame.gameOver, frame.level, frame.score),
+                  [&]() { paintGameOver(frame, box); });
+    }
+
+    void paintGameOver(const FrameSnapshot& frame, const SDL_Rect& box) {
+        // Draw box
+        SDL_Color boxColor = frame.gameOver ? (SDL_Color){255, 0, 0, 255} : (SDL_Color){0, 255, 0, 255};
+        fillRect(boxColor, box);
+
+        SDL_Color black = {0, 0, 0, 255};
+        SDL_Rect innerBox = {SCREEN_WIDTH/2 - 195, SCREEN_HEIGHT/2 - 115, 390, 230};
+        fillRect(black, innerBox);
+
+        // Draw text
+        SDL_Color white = {255, 255, 255, 255};
+        SDL_Color bright = {255, 255, 100, 255};  // Brighter yellow for main text
+        const char* mainText = frame.gameOver ? "GAME OVER!" : "LEVEL COMPLETE!";
+        char levelText[48];
+        char scoreText[48];
+        snprintf(levelText, sizeof(levelText), "Level Reached: %d", frame.level);
+        snprintf(scoreText, sizeof(scoreText), "Final Score: %d", frame.score);
+        const char* restartText = frame.gameOver ? "Press SPACE to restart" : "Press SPACE for next level";
+
+        // Use large font only for GAME OVER, regular font for LEVEL COMPLETE
+        GlyphAtlas* titleAtlas = frame.gameOver ? &largeTextAtlas : &textAtlas;
+        renderTextCentered(mainText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 70, bright, titleAtlas);
+        renderTextCentered(levelText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 20, white);
+        renderTextCentered(scoreText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 10, white);
+        renderTextCentered(restartText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 60, white);
+    }
+
+public:
+    GameRenderer() : backend(nullptr), drawCalls(0), showProfile(false) {
+        origin.x = origin.y = 0;
+        invalidatePanels();
+    }
+
+    // Build the sprite and glyph atlases; either font may be null (its text
+    // is skipped)
+    void init(RenderBackend* target, TTF_Font* font, TTF_Font* largeFont) {
+        backend = target;
+        sprites.build();
+        textAtlas.build(font);
+        largeTextAtlas.build(largeFont);
+    }
+
+    // Draw later frames through `target` instead, keeping the atlases;
+    // panels are repainted for it
+    void setBackend(RenderBackend* target) {
+        backend = target;
+        invalidatePanels();
+    }
+
+    // Repaint every panel before its next copy, e.g. after the renderer
+    // lost its render targets
+    void invalidatePanels() {
+        for (Panel& panel : panels) panel.valid = false;
+    }
+
+    void toggleProfile() { showProfile = !showProfile; }
+
+    void destroy() {
+        for (Panel& panel : panels) {
+            panel.layer.destroy();
+            panel.valid = false;
+        }
+        largeTextAtlas.destroy();
+        textAtlas.destroy();
+        sprites.destroy();
+        backend = nullptr;
+    }
+
+    // Clear and draw a whole frame, `alpha` of the way from the previous
+    // tick to the current one, with `particles` over the entities if given.
+    // Does not present. Returns the draw calls issued.
+    int drawFrame(const FrameSnapshot& frame, float alpha, ParticleSystem* particles = nullptr) {
+        drawCalls = 0;
+        SDL_Color black = {0, 0, 0, 255};
+        backend->clear(black);
+
+        drawEntities(frame, alpha, particles);
+        drawUI(frame);
+
+        if (frame.levelTransition) {
+            drawLevelTransition(frame);
+        } else if (frame.gameOver || frame.victory) {
+            drawGameOver(frame);
+        }
+        return drawCalls;
+    }
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef GAME_TYPES_H
+#define GAME_TYPES_H
+
+// Constants and entity types shared by the simulation and its containers
+
+#include "fixed_point.h"
+
+// Constants
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+const int PLAYER_WIDTH = 40;
+const int PLAYER_HEIGHT = 30;
+const int ENEMY_WIDTH = 30;
+const int ENEMY_HEIGHT = 30;
+const int BULLET_WIDTH = 4;
+const int BULLET_HEIGHT = 12;
+const int PLAYER_SPEED = 5;
+const int BULLET_SPEED = 7;
+const int ENEMY_BULLET_SPEED = 4;
+const int ENEMY_SPACING_X = 60;
+const int ENEMY_SPACING_Y = 50;
+const int SIM_TICKS_PER_SECOND = 60;
+const int MAX_PLAYERS = 4;
+const int MAX_FORMATION_SIZE = 8 * 12;    // Largest formation a level builds (rows x cols cap)
+const int DEFAULT_BULLET_CAPACITY = 512;  // Bullets in flight at once, player and enemy
+const int COLLISION_CELL_SIZE = 32;
+const int GRID_MIN_PAIRS = 512;  // Below this many bullet/target pairs a plain scan is cheaper
+
+// Enemy formation patterns
+enum Pattern {
+    PATTERN_CLASSIC,    // Traditional rows
+    PATTERN_DIAMOND,    // Diamond formation
+    PATTERN_V_SHAPE,    // V formation
+    PATTERN_CIRCLE,     // Circular formation
+    PATTERN_WAVE        // Wave pattern
+};
+const int PATTERN_COUNT = PATTERN_WAVE + 1;
+
+inline const char* patternName(Pattern pattern) {
+    switch(pattern) {
+        case PATTERN_CLASSIC: return "Classic";
+        case PATTERN_DIAMOND: return "Diamond";
+        case PATTERN_V_SHAPE: return "V-Formation";
+        case PATTERN_CIRCLE: return "Circle";
+        case PATTERN_WAVE: return "Wave";
+    }
+    return "Unknown";
+}
+
+// Entity structures
+struct Entity {
+    Coord x, y;
+    Coord prevX, prevY;  // Position before the last step, for render interpolation
+    int width, height;
+    bool active;
+
+    Entity(Coord x = 0, Coord y = 0, int w = 0, int h = 0)
+        : x(x), y(y), prevX(x), prevY(y), width(w), height(h), active(true) {}
+
+    // Position blended between the last two steps (alpha in [0, 1])
+    float lerpX(float alpha) const { return coordToFloat(prevX) + coordToFloat(x - prevX) * alpha; }
+    float lerpY(float alpha) const { return coordToFloat(prevY) + coordToFloat(y - prevY) * alpha; }
+
+    bool collidesWith(const Entity& other) const {
+        return active && other.active &&
+               x < other.x + other.width &&
+               x + width > other.x &&
+               y < other.y + other.height &&
+               y + height > other.y;
+    }
+};
+
+struct Player : Entity {
+    int lives;
+    Player(Coord x, Coord y) : Entity(x, y, PLAYER_WIDTH, PLAYER_HEIGHT), lives(3) {}
+};
+
+struct Bullet : Entity {
+    bool fromPlayer;
+    Bullet(Coord x, Coord y, bool fp)
+        : Entity(x, y, BULLET_WIDTH, BULLET_HEIGHT), fromPlayer(fp) {}
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+// Text rendering from a per-font glyph atlas. Every printable ASCII glyph is
+// rendered once with SDL_ttf into a single RGBA surface; strings are then
+// queued as quads and handed to a RenderBackend in one batch per flush.
+// The SDL backend uploads the surface as a texture the first time it draws
+// (see texture_atlas.h); the software rasterizer reads the surface
+// directly. After that nothing here allocates or uploads, so HUD numbers
+// can change every frame for free.
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <vector>
+#include "render_backend.h"
+#include "texture_atlas.h"
+
+class GlyphAtlas : public TextureAtlas {
+private:
+    static const int FIRST_CHAR = 32;    // ' '
+    static const int LAST_CHAR = 126;    // '~'
+    static const int GLYPH_COUNT = LAST_CHAR - FIRST_CHAR + 1;
+    static const int ATLAS_WIDTH = 512;
+    static const int MAX_QUADS = 256;    // Per flush before the buffers grow
+
+    struct Glyph {
+        SDL_Rect src;   // Where the glyph sits in the atlas (w == 0: no pixels)
+        int advance;    // Horizontal pen advance
+    };
+
+    int atlasWidth, atlasHeight;
+    int lineHeight;
+    Glyph glyphs[GLYPH_COUNT];
+    std::vector<short> kerning;          // GLYPH_COUNT x GLYPH_COUNT, [prev][next]
+
+    std::vector<AtlasQuad> quads;        // Pending glyphs, reused every flush
+
+    static int glyphIndex(unsigned char c) {
+        if (c < FIRST_CHAR || c > LAST_CHAR) c = '?';
+        return c - FIRST_CHAR;
+    }
+
+public:
+    GlyphAtlas() : atlasWidth(0), atlasHeight(0), lineHeight(0) {}
+
+    // Render all glyphs of `font` into a fresh atlas surface
+    bool build(TTF_Font* font) {
+        destroy();
+        if (!font) return false;
+
+        SDL_Color white = {255, 255, 255, 255};
+        SDL_Surface* rendered[GLYPH_COUNT];
+
+        // Shelf-pack glyph surfaces left to right, top to bottom
+        int penX = 0, penY = 0, rowHeight = 0;
+        for (int i = 0; i < GLYPH_COUNT; i++) {
+            Uint16 ch = (Uint16)(FIRST_CHAR + i);
+            Glyph& glyph = glyphs[i];
+            glyph.src.x = glyph.src.y = glyph.src.w = glyph.src.h = 0;
+            glyph.advance = 0;
+            rendered[i] = nullptr;
+
+            int minx, maxx, miny, maxy, advance;
+            if (TTF_GlyphMetrics(font, ch, &minx, &maxx, &miny, &maxy, &advance) < 0) continue;
+            glyph.advance = advance;
+
+            rendered[i] = TTF_RenderGlyph_Solid(font, ch, white);
+            if (!rendered[i]) continue;  // Blank glyphs (space) only advance
+
+            int w = rendered[i]->w, h = rendered[i]->h;
+            if (penX + w > ATLAS_WIDTH) {
+                penX = 0;
+                penY += rowHeight + 1;
+                rowHeight = 0;
+            }
+            glyph.src.x = penX;
+            glyph.src.y = penY;
+            glyph.src.w = w;
+            glyph.src.h = h;
+            penX += w + 1;
+            if (h > rowHeight) rowHeight = h;
+        }
+
+        atlasWidth = ATLAS_WIDTH;
+        atlasHeight = penY + rowHeight;
+        lineHeight = TTF_FontHeight(font);
+
+        if (atlasHeight > 0) createSurface(atlasWidth, atlasHeight);
+        for (int i = 0; i < GLYPH_COUNT; i++) {
+            if (!rendered[i]) continue;
+            if (surface) {
+                SDL_Rect dest = glyphs[i].src;
+                SDL_BlitSurface(rendered[i], nullptr, surface, &dest);
+            }
+            SDL_FreeSurface(rendered[i]);
+        }
+        if (!surface) return false;
+
+        kerning.assign(GLYPH_COUNT * GLYPH_COUNT, 0);
+        for (int a = 0; a < GLYPH_COUNT; a++) {
+            for (int b = 0; b < GLYPH_COUNT; b++) {
+                kerning[a * GLYPH_COUNT + b] = (short)TTF_GetFontKerningSizeGlyphs(
+                    font, (Uint16)(FIRST_CHAR + a), (Uint16)(FIRST_CHAR + b));
+            }
+        }
+
+        quads.reserve(MAX_QUADS);
+        return true;
+    }
+
+    void destroy() {
+        release();
+        quads.clear();
+    }
+
+    int height() const { return lineHeight; }
+
+    // Width in pixels `text` will occupy when drawn
+    int textWidth(const char* text) const {
+        if (!surface) return 0;
+        int pen = 0, right = 0, prev = -1;
+        for (const char* p = text; *p; p++) {
+            int g = glyphIndex((unsigned char)*p);
+            if (prev >= 0) pen += kerning[prev * GLYPH_COUNT + g];
+            if (pen + glyphs[g].src.w > right) right = pen + glyphs[g].src.w;
+            pen += glyphs[g].advance;
+            prev = g;
+        }
+        return pen > right ? pen : right;
+    }
+
+    // Queue `text` with its top-left corner at (x, y); drawn on the next flush()
+    void queueText(const char* text, int x, int y, SDL_Color color) {
+        if (!surface) return;
+        int pen = x, prev = -1;
+        for (const char* p = text; *p; p++) {
+            int g = glyphIndex((unsigned char)*p);
+            if (prev >= 0) pen += kerning[prev * GLYPH_COUNT + g];
+            if (glyphs[g].src.w > 0) {
+                AtlasQuad quad = {glyphs[g].src, pen, y, color};
+                quads.push_back(quad);
+            }
+            pen += glyphs[g].advance;
+            prev = g;
+        }
+    }
+
+    // Submit all queued text in a single draw call. Returns draw calls issued.
+    int flush(RenderBackend& backend) {
+        if (quads.empty()) return 0;
+        backend.drawQuads(*this, quads.data(), (int)quads.size());
+        quads.clear();
+        return 1;
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+// A histogram of latencies in fixed half-millisecond buckets up to 100 ms,
+// plus one bucket for anything slower. Adding a sample is a couple of
+// integer operations and never allocates, so it can run every frame; the
+// percentiles it reports are accurate to a bucket.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+
+class LatencyHistogram {
+private:
+    static const int BUCKETS = 200;              // Last one also takes overflow
+    static const int64_t BUCKET_NS = 500000;     // 0.5 ms
+
+    long long counts[BUCKETS];
+    long long samples;
+    int64_t totalNs;
+    int64_t maxNs;
+
+public:
+    LatencyHistogram() { clear(); }
+
+    void clear() {
+        std::fill(counts, counts + BUCKETS, 0LL);
+        samples = 0;
+        totalNs = 0;
+        maxNs = 0;
+    }
+
+    void add(int64_t ns) {
+        if (ns < 0) ns = 0;
+        int bucket = (int)std::min<int64_t>(ns / BUCKET_NS, BUCKETS - 1);
+        counts[bucket]++;
+        samples++;
+        totalNs += ns;
+        maxNs = std::max(maxNs, ns);
+    }
+
+    long long count() const { return samples; }
+    double meanMs() const { return samples > 0 ? totalNs / 1e6 / samples : 0; }
+    double maxMs() const { return maxNs / 1e6; }
+
+    // Upper edge of the bucket holding the `fraction` quantile, in ms
+    double percentileMs(double fraction) const {
+        if (samples == 0) return 0;
+        long long rank = (long long)(fraction * samples);
+        if (rank >= samples) rank = samples - 1;
+        long long seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen > rank) return i == BUCKETS - 1 ? maxMs() : (i + 1) * BUCKET_NS / 1e6;
+        }
+        return maxMs();
+    }
+
+    // Summary line, then one bar per bucket from the first sample to the
+    // last; long empty stretches (before an outlier) print as "..."
+    void print(std::ostream& out, const char* title) const {
+        char line[128];
+        snprintf(line, sizeof(line), "%s: %lld samples, mean %.2f ms, p50 %.1f, p90 %.1f, p99 %.1f, max %.2f",
+                 title, samples, meanMs(), percentileMs(0.5), percentileMs(0.9), percentileMs(0.99), maxMs());
+        out << line << "\n";
+        if (samples == 0) return;
+
+        int first = 0, last = BUCKETS - 1;
+        while (counts[first] == 0) first++;
+        while (counts[last] == 0) last--;
+        long long tallest = *std::max_element(counts + first, counts + last + 1);
+        const int BAR_WIDTH = 40;
+        for (int i = first; i <= last; i++) {
+            int empty = 0;
+            while (counts[i + empty] == 0) empty++;
+            if (empty > 2) {
+                out << "  ...\n";
+                i += empty - 1;
+                continue;
+            }
+            int width = (int)(counts[i] * BAR_WIDTH / tallest);
+            if (counts[i] > 0 && width == 0) width = 1;
+            snprintf(line, sizeof(line), "  %s%5.1f ms |%-*.*s %lld", i == BUCKETS - 1 ? ">=" : "  ",
+                     i * BUCKET_NS / 1e6, BAR_WIDTH, width, "########################################", counts[i]);
+            out << line << "\n";
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,478 @@
+#ifndef NET_PROTOCOL_H
+#define NET_PROTOCOL_H
+
+// Wire format for networked co-op (see net_session.h). Clients send their
+// input every tick; the server answers with the world after every tick as
+// a snapshot, delta-compressed against the newest snapshot the client has
+// acknowledged. Packets are bit-packed, least significant bit first:
+//
+//   HELLO     type 8, protocol version 16
+//   WELCOME   type 8, player index 8 (0xFF: server full), player count 8
+//   INPUT     type 8, acked snapshot tick 32, client time 32 (us),
+//             newest input sequence 32, count 4, then `count` inputs of
+//             3 bits, newest first (older ones repeat in case of loss)
+//   SNAPSHOT  type 8, tick 32, baseline tick 32 (0: none), echoed client
+//             time 32, time the echo was held 16 (us), then the world
+//   BYE       type 8
+//
+// A world is not a list of enemies. The formation is rebuilt from
+// FormationTables on the receiving side: level, pattern and path clock
+// pick the layout and every enemy's path offset, one march offset moves
+// them all, and a bitmask (one bit per layout slot) says who is alive. Its
+// size is bounded by the largest layout, not by how many enemies move.
+// Bullets are listed by pool slot; one the baseline already had is sent as
+// its error against straight-line motion since then, normally two bits.
+// Positions are quantized to quarter pixels. Unchanged fields cost one bit.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "simulation.h"
+#include "frame_snapshot.h"
+#include "formation_tables.h"
+
+const uint16_t NET_PROTOCOL_VERSION = 1;
+const int NET_HISTORY = 64;                // Snapshots kept as baselines, both ends (power of two)
+const int NET_INPUT_REDUNDANCY = 8;        // Inputs repeated in every INPUT packet
+const int NET_MAX_PACKET = 8192;
+const int NET_COORD_BITS = 13;             // Quarter pixels from NET_COORD_ORIGIN
+const float NET_COORD_ORIGIN = -256;
+const int NET_MAX_BULLETS = DEFAULT_BULLET_CAPACITY;
+const int NET_BULLET_SLOT_BITS = 9;        // Enough for NET_MAX_BULLETS slots
+const int NET_ALIVE_WORDS = (MAX_FORMATION_SIZE + 63) / 64;
+const uint8_t NET_SERVER_FULL = 0xFF;
+
+enum NetPacketType {
+    NET_HELLO = 1,
+    NET_WELCOME,
+    NET_INPUT,
+    NET_SNAPSHOT,
+    NET_BYE
+};
+
+// Appends bit fields to a byte buffer. Writing past the end sets
+// `overflow` instead.
+class BitWriter {
+private:
+    uint8_t* data;
+    size_t capacity;
+    size_t bitCount;
+
+public:
+    bool overflow;
+
+    BitWriter(uint8_t* buffer, size_t bytes) : data(buffer), capacity(bytes), bitCount(0), overflow(false) {
+        memset(data, 0, capacity);
+    }
+
+    // The low `count` bits of `value` (count <= 32)
+    void write(uint32_t value, int count) {
+        if (bitCount + count > capacity * 8) {
+            overflow = true;
+            return;
+        }
+        for (int done = 0; done < count; ) {
+            size_t byte = bitCount >> 3;
+            int shift = (int)(bitCount & 7);
+            int take = std::min(8 - shift, count - done);
+            data[byte] |= (uint8_t)(((value >> done) & ((1u << take) - 1)) << shift);
+            done += take;
+            bitCount += take;
+        }
+    }
+
+    void writeBool(bool value) { write(value ? 1 : 0, 1); }
+
+    // A change, in as few bits as its size allows: 0 in one bit, then
+    // 8, 16 or 32 bit two's complement behind a 2 or 3 bit prefix
+    void writeDelta(int32_t delta) {
+        if (delta == 0) {
+            write(0, 1);
+        } else if (delta >= -128 && delta < 128) {
+            write(1, 2);
+            write((uint32_t)delta, 8);
+        } else if (delta >= -32768 && delta < 32768) {
+            write(3, 3);
+            write((uint32_t)delta, 16);
+        } else {
+            write(7, 3);
+            write((uint32_t)delta, 32);
+        }
+    }
+
+    size_t bytes() const { return (bitCount + 7) / 8; }
+};
+
+// Reads what BitWriter wrote. Reading past the end returns zeros and sets
+// `overflow`.
+class BitReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t bitCount;
+
+public:
+    bool overflow;
+
+    BitReader(const uint8_t* buffer, size_t bytes) : data(buffer), size(bytes), bitCount(0), overflow(false) {}
+
+    uint32_t read(int count) {
+        if (bitCount + count > size * 8) {
+            overflow = true;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int done = 0; done < count; ) {
+            size_t byte = bitCount >> 3;
+            int shift = (int)(bitCount & 7);
+            int take = std::min(8 - shift, count - done);
+            value |= (uint32_t)((data[byte] >> shift) & ((1u << take) - 1)) << done;
+            done += take;
+            bitCount += take;
+        }
+        return value;
+    }
+
+    bool readBool() { return read(1) != 0; }
+
+    int32_t readDelta() {
+        if (!readBool()) return 0;
+        if (!readBool()) return (int8_t)read(8);
+        if (!readBool()) return (int16_t)read(16);
+        return (int32_t)read(32);
+    }
+};
+
+inline uint16_t quantizeCoord(float v) {
+    long q = lrintf((v - NET_COORD_ORIGIN) * 4);
+    return (uint16_t)std::max(0L, std::min(q, (long)(1 << NET_COORD_BITS) - 1));
+}
+
+inline float dequantizeCoord(uint32_t q) { return q * 0.25f + NET_COORD_ORIGIN; }
+
+struct NetPlayer {
+    uint16_t x, y;          // Quantized
+    uint8_t lives;
+    bool active;
+};
+
+struct NetBullet {
+    uint16_t slot;          // Pool slot, the bullet's id on the wire
+    uint32_t generation;    // Server side only: tells a reused slot from the same bullet
+    uint16_t x, y;          // Quantized
+    bool fromPlayer;
+};
+
+// One tick of the world as the protocol sees it
+struct NetWorld {
+    uint32_t tick;          // 0: empty, the baseline of a full snapshot
+    int32_t score;
+    uint16_t level;
+    uint8_t pattern;
+    uint8_t flags;          // 1 game over, 2 victory, 4 level transition
+    uint8_t playerCount;
+    uint16_t pathClock;
+    int32_t marchX, marchY; // Formation offset from its layout, in quarter pixels
+    NetPlayer players[MAX_PLAYERS];
+    uint64_t alive[NET_ALIVE_WORDS];   // By layout slot
+    int bulletCount;
+    NetBullet bullets[NET_MAX_BULLETS];   // In slot order
+
+    NetWorld() { clear(); }
+
+    void clear() {
+        tick = 0;
+        score = 0;
+        level = 0;
+        pattern = 0;
+        flags = 0;
+        playerCount = 0;
+        pathClock = 0;
+        marchX = marchY = 0;
+        memset(players, 0, sizeof(players));
+        memset(alive, 0, sizeof(alive));
+        bulletCount = 0;
+    }
+
+    // Slots in this world's layout, as far as the alive mask reaches
+    int layoutSize() const {
+        if (level == 0) return 0;
+        int size = (int)FormationTables::instance().layout((Pattern)pattern, level).size();
+        return std::min(size, NET_ALIVE_WORDS * 64);
+    }
+
+    bool isAlive(int slot) const { return (alive[slot >> 6] >> (slot & 63)) & 1; }
+
+    void capture(const Simulation& sim, uint32_t tickNumber) {
+        tick = tickNumber;
+        score = sim.score;
+        level = (uint16_t)std::min(sim.level, 0xFFFF);
+        pattern = (uint8_t)sim.currentPattern;
+        flags = (sim.gameOver ? 1 : 0) | (sim.victory ? 2 : 0) | (sim.levelTransition ? 4 : 0);
+        playerCount = (uint8_t)sim.players.size();
+        pathClock = (uint16_t)sim.pathClock;
+
+        for (int i = 0; i < playerCount; i++) {
+            const Player& player = sim.players[i];
+            players[i].x = quantizeCoord(coordToFloat(player.x));
+            players[i].y = quantizeCoord(coordToFloat(player.y));
+            players[i].lives = (uint8_t)std::max(0, std::min(player.lives, 255));
+            players[i].active = player.active;
+        }
+
+        // Every live slot has moved the same distance from its layout
+        // position, so any one of them gives the march offset
+        const EnemyFormation& enemies = sim.enemies;
+        const std::vector<FormationSlot>& layout = FormationTables::instance().layout(sim.currentPattern, sim.level);
+        int slots = layoutSize();
+        memset(alive, 0, sizeof(alive));
+        marchX = marchY = 0;
+        bool marchFound = false;
+        enemies.forEachAlive([&](int i) {
+            int slot = enemies.layoutSlot[i];
+            if (slot >= slots) return;
+            alive[slot >> 6] |= 1ULL << (slot & 63);
+            if (!marchFound) {
+                marchX = (int32_t)lrintf(coordToFloat(enemies.slotX[i] - layout[slot].x) * 4);
+                marchY = (int32_t)lrintf(coordToFloat(enemies.slotY[i] - layout[slot].y) * 4);
+                marchFound = true;
+            }
+        });
+
+        bulletCount = 0;
+        for (int i = 0; i < sim.bullets.size() && bulletCount < NET_MAX_BULLETS; i++) {
+            const Bullet& bullet = sim.bullets[i];
+            if (!bullet.active) continue;
+            BulletHandle handle = sim.bullets.handleAt(i);
+            NetBullet& out = bullets[bulletCount++];
+            out.slot = (uint16_t)handle.slot;
+            out.generation = handle.generation;
+            out.x = quantizeCoord(coordToFloat(bullet.x));
+            out.y = quantizeCoord(coordToFloat(bullet.y));
+            out.fromPlayer = bullet.fromPlayer;
+        }
+        std::sort(bullets, bullets + bulletCount,
+                  [](const NetBullet& a, const NetBullet& b) { return a.slot < b.slot; });
+    }
+
+    // Quarter pixels a bullet moves in `ticks` ticks
+    static int32_t bulletTravel(bool fromPlayer, uint32_t ticks) {
+        return (int32_t)ticks * 4 * (fromPlayer ? -BULLET_SPEED : ENEMY_BULLET_SPEED);
+    }
+
+    // Write this world as a change from `baseline`. The receiver must hold
+    // the same baseline (or none, when baseline.tick is 0).
+    void encode(const NetWorld& baseline, BitWriter& out) const {
+        out.writeBool(score != baseline.score);
+        if (score != baseline.score) out.write((uint32_t)score, 32);
+
+        bool metaChanged = level != baseline.level || pattern != baseline.pattern ||
+                           flags != baseline.flags || playerCount != baseline.playerCount;
+        out.writeBool(metaChanged);
+        if (metaChanged) {
+            out.write(level, 16);
+            out.write(pattern, 3);
+            out.write(flags, 3);
+            out.write(playerCount, 3);
+        }
+
+        out.writeBool(pathClock != baseline.pathClock);
+        if (pathClock != baseline.pathClock) out.write(pathClock, 10);
+        out.writeDelta(marchX - baseline.marchX);
+        out.writeDelta(marchY - baseline.marchY);
+
+        for (int i = 0; i < playerCount; i++) {
+            const NetPlayer& player = players[i];
+            const NetPlayer& before = baseline.players[i];
+            bool changed = player.x != before.x || player.y != before.y ||
+                           player.lives != before.lives || player.active != before.active;
+            out.writeBool(changed);
+            if (!changed) continue;
+            out.writeDelta(player.x - before.x);
+            out.writeDelta(player.y - before.y);
+            out.write(player.lives, 8);
+            out.writeBool(player.active);
+        }
+
+        // The mask is only valid against a baseline with the same layout
+        bool sameLayout = level == baseline.level && pattern == baseline.pattern;
+        bool aliveChanged = !sameLayout || memcmp(alive, baseline.alive, sizeof(alive)) != 0;
+        out.writeBool(aliveChanged);
+        if (aliveChanged) {
+            for (int slot = 0, n = layoutSize(); slot < n; slot++) out.writeBool(isAlive(slot));
+        }
+
+        // Both lists are in slot order, so one walk pairs them up
+        out.write((uint32_t)bulletCount, NET_BULLET_SLOT_BITS + 1);
+        uint32_t elapsed = tick - baseline.tick;
+        int b = 0;
+        for (int i = 0; i < bulletCount; i++) {
+            const NetBullet& bullet = bullets[i];
+            while (b < baseline.bulletCount && baseline.bullets[b].slot < bullet.slot) b++;
+            bool known = b < baseline.bulletCount && baseline.bullets[b].slot == bullet.slot &&
+                         baseline.bullets[b].generation == bullet.generation &&
+                         baseline.bullets[b].fromPlayer == bullet.fromPlayer;
+            out.write(bullet.slot, NET_BULLET_SLOT_BITS);
+            out.writeBool(known);
+            if (known) {
+                const NetBullet& before = baseline.bullets[b];
+                out.writeDelta(bullet.x - before.x);
+                out.writeDelta(bullet.y - (before.y + bulletTravel(bullet.fromPlayer, elapsed)));
+            } else {
+                out.writeBool(bullet.fromPlayer);
+                out.write(bullet.x, NET_COORD_BITS);
+                out.write(bullet.y, NET_COORD_BITS);
+            }
+        }
+    }
+
+    // Read a world written by encode() against the same `baseline`, as
+    // tick `tickNumber`. False if the packet was malformed.
+    bool decode(const NetWorld& baseline, uint32_t tickNumber, BitReader& in) {
+        tick = tickNumber;
+        score = in.readBool() ? (int32_t)in.read(32) : baseline.score;
+
+        if (in.readBool()) {
+            level = (uint16_t)in.read(16);
+            pattern = (uint8_t)in.read(3);
+            flags = (uint8_t)in.read(3);
+            playerCount = (uint8_t)in.read(3);
+            if (pattern > PATTERN_WAVE || playerCount > MAX_PLAYERS) return false;
+        } else {
+            level = baseline.level;
+            pattern = baseline.pattern;
+            flags = baseline.flags;
+            playerCount = baseline.playerCount;
+        }
+
+        pathClock = in.readBool() ? (uint16_t)in.read(10) : baseline.pathClock;
+        marchX = baseline.marchX + in.readDelta();
+        marchY = baseline.marchY + in.readDelta();
+
+        for (int i = 0; i < playerCount; i++) {
+            NetPlayer& player = players[i];
+            player = baseline.players[i];
+            if (!in.readBool()) continue;
+            player.x = (uint16_t)(player.x + in.readDelta());
+            player.y = (uint16_t)(player.y + in.readDelta());
+            player.lives = (uint8_t)in.read(8);
+            player.active = in.readBool();
+        }
+
+        if (in.readBool()) {
+            memset(alive, 0, sizeof(alive));
+            for (int slot = 0, n = layoutSize(); slot < n; slot++) {
+                if (in.readBool()) alive[slot >> 6] |= 1ULL << (slot & 63);
+            }
+        } else {
+            memcpy(alive, baseline.alive, sizeof(alive));
+        }
+
+        bulletCount = (int)in.read(NET_BULLET_SLOT_BITS + 1);
+        if (bulletCount > NET_MAX_BULLETS) return false;
+        uint32_t elapsed = tick - baseline.tick;
+        int b = 0;
+        for (int i = 0; i < bulletCount; i++) {
+            NetBullet& bullet = bullets[i];
+            bullet.slot = (uint16_t)in.read(NET_BULLET_SLOT_BITS);
+            bullet.generation = 0;
+            if (in.readBool()) {
+                while (b < baseline.bulletCount && baseline.bullets[b].slot < bullet.slot) b++;
+                if (b >= baseline.bulletCount || baseline.bullets[b].slot != bullet.slot) return false;
+                const NetBullet& before = baseline.bullets[b];
+                bullet.fromPlayer = before.fromPlayer;
+                bullet.x = (uint16_t)(before.x + in.readDelta());
+                bullet.y = (uint16_t)(before.y + bulletTravel(bullet.fromPlayer, elapsed) + in.readDelta());
+            } else {
+                bullet.fromPlayer = in.readBool();
+                bullet.x = (uint16_t)in.read(NET_COORD_BITS);
+                bullet.y = (uint16_t)in.read(NET_COORD_BITS);
+            }
+        }
+        return !in.overflow;
+    }
+
+    // Fill `frame` for the renderer, interpolating from `previous` (an
+    // older world, or this one if there is none). Enemy positions come
+    // from the layout, the march offset and the path, as the simulation
+    // computes them.
+    void toFrame(const NetWorld& previous, FrameSnapshot& frame) const {
+        frame.tick = tick;
+        frame.score = score;
+        frame.level = level;
+        frame.gameOver = (flags & 1) != 0;
+        frame.victory = (flags & 2) != 0;
+        frame.levelTransition = (flags & 4) != 0;
+        frame.currentPattern = (Pattern)pattern;
+
+        frame.playerCount = playerCount;
+        bool playersBefore = previous.playerCount == playerCount;
+        for (int i = 0; i < playerCount; i++) {
+            const NetPlayer& player = players[i];
+            const NetPlayer& before = playersBefore ? previous.players[i] : player;
+            FrameSnapshot::PlayerView& view = frame.players[i];
+            view.x = dequantizeCoord(player.x);
+            view.y = dequantizeCoord(player.y);
+            view.prevX = dequantizeCoord(before.x);
+            view.prevY = dequantizeCoord(before.y);
+            view.lives = player.lives;
+            view.active = player.active;
+        }
+
+        frame.enemyX.clear();
+        frame.enemyY.clear();
+        frame.enemyPrevX.clear();
+        frame.enemyPrevY.clear();
+        frame.enemyType.clear();
+        bool sameLayout = previous.level == level && previous.pattern == pattern;
+        for (int slot = 0, n = layoutSize(); slot < n; slot++) {
+            if (!isAlive(slot)) continue;
+            float x, y;
+            enemyPosition(slot, x, y);
+            float prevX = x, prevY = y;
+            if (sameLayout && previous.isAlive(slot)) previous.enemyPosition(slot, prevX, prevY);
+            frame.enemyX.push_back(x);
+            frame.enemyY.push_back(y);
+            frame.enemyPrevX.push_back(prevX);
+            frame.enemyPrevY.push_back(prevY);
+            frame.enemyType.push_back(FormationTables::instance().layout((Pattern)pattern, level)[slot].type);
+        }
+
+        // The client does not know bullet generations, so a bullet
+        // interpolates from the same slot in `previous` only if that one is
+        // exactly where this bullet would have been; otherwise it is new
+        frame.bullets.clear();
+        uint32_t elapsed = tick - previous.tick;
+        int b = 0;
+        for (int i = 0; i < bulletCount; i++) {
+            const NetBullet& bullet = bullets[i];
+            FrameSnapshot::BulletView view;
+            view.x = view.prevX = dequantizeCoord(bullet.x);
+            view.y = view.prevY = dequantizeCoord(bullet.y);
+            view.fromPlayer = bullet.fromPlayer;
+            while (b < previous.bulletCount && previous.bullets[b].slot < bullet.slot) b++;
+            if (b < previous.bulletCount && previous.bullets[b].slot == bullet.slot) {
+                const NetBullet& before = previous.bullets[b];
+                if (before.fromPlayer == bullet.fromPlayer && before.x == bullet.x &&
+                    before.y + bulletTravel(bullet.fromPlayer, elapsed) == bullet.y) {
+                    view.prevY = dequantizeCoord(before.y);
+                }
+            }
+            frame.bullets.push_back(view);
+        }
+    }
+
+private:
+    void enemyPosition(int slot, float& x, float& y) const {
+        const FormationTables& tables = FormationTables::instance();
+        const FormationSlot& layoutSlot = tables.layout((Pattern)pattern, level)[slot];
+        const FormationPath& path = tables.path((Pattern)pattern);
+        int scale = FormationTables::pathScale((Pattern)pattern, level);
+        int sample = (layoutSlot.phase + pathClock) & PATH_MASK;
+        x = layoutSlot.x + marchX * 0.25f + coordToFloat(path.offsetX(sample, scale));
+        y = layoutSlot.y + marchY * 0.25f + coordToFloat(path.offsetY(sample, scale));
+    }
+};
+
+#endif
@@ -0,0 +1,495 @@
+#ifndef NET_SESSION_H
+#define NET_SESSION_H
+
+// Networked co-op over UDP (wire format in net_protocol.h).
+//
+// NetServer owns the only Simulation. It waits until every player slot has
+// a client, then ticks at 60 Hz: each client's input for the tick goes in,
+// and the world that comes out is sent to each client as a snapshot
+// against the newest one that client has acknowledged. Worlds are kept for
+// NET_HISTORY ticks to serve as baselines; a client whose ack is older
+// than that (or who has none yet) gets a full snapshot.
+//
+// NetClient sends one input per tick, numbered, with the previous few
+// repeated so a lost packet costs nothing. The server plays each client's
+// inputs in order; when one has not arrived in time it holds the last
+// movement (without firing again) and catches up when it does. Snapshots
+// are decoded against the client's own copy of the baseline and turned
+// into FrameSnapshots for the usual renderer.
+//
+// Both ends count payload bytes per tick. RTT is measured by the client:
+// each input carries its send time, and each snapshot echoes the newest
+// one together with how long the server held it before replying.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "net_protocol.h"
+#include "net_socket.h"
+#include "simulation.h"
+#include "frame_snapshot.h"
+
+const int NET_TIMEOUT_MS = 3000;    // Silence after which a peer counts as gone
+
+inline int64_t netNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class NetServer {
+public:
+    struct ClientStats {
+        long long bytesSent;
+        long long snapshotsSent;
+        long long fullSnapshots;     // Sent without a baseline
+        long long inputsLate;        // Ticks played on a held input
+    };
+
+private:
+    struct Client {
+        bool connected;
+        NetAddress address;
+        int64_t lastHeardUs;
+
+        // Inputs by sequence number, NET_HISTORY deep
+        InputBits inputs[NET_HISTORY];
+        uint32_t inputSeqs[NET_HISTORY];
+        uint32_t nextSeq;            // Next input to play; 0 until the first arrives
+        uint32_t newestSeq;
+        InputBits held;              // Last input played
+
+        uint32_t ackTick;            // Newest snapshot the client has
+        uint32_t echoTime;           // Client time of its newest input
+        int64_t echoReceivedUs;      // When that input arrived here
+
+        ClientStats stats;
+    };
+
+    Simulation sim;
+    UdpSocket socket;
+    std::vector<Client> clients;     // One per player slot
+    std::vector<NetWorld> history;   // Worlds by tick % NET_HISTORY
+    NetWorld empty;
+    uint32_t tick;
+    bool started;
+    uint8_t packet[NET_MAX_PACKET];
+
+    int findClient(const NetAddress& address) const {
+        for (size_t i = 0; i < clients.size(); i++) {
+            if (clients[i].connected && clients[i].address == address) return (int)i;
+        }
+        return -1;
+    }
+
+    void welcome(const NetAddress& to, int index) {
+        BitWriter out(packet, sizeof(packet));
+        out.write(NET_WELCOME, 8);
+        out.write(index < 0 ? NET_SERVER_FULL : (uint32_t)index, 8);
+        out.write((uint32_t)clients.size(), 8);
+        socket.send(to, packet, out.bytes());
+    }
+
+    void onHello(const NetAddress& from, BitReader& in, int64_t nowUs) {
+        if (in.read(16) != NET_PROTOCOL_VERSION) return;
+        int index = findClient(from);
+        if (index < 0) {
+            for (size_t i = 0; i < clients.size() && index < 0; i++) {
+                if (!clients[i].connected) index = (int)i;
+            }
+            if (index >= 0) {
+                Client& client = clients[index];
+                memset(&client.stats, 0, sizeof(client.stats));
+                client.connected = true;
+                client.address = from;
+                client.nextSeq = client.newestSeq = 0;
+                client.held = 0;
+                client.ackTick = 0;
+                client.echoTime = 0;
+                for (int i = 0; i < NET_HISTORY; i++) client.inputSeqs[i] = 0;
+                std::cout << "Player " << index + 1 << " joined from " << from.toString() << std::endl;
+            }
+        }
+        if (index >= 0) clients[index].lastHeardUs = nowUs;
+        welcome(from, index);
+    }
+
+    void onInput(Client& client, BitReader& in, int64_t nowUs) {
+        uint32_t ack = in.read(32);
+        uint32_t sentTime = in.read(32);
+        uint32_t newest = in.read(32);
+        int count = (int)in.read(4);
+        if (in.overflow || newest < (uint32_t)count) return;
+        for (int i = 0; i < count; i++) {
+            uint32_t seq = newest - i;
+            InputBits bits = (InputBits)in.read(3);
+            if (seq == 0 || (client.nextSeq != 0 && seq < client.nextSeq)) continue;
+            client.inputs[seq & (NET_HISTORY - 1)] = bits;
+            client.inputSeqs[seq & (NET_HISTORY - 1)] = seq;
+        }
+        if (in.overflow) return;
+        if (client.nextSeq == 0) client.nextSeq = newest - count + 1;
+        if (newest > client.newestSeq) {
+            client.newestSeq = newest;
+            client.echoTime = sentTime;
+            client.echoReceivedUs = nowUs;
+        }
+        if (ack > client.ackTick && ack <= tick) client.ackTick = ack;
+    }
+
+    // Read every waiting packet
+    void receive() {
+        NetAddress from;
+        int size;
+        while ((size = socket.receive(from, packet, sizeof(packet))) > 0) {
+            int64_t nowUs = netNowUs();
+            BitReader in(packet, (size_t)size);
+            int type = (int)in.read(8);
+            if (type == NET_HELLO) {
+                onHello(from, in, nowUs);
+                continue;
+            }
+            int index = findClient(from);
+            if (index < 0) continue;
+            Client& client = clients[index];
+            client.lastHeardUs = nowUs;
+            if (type == NET_INPUT) {
+                onInput(client, in, nowUs);
+            } else if (type == NET_BYE) {
+                client.connected = false;
+                std::cout << "Player " << index + 1 << " left" << std::endl;
+            }
+        }
+    }
+
+    // Take in packets as they arrive until `deadline`, so inputs are
+    // stamped when they land rather than at the next tick
+    void receiveUntil(std::chrono::steady_clock::time_point deadline) {
+        for (;;) {
+            receive();
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= deadline) return;
+            long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            if (ms > 0) {
+                socket.wait((int)ms);
+            } else {
+                std::this_thread::sleep_until(deadline);
+            }
+        }
+    }
+
+    // The client's input for this tick. If it is late, keep moving the
+    // same way but don't fire again; if the client has got far ahead (we
+    // stalled), skip to its recent inputs rather than lag behind for good.
+    InputBits nextInput(Client& client) {
+        if (client.nextSeq == 0) return 0;
+        if (client.newestSeq >= client.nextSeq + NET_INPUT_REDUNDANCY) {
+            client.nextSeq = client.newestSeq - 1;
+        }
+        int at = client.nextSeq & (NET_HISTORY - 1);
+        if (client.inputSeqs[at] == client.nextSeq) {
+            client.held = client.inputs[at];
+            client.nextSeq++;
+            return client.held;
+        }
+        client.stats.inputsLate++;
+        return client.held & ~INPUT_FIRE;
+    }
+
+    void sendSnapshot(Client& client, const NetWorld& world, int64_t nowUs) {
+        const NetWorld& stored = history[client.ackTick & (NET_HISTORY - 1)];
+        bool hasBaseline = client.ackTick != 0 && world.tick - client.ackTick < (uint32_t)NET_HISTORY &&
+                           stored.tick == client.ackTick;
+        const NetWorld& baseline = hasBaseline ? stored : empty;
+
+        BitWriter out(packet, sizeof(packet));
+        out.write(NET_SNAPSHOT, 8);
+        out.write(world.tick, 32);
+        out.write(baseline.tick, 32);
+        out.write(client.echoTime, 32);
+        out.write((uint32_t)std::min<int64_t>(nowUs - client.echoReceivedUs, 0xFFFF), 16);
+        world.encode(baseline, out);
+        if (out.overflow) return;
+
+        socket.send(client.address, packet, out.bytes());
+        client.stats.bytesSent += out.bytes();
+        client.stats.snapshotsSent++;
+        if (!hasBaseline) client.stats.fullSnapshots++;
+    }
+
+    void printStats() const {
+        for (size_t i = 0; i < clients.size(); i++) {
+            const ClientStats& stats = clients[i].stats;
+            if (stats.snapshotsSent == 0) continue;
+            std::cout << "  player " << i + 1 << ": " << (double)stats.bytesSent / stats.snapshotsSent
+                      << " bytes/tick, " << stats.fullSnapshots << " full snapshots, "
+                      << stats.inputsLate << " late inputs" << std::endl;
+        }
+    }
+
+public:
+    NetServer(uint64_t seed, int playerCount, int startLevel, GameEventSink* events = nullptr)
+        : sim(seed, playerCount), clients(sim.players.size()), history(NET_HISTORY), tick(0), started(false) {
+        sim.events = events;
+        if (startLevel > 1) sim.startAtLevel(startLevel);
+        for (Client& client : clients) {
+            client.connected = false;
+            client.lastHeardUs = 0;
+        }
+    }
+
+    bool open(int port) {
+        if (socket.open(port)) return true;
+        std::cerr << "Server: " << socket.lastError() << std::endl;
+        return false;
+    }
+
+    const Simulation& simulation() const { return sim; }
+    const ClientStats& stats(int player) const { return clients[player].stats; }
+
+    // Serve until `frames` ticks have run or every player has left
+    void run(long long frames) {
+        const std::chrono::microseconds tickLength(1000000 / SIM_TICKS_PER_SECOND);
+        const int STATS_INTERVAL = 5 * SIM_TICKS_PER_SECOND;
+        InputBits inputs[MAX_PLAYERS] = {0};
+
+        std::cout << "Waiting for " << clients.size() << " player(s)" << std::endl;
+        std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now();
+        while ((long long)tick < frames) {
+            receiveUntil(due);
+            due += tickLength;
+
+            // Clients send an input every tick, from the lobby on, so silence
+            // means they are gone; a slot freed in the lobby can be joined again
+            int64_t nowUs = netNowUs();
+            int connected = 0;
+            for (size_t i = 0; i < clients.size(); i++) {
+                Client& client = clients[i];
+                if (client.connected && nowUs - client.lastHeardUs > NET_TIMEOUT_MS * 1000LL) {
+                    client.connected = false;
+                    std::cout << "Player " << i + 1 << " timed out" << std::endl;
+                }
+                if (client.connected) connected++;
+            }
+            if (!started) {
+                if (connected < (int)clients.size()) continue;
+                started = true;
+                std::cout << "All players in, starting" << std::endl;
+            } else if (connected == 0) {
+                std::cout << "Everyone left" << std::endl;
+                break;
+            }
+
+            for (size_t i = 0; i < clients.size(); i++) {
+                inputs[i] = clients[i].connected ? nextInput(clients[i]) : 0;
+            }
+            sim.step(inputs);
+            tick++;
+
+            NetWorld& world = history[tick & (NET_HISTORY - 1)];
+            world.capture(sim, tick);
+            for (Client& client : clients) {
+                if (client.connected) sendSnapshot(client, world, nowUs);
+            }
+
+            if (tick % STATS_INTERVAL == 0) {
+                std::cout << "Tick " << tick << ": score " << sim.score << ", level " << sim.level << std::endl;
+                printStats();
+            }
+        }
+
+        std::cout << "Server stopped after " << tick << " ticks. Final score: " << sim.score
+                  << " Level: " << sim.level << std::endl;
+        printStats();
+    }
+};
+
+class NetClient {
+private:
+    UdpSocket socket;
+    NetAddress server;
+    std::vector<NetWorld> worlds;    // Received worlds by tick % NET_HISTORY
+    NetWorld empty;
+    uint32_t latestTick;             // Newest world received (0: none)
+    uint32_t previousTick;           // The one before it, for interpolation
+    InputBits inputs[NET_HISTORY];   // Sent inputs by sequence number
+    uint32_t inputSeq;
+    int player;
+    int playerTotal;
+    uint8_t packet[NET_MAX_PACKET];
+
+    long long bytesReceived;
+    long long snapshotsReceived;
+    long long snapshotsDropped;      // Stale, or their baseline was gone
+    uint32_t lastEcho;
+    long long rttSamples;
+    double rttSumMs, rttMaxMs, rttLastMs;
+
+    const NetWorld* stored(uint32_t tick) const {
+        if (tick == 0) return &empty;
+        const NetWorld& world = worlds[tick & (NET_HISTORY - 1)];
+        return world.tick == tick ? &world : nullptr;
+    }
+
+    void onSnapshot(BitReader& in, int size) {
+        uint32_t tick = in.read(32);
+        uint32_t baselineTick = in.read(32);
+        uint32_t echo = in.read(32);
+        uint32_t heldUs = in.read(16);
+        bytesReceived += size;
+
+        const NetWorld* baseline = stored(baselineTick);
+        if (in.overflow || tick <= latestTick || !baseline) {
+            snapshotsDropped++;
+            return;
+        }
+        // Baselines are less than NET_HISTORY ticks old, so this never
+        // overwrites the one being decoded against
+        NetWorld& world = worlds[tick & (NET_HISTORY - 1)];
+        if (!world.decode(*baseline, tick, in)) {
+            world.tick = 0;
+            snapshotsDropped++;
+            return;
+        }
+        previousTick = latestTick;
+        latestTick = tick;
+        snapshotsReceived++;
+
+        if (echo != 0 && echo != lastEcho) {
+            lastEcho = echo;
+            double rtt = ((uint32_t)netNowUs() - echo - heldUs) / 1000.0;
+            rttLastMs = rtt;
+            rttSumMs += rtt;
+            if (rtt > rttMaxMs) rttMaxMs = rtt;
+            rttSamples++;
+        }
+    }
+
+public:
+    NetClient()
+        : worlds(NET_HISTORY), latestTick(0), previousTick(0), inputSeq(0), player(-1), playerTotal(0),
+          bytesReceived(0), snapshotsReceived(0), snapshotsDropped(0), lastEcho(0), rttSamples(0),
+          rttSumMs(0), rttMaxMs(0), rttLastMs(0) {}
+
+    // Say hello until the server answers or `timeoutMs` passes
+    bool connect(const NetAddress& address, int timeoutMs) {
+        server = address;
+        if (!socket.open(0)) {
+            std::cerr << "Client: " << socket.lastError() << std::endl;
+            return false;
+        }
+        int64_t giveUp = netNowUs() + timeoutMs * 1000LL;
+        int64_t nextHello = 0;
+        while (netNowUs() < giveUp) {
+            if (netNowUs() >= nextHello) {
+                BitWriter out(packet, sizeof(packet));
+                out.write(NET_HELLO, 8);
+                out.write(NET_PROTOCOL_VERSION, 16);
+                socket.send(server, packet, out.bytes());
+                nextHello = netNowUs() + 100000;
+            }
+            NetAddress from;
+            int size = socket.receive(from, packet, sizeof(packet));
+            if (size > 0 && from == server) {
+                BitReader in(packet, (size_t)size);
+                if (in.read(8) == NET_WELCOME) {
+                    int index = (int)in.read(8);
+                    playerTotal = (int)in.read(8);
+                    if (index == NET_SERVER_FULL) {
+                        std::cerr << "Server " << server.toString() << " is full" << std::endl;
+                        return false;
+                    }
+                    player = index;
+                    return true;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::cerr << "No answer from " << server.toString() << std::endl;
+        return false;
+    }
+
+    void disconnect() {
+        if (!socket.isOpen()) return;
+        BitWriter out(packet, sizeof(packet));
+        out.write(NET_BYE, 8);
+        for (int i = 0; i < 3; i++) socket.send(server, packet, out.bytes());
+        socket.close();
+    }
+
+    // This tick's input, sent with the last few before it
+    void sendInput(InputBits bits) {
+        inputSeq++;
+        inputs[inputSeq & (NET_HISTORY - 1)] = bits;
+        int count = (int)std::min<uint32_t>(inputSeq, NET_INPUT_REDUNDANCY);
+
+        BitWriter out(packet, sizeof(packet));
+        out.write(NET_INPUT, 8);
+        out.write(latestTick, 32);
+        out.write((uint32_t)netNowUs(), 32);
+        out.write(inputSeq, 32);
+        out.write((uint32_t)count, 4);
+        for (int i = 0; i < count; i++) out.write(inputs[(inputSeq - i) & (NET_HISTORY - 1)], 3);
+        socket.send(server, packet, out.bytes());
+    }
+
+    // Take in every waiting snapshot. True if a newer world arrived.
+    bool poll() {
+        uint32_t before = latestTick;
+        NetAddress from;
+        int size;
+        while ((size = socket.receive(from, packet, sizeof(packet))) > 0) {
+            if (from != server) continue;
+            BitReader in(packet, (size_t)size);
+            if (in.read(8) == NET_SNAPSHOT) onSnapshot(in, size);
+        }
+        return latestTick != before;
+    }
+
+    // Take in snapshots as they arrive, until a newer world has or
+    // `deadline` passes. True if one did. Waiting on the socket rather than
+    // sleeping means a world is seen (and RTT measured) when it lands, not
+    // at the next tick.
+    bool waitForWorld(std::chrono::steady_clock::time_point deadline) {
+        for (;;) {
+            if (poll()) return true;
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= deadline) return false;
+            long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            if (ms > 0) {
+                socket.wait((int)ms);
+            } else {
+                std::this_thread::sleep_until(deadline);
+            }
+        }
+    }
+
+    bool hasWorld() const { return latestTick != 0; }
+    const NetWorld& latest() const { return *stored(latestTick); }
+
+    // The newest world for the renderer, interpolating from the one before
+    void fillFrame(FrameSnapshot& frame, int64_t dueNs) const {
+        const NetWorld& world = latest();
+        const NetWorld* previous = stored(previousTick);
+        world.toFrame(previous ? *previous : world, frame);
+        frame.tickDueNs = dueNs;
+        frame.inputNs = 0;
+        frame.hasSimStats = false;
+    }
+
+    int playerIndex() const { return player; }
+    int playerCount() const { return playerTotal; }
+
+    void printStats() const {
+        std::cout << "Received " << snapshotsReceived << " snapshots, "
+                  << (snapshotsReceived ? (double)bytesReceived / snapshotsReceived : 0) << " bytes/tick, "
+                  << snapshotsDropped << " dropped" << std::endl;
+        if (rttSamples > 0) {
+            std::cout << "RTT: avg " << rttSumMs / rttSamples << " ms, max " << rttMaxMs
+                      << " ms, last " << rttLastMs << " ms" << std::endl;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef NET_SOCKET_H
+#define NET_SOCKET_H
+
+// A non-blocking UDP socket over POSIX sockets, just enough for the
+// loopback client/server in net_session.h: bind, send a datagram to an
+// address, and receive whatever has arrived without waiting.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// An IPv4 address and port
+struct NetAddress {
+    sockaddr_in addr;
+
+    NetAddress() { memset(&addr, 0, sizeof(addr)); }
+
+    bool operator==(const NetAddress& other) const {
+        return addr.sin_addr.s_addr == other.addr.sin_addr.s_addr && addr.sin_port == other.addr.sin_port;
+    }
+    bool operator!=(const NetAddress& other) const { return !(*this == other); }
+
+    // "host:port" or just "port" (meaning localhost); false if it does not resolve
+    static bool parse(const char* text, NetAddress& out) {
+        std::string host = "127.0.0.1";
+        std::string port = text;
+        size_t colon = port.rfind(':');
+        if (colon != std::string::npos) {
+            host = port.substr(0, colon);
+            port = port.substr(colon + 1);
+        }
+        int number = atoi(port.c_str());
+        if (number <= 0 || number > 65535) return false;
+
+        addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* found = nullptr;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &found) != 0 || !found) return false;
+        out.addr = *(const sockaddr_in*)found->ai_addr;
+        out.addr.sin_port = htons((uint16_t)number);
+        freeaddrinfo(found);
+        return true;
+    }
+
+    std::string toString() const {
+        char text[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr.sin_addr, text, sizeof(text));
+        return std::string(text) + ":" + std::to_string(ntohs(addr.sin_port));
+    }
+};
+
+class UdpSocket {
+private:
+    int fd;
+    std::string error;
+
+    bool fail(const char* what) {
+        error = std::string(what) + ": " + strerror(errno);
+        close();
+        return false;
+    }
+
+public:
+    UdpSocket() : fd(-1) {}
+    ~UdpSocket() { close(); }
+
+    // Open a socket bound to `port` on every interface (0: any free port)
+    bool open(int port) {
+        close();
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) return fail("socket");
+        sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons((uint16_t)port);
+        if (bind(fd, (const sockaddr*)&local, sizeof(local)) < 0) return fail("bind");
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return fail("fcntl");
+        return true;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+    const std::string& lastError() const { return error; }
+
+    // Send one datagram; false if it was not handed to the network
+    bool send(const NetAddress& to, const uint8_t* data, size_t size) {
+        if (fd < 0) return false;
+        ssize_t sent = sendto(fd, data, size, 0, (const sockaddr*)&to.addr, sizeof(to.addr));
+        return sent == (ssize_t)size;
+    }
+
+    // Block until a datagram is waiting or `timeoutMs` passes; true if one is
+    bool wait(int timeoutMs) {
+        if (fd < 0) return false;
+        pollfd waiting = {fd, POLLIN, 0};
+        return ::poll(&waiting, 1, timeoutMs) > 0;
+    }
+
+    // The next waiting datagram, or -1 if there is none
+    int receive(NetAddress& from, uint8_t* data, size_t capacity) {
+        if (fd < 0) return -1;
+        socklen_t length = sizeof(from.addr);
+        ssize_t got = recvfrom(fd, data, capacity, 0, (sockaddr*)&from.addr, &length);
+        return got < 0 ? -1 : (int)got;
+    }
+};
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+// Explosion, debris and muzzle-flash particles. They are only for show:
+// they live on the render side, spawned from the simulation's gameplay
+// events, and never feed back into the game state, so ticks, snapshots and
+// replays are exactly as without them.
+//
+// Particles are stored as parallel arrays with a fixed capacity allocated
+// up front, live ones packed at the front. update() integrates them with
+// SIMD (whichever set simd_config.h picked) and then squeezes out the dead
+// in one pass; draw() culls to the screen, writes a sprite-atlas quad for
+// each of the rest into a buffer of its own and submits them all as one
+// batch. Spawning past the budget drops particles instead of growing.
+// Culling is branch-free, since positions are random.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "game_events.h"
+#include "game_types.h"
+#include "simd_config.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+#include "sprite_atlas.h"
+
+// Carries the events that make particles from the simulation thread to
+// the render thread. record() is a queue push; if the renderer has fallen
+// behind far enough to fill the queue, the effect is skipped.
+class ParticleFeed : public GameEventSink {
+private:
+    SpscQueue<GameEvent> queue;
+
+public:
+    explicit ParticleFeed(int capacity = 4096) : queue(capacity) {}
+
+    void record(const GameEvent& event) override {
+        if (event.type == EVENT_SHOT || event.type == EVENT_ENEMY_SHOT ||
+            event.type == EVENT_KILL || event.type == EVENT_PLAYER_HIT) {
+            queue.push(event);
+        }
+    }
+
+    bool pop(GameEvent& event) { return queue.pop(event); }
+};
+
+class ParticleSystem {
+public:
+    static const int DEFAULT_CAPACITY = 1 << 17;
+
+private:
+    static constexpr float GRAVITY = 240.0f;     // px/s^2, pulling debris down
+    static constexpr float DRAG = 1.5f;          // Fraction of speed lost per second
+
+    std::vector<float> x, y, vx, vy;
+    std::vector<float> life;                    // Seconds left
+    std::vector<float> fade;                    // 1 / starting life
+    std::vector<SDL_Color> color;               // Alpha is set from life when drawn
+    std::vector<uint8_t> sprite;                // SpriteAtlas::Sprite
+    std::vector<AtlasQuad> quads;               // One per particle, filled by draw()
+    int count;
+    int capacity;
+    long long dropped;                          // Particles refused for lack of room
+    Rng rng;
+
+    float uniform(float lo, float hi) {
+        return lo + (hi - lo) * (float)(rng.next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // `n` particles from (cx, cy), heading within `spread` radians of
+    // `angle` (0 is right, pi/2 down) at speeds in [speedLo, speedHi]
+    void burst(float cx, float cy, int n, float angle, float spread, float speedLo, float speedHi,
+               float lifeLo, float lifeHi, SDL_Color tint, SpriteAtlas::Sprite shape) {
+        for (int k = 0; k < n; k++) {
+            if (count == capacity) {
+                dropped += n - k;
+                return;
+            }
+            float heading = angle + uniform(-spread, spread);
+            float speed = uniform(speedLo, speedHi);
+            float seconds = uniform(lifeLo, lifeHi);
+            int i = count++;
+            x[i] = cx;
+            y[i] = cy;
+            vx[i] = std::cos(heading) * speed;
+            vy[i] = std::sin(heading) * speed;
+            life[i] = seconds;
+            fade[i] = 1.0f / seconds;
+            color[i] = tint;
+            sprite[i] = (uint8_t)shape;
+        }
+    }
+
+    // Drop dead particles, moving the last live one into each hole so the
+    // cost follows the deaths rather than the pool size. Draw order among
+    // particles doesn't matter.
+    void compact() {
+        float* px = x.data();
+        float* py = y.data();
+        float* pvx = vx.data();
+        float* pvy = vy.data();
+        float* pl = life.data();
+        float* pf = fade.data();
+        SDL_Color* pc = color.data();
+        uint8_t* ps = sprite.data();
+        int n = count;
+        for (int i = 0; i < n;) {
+            if (pl[i] > 0) {
+                i++;
+                continue;
+            }
+            n--;
+            px[i] = px[n];
+            py[i] = py[n];
+            pvx[i] = pvx[n];
+            pvy[i] = pvy[n];
+            pl[i] = pl[n];
+            pf[i] = pf[n];
+            pc[i] = pc[n];
+            ps[i] = ps[n];
+        }
+        count = n;
+    }
+
+public:
+    explicit ParticleSystem(int particleCapacity = DEFAULT_CAPACITY, uint64_t seed = 1)
+        : x(particleCapacity), y(particleCapacity), vx(particleCapacity), vy(particleCapacity),
+          life(particleCapacity), fade(particleCapacity), color(particleCapacity), sprite(particleCapacity),
+          quads(particleCapacity), count(0), capacity(particleCapacity), dropped(0), rng(seed) {}
+
+    // The effect for a gameplay event, if it has one
+    void spawn(const GameEvent& event) {
+        const float PI = 3.14159265f;
+        SDL_Color white = {255, 255, 255, 255};
+        switch (event.type) {
+            case EVENT_KILL: {
+                float cx = event.x + ENEMY_WIDTH / 2.0f, cy = event.y + ENEMY_HEIGHT / 2.0f;
+                SDL_Color tint = SpriteAtlas::enemyColor(event.enemyType);
+                burst(cx, cy, 48, 0, PI, 40, 220, 0.3f, 0.8f, tint, SpriteAtlas::SPRITE_SPARK);
+                burst(cx, cy, 16, -PI / 2, PI / 2, 60, 160, 0.6f, 1.2f, tint, SpriteAtlas::SPRITE_DEBRIS);
+                burst(cx, cy, 12, 0, PI, 20, 80, 0.1f, 0.25f, white, SpriteAtlas::SPRITE_SPARK);
+                break;
+            }
+            case EVENT_PLAYER_HIT: {
+                float cx = event.x + PLAYER_WIDTH / 2.0f, cy = event.y + PLAYER_HEIGHT / 2.0f;
+                SDL_Color green = {0, 255, 0, 255};
+                burst(cx, cy, 96, -PI / 2, PI * 0.6f, 80, 300, 0.8f, 1.6f, green, SpriteAtlas::SPRITE_DEBRIS);
+                burst(cx, cy, 64, 0, PI, 60, 260, 0.2f, 0.6f, white, SpriteAtlas::SPRITE_SPARK);
+                break;
+            }
+            case EVENT_SHOT: {
+                SDL_Color flash = {255, 255, 160, 255};
+                float cx = event.x + BULLET_WIDTH / 2.0f;
+                burst(cx, (float)event.y, 8, -PI / 2, 0.5f, 60, 200, 0.05f, 0.12f, flash,
+                      SpriteAtlas::SPRITE_SPARK);
+                break;
+            }
+            case EVENT_ENEMY_SHOT: {
+                SDL_Color flash = {255, 0, 255, 255};
+                float cx = event.x + BULLET_WIDTH / 2.0f;
+                burst(cx, (float)event.y, 4, PI / 2, 0.6f, 30, 100, 0.05f, 0.1f, flash,
+                      SpriteAtlas::SPRITE_SPARK);
+                break;
+            }
+        }
+    }
+
+    // Advance every particle by `dt` seconds and remove the expired
+    void update(float dt) {
+        const float damping = std::max(0.0f, 1.0f - DRAG * dt);
+        const float fall = GRAVITY * dt;
+        float* px = x.data();
+        float* py = y.data();
+        float* pvx = vx.data();
+        float* pvy = vy.data();
+        float* pl = life.data();
+        int i = 0;
+
+#if defined(SI_SIMD_AVX2)
+        const __m256 vdamp = _mm256_set1_ps(damping), vfall = _mm256_set1_ps(fall), vdt = _mm256_set1_ps(dt);
+        for (; i + 8 <= count; i += 8) {
+            __m256 svx = _mm256_mul_ps(_mm256_loadu_ps(pvx + i), vdamp);
+            __m256 svy = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(pvy + i), vdamp), vfall);
+            _mm256_storeu_ps(pvx + i, svx);
+            _mm256_storeu_ps(pvy + i, svy);
+            _mm256_storeu_ps(px + i, _mm256_add_ps(_mm256_loadu_ps(px + i), _mm256_mul_ps(svx, vdt)));
+            _mm256_storeu_ps(py + i, _mm256_add_ps(_mm256_loadu_ps(py + i), _mm256_mul_ps(svy, vdt)));
+            _mm256_storeu_ps(pl + i, _mm256_sub_ps(_mm256_loadu_ps(pl + i), vdt));
+        }
+#elif defined(SI_SIMD_SSE2)
+        const __m128 vdamp = _mm_set1_ps(damping), vfall = _mm_set1_ps(fall), vdt = _mm_set1_ps(dt);
+        for (; i + 4 <= count; i += 4) {
+            __m128 svx = _mm_mul_ps(_mm_loadu_ps(pvx + i), vdamp);
+            __m128 svy = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(pvy + i), vdamp), vfall);
+            _mm_storeu_ps(pvx + i, svx);
+            _mm_storeu_ps(pvy + i, svy);
+            _mm_storeu_ps(px + i, _mm_add_ps(_mm_loadu_ps(px + i), _mm_mul_ps(svx, vdt)));
+            _mm_storeu_ps(py + i, _mm_add_ps(_mm_loadu_ps(py + i), _mm_mul_ps(svy, vdt)));
+            _mm_storeu_ps(pl + i, _mm_sub_ps(_mm_loadu_ps(pl + i), vdt));
+        }
+#elif defined(SI_SIMD_NEON)
+        const float32x4_t vdamp = vdupq_n_f32(damping), vfall = vdupq_n_f32(fall), vdt = vdupq_n_f32(dt);
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t svx = vmulq_f32(vld1q_f32(pvx + i), vdamp);
+            float32x4_t svy = vaddq_f32(vmulq_f32(vld1q_f32(pvy + i), vdamp), vfall);
+            vst1q_f32(pvx + i, svx);
+            vst1q_f32(pvy + i, svy);
+            vst1q_f32(px + i, vaddq_f32(vld1q_f32(px + i), vmulq_f32(svx, vdt)));
+            vst1q_f32(py + i, vaddq_f32(vld1q_f32(py + i), vmulq_f32(svy, vdt)));
+            vst1q_f32(pl + i, vsubq_f32(vld1q_f32(pl + i), vdt));
+        }
+#endif
+
+        for (; i < count; i++) {
+            pvx[i] *= damping;
+            pvy[i] = pvy[i] * damping + fall;
+            px[i] += pvx[i] * dt;
+            py[i] += pvy[i] * dt;
+            pl[i] -= dt;
+        }
+        compact();
+    }
+
+    // Draw every on-screen particle from `sprites` in one drawQuads call,
+    // each fading out over the last two thirds of its life. Returns the
+    // draw calls issued.
+    int draw(SpriteAtlas& sprites, RenderBackend& backend) {
+        const SDL_Rect cells[2] = {sprites.cell(SpriteAtlas::SPRITE_SPARK), sprites.cell(SpriteAtlas::SPRITE_DEBRIS)};
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            float sx = x[i], sy = y[i];
+            float strength = std::min(1.0f, life[i] * fade[i] * 1.5f);
+            AtlasQuad& quad = quads[n];
+            quad.src = cells[sprite[i] == SpriteAtlas::SPRITE_DEBRIS];
+            quad.x = (int)sx;
+            quad.y = (int)sy;
+            quad.color = color[i];
+            quad.color.a = (Uint8)(strength * 255);
+            n += (sx > -4) & (sy > -4) & (sx < SCREEN_WIDTH) & (sy < SCREEN_HEIGHT);
+        }
+        if (n == 0 || !sprites.pixels()) return 0;
+        backend.drawQuads(sprites, quads.data(), n);
+        return 1;
+    }
+
+    void clear() { count = 0; }
+    int size() const { return count; }
+    int budget() const { return capacity; }
+    long long droppedParticles() const { return dropped; }
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Per-phase frame profiler. PROFILE_SCOPE(phase) times the rest of the
+// enclosing block and adds it to that phase's total for the current frame;
+// endFrame() pushes the totals into a rolling history from which the
+// overlay reads min/avg/p99. Frames in a chosen range can also be kept as
+// Chrome trace_event records and written out as JSON (open the file in
+// chrome://tracing or Perfetto).
+//
+// Scopes only read the clock while the profiler is active, and they compile
+// out entirely when NDEBUG or SI_NO_PROFILE is defined (`make release`).
+// No SDL here, so the simulation can be profiled headless too.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if !defined(NDEBUG) && !defined(SI_NO_PROFILE)
+#define SI_PROFILE 1
+#endif
+
+enum ProfilePhase {
+    PHASE_INPUT,
+    PHASE_UPDATE_ENEMIES,
+    PHASE_UPDATE_BULLETS,
+    PHASE_COLLISIONS,
+    PHASE_PARTICLES,   // Spawning and integrating effect particles
+    PHASE_DRAW_ENTITIES,
+    PHASE_DRAW_UI,
+    PHASE_DRAW_OVERLAY,
+    PHASE_CAPTURE,     // Frame readback for --capture
+    PHASE_PRESENT,
+    PHASE_PACING,
+    PHASE_FRAME,       // Whole frame, from beginFrame() to endFrame()
+    PHASE_COUNT
+};
+
+inline const char* profilePhaseName(ProfilePhase phase) {
+    switch(phase) {
+        case PHASE_INPUT: return "input";
+        case PHASE_UPDATE_ENEMIES: return "updateEnemies";
+        case PHASE_UPDATE_BULLETS: return "updateBullets";
+        case PHASE_COLLISIONS: return "checkCollisions";
+        case PHASE_PARTICLES: return "particles";
+        case PHASE_DRAW_ENTITIES: return "drawEntities";
+        case PHASE_DRAW_UI: return "drawUI";
+        case PHASE_DRAW_OVERLAY: return "drawOverlay";
+        case PHASE_CAPTURE: return "capture";
+        case PHASE_PRESENT: return "present";
+        case PHASE_PACING: return "pacing";
+        case PHASE_FRAME: return "frame";
+        default: return "unknown";
+    }
+}
+
+struct PhaseStats {
+    double minMs, avgMs, p99Ms;
+    int samples;
+};
+
+class Profiler {
+private:
+    typedef std::chrono::steady_clock Clock;
+    static const int HISTORY = 240;             // Frames kept for stats, 4 s at 60 fps
+    static const int MAX_TRACE_EVENTS = 1 << 20;
+
+    struct TraceEvent {
+        int64_t start, duration;  // ns since the profiler was created
+        int phase;
+    };
+
+    Clock::time_point origin;
+    bool active;
+    long long frame;                    // Index of the current frame
+    int64_t frameStart;
+    int64_t frameTotals[PHASE_COUNT];   // ns spent in each phase this frame
+    float history[PHASE_COUNT][HISTORY];// Per-frame ms, a ring per phase
+    int historyCount, historyNext;
+
+    std::string tracePath;
+    long long traceFirst, traceLast;    // Inclusive frame range to trace
+    std::vector<TraceEvent> traceEvents;
+    long long traceDropped;
+    bool traceWritten;
+
+    bool tracing() const {
+        return !tracePath.empty() && frame >= traceFirst && frame <= traceLast;
+    }
+
+public:
+    Profiler()
+        : origin(Clock::now()), active(false), frame(0), frameStart(0),
+          historyCount(0), historyNext(0), traceFirst(0), traceLast(-1),
+          traceDropped(0), traceWritten(false) {
+        std::fill(frameTotals, frameTotals + PHASE_COUNT, 0);
+    }
+
+    // Scopes record nothing (and skip the clock) while inactive
+    void setActive(bool on) { active = on; }
+    bool isActive() const { return active; }
+    long long frameIndex() const { return frame; }
+
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+    }
+
+    void beginFrame() {
+        if (!active) return;
+        std::fill(frameTotals, frameTotals + PHASE_COUNT, 0);
+        frameStart = now();
+    }
+
+    void record(ProfilePhase phase, int64_t start, int64_t end) {
+        frameTotals[phase] += end - start;
+        if (tracing()) {
+            if ((int)traceEvents.size() < MAX_TRACE_EVENTS) {
+                TraceEvent event = {start, end - start, (int)phase};
+                traceEvents.push_back(event);
+            } else {
+                traceDropped++;
+            }
+        }
+    }
+
+    // Close the frame: store its phase totals and write the trace once the
+    // last traced frame is done
+    void endFrame() {
+        if (!active) return;
+        record(PHASE_FRAME, frameStart, now());
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            history[p][historyNext] = (float)(frameTotals[p] / 1e6);
+        }
+        historyNext = (historyNext + 1) % HISTORY;
+        if (historyCount < HISTORY) historyCount++;
+
+        if (!tracePath.empty() && frame == traceLast) writeTrace();
+        frame++;
+    }
+
+    // Min/avg/p99 of a phase's per-frame time over the recent history
+    PhaseStats stats(ProfilePhase phase) const {
+        PhaseStats s = {0, 0, 0, historyCount};
+        if (historyCount == 0) return s;
+
+        float sorted[HISTORY];
+        std::copy(history[phase], history[phase] + historyCount, sorted);
+        double sum = 0;
+        for (int i = 0; i < historyCount; i++) sum += sorted[i];
+        int p99 = (historyCount * 99 + 99) / 100 - 1;
+        std::nth_element(sorted, sorted + p99, sorted + historyCount);
+        s.minMs = *std::min_element(sorted, sorted + historyCount);
+        s.avgMs = sum / historyCount;
+        s.p99Ms = sorted[p99];
+        return s;
+    }
+
+    // Keep trace events for frames first..last and write them to `path`
+    // after frame `last` (or from writeTrace() if the run ends first)
+    void traceFrames(const std::string& path, long long first, long long last) {
+        tracePath = path;
+        traceFirst = first;
+        traceLast = last;
+        traceEvents.clear();
+        long long frames = last - first + 1;
+        traceEvents.reserve((size_t)std::min<long long>(frames * 32, MAX_TRACE_EVENTS));
+        traceWritten = false;
+    }
+
+    // Write the Chrome trace_event JSON; only the first call writes
+    bool writeTrace() {
+        if (tracePath.empty() || traceWritten) return false;
+        traceWritten = true;
+
+        FILE* file = fopen(tracePath.c_str(), "w");
+        if (!file) return false;
+        fprintf(file, "{\"traceEvents\": [\n");
+        fprintf(file, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, "
+                      "\"args\": {\"name\": \"game loop\"}}");
+        for (const TraceEvent& event : traceEvents) {
+            fprintf(file, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+                          "\"ts\": %.3f, \"dur\": %.3f}",
+                    profilePhaseName((ProfilePhase)event.phase), event.start / 1e3, event.duration / 1e3);
+        }
+        fprintf(file, "\n],\n\"displayTimeUnit\": \"ms\",\n\"otherData\": {\"droppedEvents\": %lld}}\n",
+                traceDropped);
+        fclose(file);
+        return true;
+    }
+
+    const std::string& traceFile() const { return tracePath; }
+    size_t traceEventCount() const { return traceEvents.size(); }
+};
+
+// The profiler the game loop, simulation and renderer report to. One per
+// thread, so a simulation thread records its own ticks without contending
+// with the render thread's frames.
+inline Profiler& frameProfiler() {
+    static thread_local Profiler profiler;
+    return profiler;
+}
+
+#ifdef SI_PROFILE
+// Times from construction to the end of the enclosing scope
+class ProfileScope {
+private:
+    ProfilePhase phase;
+    int64_t start;
+
+public:
+    explicit ProfileScope(ProfilePhase p) : phase(p), start(-1) {
+        if (frameProfiler().isActive()) start = frameProfiler().now();
+    }
+    ~ProfileScope() {
+        if (start >= 0) frameProfiler().record(phase, start, frameProfiler().now());
+    }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+#define PROFILE_BEGIN_FRAME() frameProfiler().beginFrame()
+#define PROFILE_END_FRAME() frameProfiler().endFrame()
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_BEGIN_FRAME() ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#endif
+
+#endif
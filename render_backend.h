@@ -0,0 +1,49 @@
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+// What GameRenderer draws with. A frame is only ever a clear, batches of
+// solid rectangles and batches of textured quads from a TextureAtlas
+// (glyphs and sprites), plus offscreen layers (render_layer.h) that
+// panels are cached in, so that is the whole interface. SdlBackend
+// (sdl_backend.h) submits to an SDL_Renderer; SoftRaster (soft_raster.h)
+// rasterizes into a pixel buffer on the CPU, for headless observations and
+// screenshots.
+//
+// Colours with alpha below 255 are blended over what is already drawn
+// (SDL_BLENDMODE_BLEND); opaque colours replace it.
+
+#include <SDL.h>
+
+class TextureAtlas;
+class RenderLayer;
+
+// The atlas rectangle `src` drawn 1:1 with its top-left at (x, y), each
+// texel's colour and alpha multiplied by `color` (white: as drawn)
+struct AtlasQuad {
+    SDL_Rect src;
+    int x, y;
+    SDL_Color color;
+};
+
+class RenderBackend {
+public:
+    virtual ~RenderBackend() {}
+
+    // Set the whole target to `color`, without blending
+    virtual void clear(SDL_Color color) = 0;
+
+    virtual void fillRects(SDL_Color color, const SDL_Rect* rects, int count) = 0;
+
+    // Draw `count` quads from `atlas`, blended over the target
+    virtual void drawQuads(TextureAtlas& atlas, const AtlasQuad* quads, int count) = 0;
+
+    // Draw into `layer`, cleared to transparent, instead of the target
+    // until endLayer(). False if this backend can't; draw to the target then.
+    virtual bool beginLayer(RenderLayer& layer) = 0;
+    virtual void endLayer() = 0;
+
+    // Blend `layer` over the target with its top-left at (x, y)
+    virtual void drawLayer(RenderLayer& layer, int x, int y) = 0;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef RENDER_LAYER_H
+#define RENDER_LAYER_H
+
+// An offscreen image for parts of a frame that rarely change: GameRenderer
+// draws a panel into one once, then copies it to the screen every frame
+// until the panel's contents change (see RenderBackend::beginLayer).
+// SdlBackend draws it into an SDL_TEXTUREACCESS_TARGET texture of its
+// renderer; SoftRaster into the layer's own RGBA32 surface, which it then
+// copies from like any atlas, indexed so opaque rows are plain copies.
+// Each is created the first time that backend draws the layer.
+
+#include <SDL.h>
+#include "texture_atlas.h"
+
+class RenderLayer : public TextureAtlas {
+private:
+    int layerWidth, layerHeight;
+    SDL_Texture* target;                 // For SdlBackend
+    SDL_Renderer* targetRenderer;        // Renderer that owns `target`
+
+public:
+    RenderLayer() : layerWidth(0), layerHeight(0), target(nullptr), targetRenderer(nullptr) {}
+    ~RenderLayer() { destroy(); }
+
+    // Set the size; a new size drops whatever was drawn. Returns whether
+    // it changed.
+    bool resize(int w, int h) {
+        if (w == layerWidth && h == layerHeight) return false;
+        destroy();
+        layerWidth = w;
+        layerHeight = h;
+        return true;
+    }
+
+    int width() const { return layerWidth; }
+    int height() const { return layerHeight; }
+
+    // The layer's pixels for the software rasterizer, created (transparent)
+    // on first use
+    SDL_Surface* surfaceForDrawing() {
+        if (!surface && layerWidth > 0 && layerHeight > 0) createSurface(layerWidth, layerHeight);
+        return surface;
+    }
+
+    // Call once the surface is drawn, so copies of it can skip blending
+    // opaque rows
+    void finishDrawing() {
+        if (surface) indexOpaque();
+    }
+
+    // The layer as a render target of `renderer`, created on first use;
+    // null if the renderer can't render to textures
+    SDL_Texture* targetFor(SDL_Renderer* renderer) {
+        if (target && targetRenderer == renderer) return target;
+        if (target) SDL_DestroyTexture(target);
+        target = nullptr;
+        targetRenderer = nullptr;
+        if (layerWidth <= 0 || layerHeight <= 0 || !SDL_RenderTargetSupported(renderer)) return nullptr;
+        target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET,
+                                   layerWidth, layerHeight);
+        if (target) {
+            targetRenderer = renderer;
+            SDL_SetTextureBlendMode(target, SDL_BLENDMODE_BLEND);
+        }
+        return target;
+    }
+
+    void destroy() {
+        if (target) SDL_DestroyTexture(target);
+        target = nullptr;
+        targetRenderer = nullptr;
+        release();
+    }
+};
+
+#endif
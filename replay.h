@@ -0,0 +1,337 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Input recordings. The simulation is deterministic given its seed, start
+// level and per-tick inputs, so that is all a replay needs to play back:
+//
+//   offset  size  field
+//   0       4     magic "SIRP"
+//   4       2     format version (REPLAY_VERSION)
+//   6       1     player count
+//   7       1     coordinate mode (COORD_MODE; 0 in version 1)
+//   8       8     seed
+//   16      4     start level
+//   20      2     check version (CHECK_VERSION; 0 = no checks, and in version 1)
+//   22      2     check interval, in ticks
+//   24      8     tick count
+//   32      ...   runs: varint length, one InputBits byte per player, then
+//                 a 4-byte check for each check tick in the run
+//
+// All integers are little-endian. Input rarely changes from one tick to the
+// next, so a run covers many ticks and the inputs grow with how often they
+// change, not with the length of play. The reader maps the file into memory
+// and decodes runs in place, so even a long soak replay opens instantly.
+//
+// A check is the low half of a running hash: the previous check folded
+// with Simulation::checkHash() of the state after the tick. Playback
+// recomputes it and stops at the first check that differs. By default
+// every tick is checked, so that is the exact tick where the two runs
+// diverged (a different build, compiler or float behaviour), rather than
+// wherever the difference first shows on screen. That costs 4 bytes a
+// tick, about 850 KB an hour, and runs are cut at REPLAY_RUN_CHECKS checks
+// so the writer holds a fixed number of them. A longer check interval
+// shrinks the checks in proportion (every 300 ticks is about 3 KB an hour)
+// but only narrows a divergence to one interval; an interval of 0 records
+// none. Checks compare across builds of the same coordinate mode and check
+// version on little-endian machines; other files are refused.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "simulation.h"
+
+const uint16_t REPLAY_VERSION = 3;
+const int REPLAY_HEADER_SIZE = 32;
+const int REPLAY_CHECK_INTERVAL = 1;     // Default ticks between checks
+const int REPLAY_RUN_CHECKS = 64;        // Most checks in one run
+
+struct ReplayHeader {
+    uint16_t version;
+    int playerCount;
+    int coordMode;
+    int checkVersion;                    // 0 when the file has no checks
+    int checkInterval;
+    uint64_t seed;
+    int startLevel;
+    uint64_t tickCount;
+};
+
+inline void putLittleEndian(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+inline uint64_t getLittleEndian(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) value |= (uint64_t)in[i] << (8 * i);
+    return value;
+}
+
+// The running check after a check tick whose state hashes to `checkHash`
+inline uint64_t chainReplayCheck(uint64_t previous, uint64_t checkHash) {
+    uint64_t z = (previous ^ checkHash) * 0x9E3779B97F4A7C15ULL;
+    return z ^ (z >> 32);
+}
+
+inline void encodeReplayHeader(const ReplayHeader& header, uint8_t* out) {
+    memset(out, 0, REPLAY_HEADER_SIZE);
+    memcpy(out, "SIRP", 4);
+    putLittleEndian(out + 4, header.version, 2);
+    out[6] = (uint8_t)header.playerCount;
+    out[7] = (uint8_t)header.coordMode;
+    putLittleEndian(out + 8, header.seed, 8);
+    putLittleEndian(out + 16, (uint32_t)header.startLevel, 4);
+    putLittleEndian(out + 20, (uint16_t)header.checkVersion, 2);
+    putLittleEndian(out + 22, (uint16_t)header.checkInterval, 2);
+    putLittleEndian(out + 24, header.tickCount, 8);
+}
+
+// Appends ticks to a replay file. The tick count in the header is filled
+// in by close().
+class ReplayWriter {
+private:
+    FILE* file;
+    ReplayHeader header;
+    InputBits runInputs[MAX_PLAYERS];
+    uint64_t runLength;
+    uint64_t check;                             // Running check
+    int runCheckCount;
+    uint8_t runChecks[REPLAY_RUN_CHECKS * 4];   // The run's checks, little-endian
+
+    void flushRun() {
+        if (runLength == 0) return;
+        uint8_t bytes[10 + MAX_PLAYERS];
+        int n = 0;
+        uint64_t length = runLength;
+        do {
+            uint8_t byte = length & 0x7F;
+            length >>= 7;
+            bytes[n++] = length ? (byte | 0x80) : byte;
+        } while (length);
+        memcpy(bytes + n, runInputs, header.playerCount);
+        fwrite(bytes, 1, n + header.playerCount, file);
+        fwrite(runChecks, 4, runCheckCount, file);
+        runLength = 0;
+        runCheckCount = 0;
+    }
+
+public:
+    ReplayWriter() : file(nullptr), runLength(0), check(0), runCheckCount(0) {}
+    ~ReplayWriter() { close(); }
+
+    // `checkInterval` is the ticks between state checks; 0 records none
+    bool open(const std::string& path, uint64_t seed, int playerCount, int startLevel,
+              int checkInterval = REPLAY_CHECK_INTERVAL) {
+        close();
+        file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+
+        checkInterval = std::max(0, std::min(checkInterval, 0xFFFF));
+        header.version = REPLAY_VERSION;
+        header.playerCount = playerCount;
+        header.coordMode = (int)COORD_MODE;
+        header.checkVersion = checkInterval ? (int)CHECK_VERSION : 0;
+        header.checkInterval = checkInterval;
+        header.seed = seed;
+        header.startLevel = startLevel;
+        header.tickCount = 0;
+        check = 0;
+
+        uint8_t bytes[REPLAY_HEADER_SIZE];
+        encodeReplayHeader(header, bytes);
+        fwrite(bytes, 1, REPLAY_HEADER_SIZE, file);
+        return true;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+    uint64_t ticks() const { return header.tickCount; }
+
+    // Record a sim step: the inputs it was given (one per player) and the
+    // state it left, which is only hashed on check ticks
+    void record(const InputBits* inputs, const Simulation& sim) {
+        if (!file) return;
+        if (runCheckCount == REPLAY_RUN_CHECKS ||
+            (runLength > 0 && memcmp(runInputs, inputs, header.playerCount) != 0)) {
+            flushRun();
+        }
+        if (runLength == 0) memcpy(runInputs, inputs, header.playerCount);
+        runLength++;
+        header.tickCount++;
+        if (header.checkInterval && header.tickCount % header.checkInterval == 0) {
+            check = chainReplayCheck(check, sim.checkHash());
+            putLittleEndian(runChecks + 4 * runCheckCount, (uint32_t)check, 4);
+            runCheckCount++;
+        }
+    }
+
+    void close() {
+        if (!file) return;
+        flushRun();
+        uint8_t bytes[REPLAY_HEADER_SIZE];
+        encodeReplayHeader(header, bytes);
+        fseek(file, 0, SEEK_SET);
+        fwrite(bytes, 1, REPLAY_HEADER_SIZE, file);
+        fclose(file);
+        file = nullptr;
+    }
+};
+
+// Reads a replay through a read-only memory map
+class ReplayReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset;                  // Next run to decode
+    ReplayHeader header;
+    InputBits runInputs[MAX_PLAYERS];
+    uint64_t runLeft;               // Ticks left in the current run
+    const uint8_t* runChecks;       // The current run's next check; null without checks
+    uint64_t ticksRead;
+    uint64_t check;                 // Running check of the playback
+    uint64_t checkedTick;           // Last tick whose check matched
+    long long mismatchTick;         // First check tick that differed, or -1
+    std::string error;
+
+    bool fail(const std::string& message) {
+        error = message;
+        close();
+        return false;
+    }
+
+public:
+    ReplayReader()
+        : data(nullptr), size(0), offset(0), runLeft(0), runChecks(nullptr), ticksRead(0), check(0),
+          checkedTick(0), mismatchTick(-1) {}
+    ~ReplayReader() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return fail("cannot open " + path);
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < REPLAY_HEADER_SIZE) {
+            ::close(fd);
+            return fail(path + " is too short to be a replay");
+        }
+        void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // The mapping keeps the file alive
+        if (mapped == MAP_FAILED) return fail("cannot map " + path);
+        data = (const uint8_t*)mapped;
+        size = (size_t)info.st_size;
+        madvise(mapped, size, MADV_SEQUENTIAL);
+
+        if (memcmp(data, "SIRP", 4) != 0) return fail(path + " is not a replay");
+        header.version = (uint16_t)getLittleEndian(data + 4, 2);
+        header.playerCount = data[6];
+        header.coordMode = data[7];
+        header.seed = getLittleEndian(data + 8, 8);
+        header.startLevel = (int)(uint32_t)getLittleEndian(data + 16, 4);
+        header.checkVersion = 0;
+        header.checkInterval = 0;
+        if (header.version != 1) {
+            header.checkVersion = (int)getLittleEndian(data + 20, 2);
+            header.checkInterval = (int)getLittleEndian(data + 22, 2);
+        }
+        header.tickCount = getLittleEndian(data + 24, 8);
+        if (header.version != 1 && header.version != REPLAY_VERSION) {
+            return fail(path + " has an unsupported replay version");
+        }
+        if (header.version != 1 && header.coordMode != (int)COORD_MODE) {
+            return fail(path + " was recorded by a " + coordModeName(header.coordMode) +
+                        " build; this build uses " + coordModeName(COORD_MODE));
+        }
+        if (header.checkVersion != 0 && header.checkVersion != (int)CHECK_VERSION) {
+            return fail(path + " has state checks of version " + std::to_string(header.checkVersion) +
+                        "; this build computes version " + std::to_string(CHECK_VERSION));
+        }
+        if (header.checkVersion != 0 && header.checkInterval == 0) {
+            return fail(path + " has a bad check interval");
+        }
+        if (header.playerCount < 1 || header.playerCount > MAX_PLAYERS) {
+            return fail(path + " has a bad player count");
+        }
+
+        offset = REPLAY_HEADER_SIZE;
+        check = 0;
+        checkedTick = 0;
+        mismatchTick = -1;
+        return true;
+    }
+
+    void close() {
+        if (data) munmap((void*)data, size);
+        data = nullptr;
+        size = offset = 0;
+        runLeft = ticksRead = 0;
+        runChecks = nullptr;
+    }
+
+    bool isOpen() const { return data != nullptr; }
+    const ReplayHeader& info() const { return header; }
+    const std::string& lastError() const { return error; }
+    uint64_t ticksDone() const { return ticksRead; }
+    bool done() const { return !data || ticksRead >= header.tickCount; }
+    bool hasChecks() const { return header.checkVersion != 0; }
+
+    // The check tick (counting from 1) that first differed from the
+    // recording, or -1 if none has. The runs diverged after desyncFrom()
+    // and at or before this tick; the same tick when every tick is checked.
+    long long desyncTick() const { return mismatchTick; }
+    long long desyncFrom() const { return mismatchTick < 0 ? -1 : (long long)checkedTick + 1; }
+
+    // Fill `inputs` (one per player) for the next tick; false at the end
+    bool next(InputBits* inputs) {
+        if (done()) return false;
+        if (runLeft == 0) {
+            uint64_t length = 0;
+            int shift = 0;
+            while (true) {
+                if (offset >= size || shift > 63) return false;
+                uint8_t byte = data[offset++];
+                length |= (uint64_t)(byte & 0x7F) << shift;
+                shift += 7;
+                if (!(byte & 0x80)) break;
+            }
+            if (length == 0 || offset + header.playerCount > size) return false;
+            memcpy(runInputs, data + offset, header.playerCount);
+            offset += header.playerCount;
+            runChecks = nullptr;
+            if (hasChecks()) {
+                uint64_t checks = (ticksRead + length) / header.checkInterval - ticksRead / header.checkInterval;
+                if (checks > REPLAY_RUN_CHECKS || offset + checks * 4 > size) return false;
+                runChecks = data + offset;
+                offset += checks * 4;
+            }
+            runLeft = length;
+        }
+        memcpy(inputs, runInputs, header.playerCount);
+        runLeft--;
+        ticksRead++;
+        return true;
+    }
+
+    // After stepping the inputs next() returned, compare the state left with
+    // the recording's if this was a check tick. False on a mismatch, and
+    // from then on; always true for a file without checks.
+    bool verify(const Simulation& sim) {
+        if (!runChecks || ticksRead % header.checkInterval != 0 || mismatchTick >= 0) {
+            return mismatchTick < 0;
+        }
+        check = chainReplayCheck(check, sim.checkHash());
+        uint32_t recorded = (uint32_t)getLittleEndian(runChecks, 4);
+        runChecks += 4;
+        if (recorded != (uint32_t)check) {
+            mismatchTick = (long long)ticksRead;
+        } else {
+            checkedTick = ticksRead;
+        }
+        return mismatchTick < 0;
+    }
+};
+
+#endif
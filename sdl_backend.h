@@ -0,0 +1,88 @@
+#ifndef SDL_BACKEND_H
+#define SDL_BACKEND_H
+
+// RenderBackend that submits to an SDL_Renderer: one SDL_RenderFillRects
+// per rectangle batch, one SDL_RenderGeometry per quad batch and one
+// SDL_RenderCopy per layer, which is drawn as a render-target texture. The
+// vertex buffers keep their storage, so a warmed-up frame does not allocate.
+
+#include <SDL.h>
+#include <vector>
+#include "render_backend.h"
+#include "render_layer.h"
+#include "texture_atlas.h"
+
+class SdlBackend : public RenderBackend {
+private:
+    SDL_Renderer* renderer;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+    void addQuad(const AtlasQuad& quad, float atlasWidth, float atlasHeight) {
+        float u0 = quad.src.x / atlasWidth;
+        float v0 = quad.src.y / atlasHeight;
+        float u1 = (quad.src.x + quad.src.w) / atlasWidth;
+        float v1 = (quad.src.y + quad.src.h) / atlasHeight;
+        float x0 = (float)quad.x, y0 = (float)quad.y;
+        float x1 = (float)(quad.x + quad.src.w), y1 = (float)(quad.y + quad.src.h);
+
+        int base = (int)vertices.size();
+        SDL_Vertex v;
+        v.color = quad.color;
+        v.position.x = x0; v.position.y = y0; v.tex_coord.x = u0; v.tex_coord.y = v0; vertices.push_back(v);
+        v.position.x = x1; v.position.y = y0; v.tex_coord.x = u1; v.tex_coord.y = v0; vertices.push_back(v);
+        v.position.x = x1; v.position.y = y1; v.tex_coord.x = u1; v.tex_coord.y = v1; vertices.push_back(v);
+        v.position.x = x0; v.position.y = y1; v.tex_coord.x = u0; v.tex_coord.y = v1; vertices.push_back(v);
+
+        indices.push_back(base);     indices.push_back(base + 1); indices.push_back(base + 2);
+        indices.push_back(base);     indices.push_back(base + 2); indices.push_back(base + 3);
+    }
+
+public:
+    explicit SdlBackend(SDL_Renderer* target = nullptr) : renderer(target) {}
+
+    void setRenderer(SDL_Renderer* target) { renderer = target; }
+    SDL_Renderer* sdlRenderer() const { return renderer; }
+
+    void clear(SDL_Color color) override {
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderClear(renderer);
+    }
+
+    void fillRects(SDL_Color color, const SDL_Rect* rects, int count) override {
+        SDL_SetRenderDrawBlendMode(renderer, color.a < 255 ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRects(renderer, rects, count);
+    }
+
+    void drawQuads(TextureAtlas& atlas, const AtlasQuad* quads, int count) override {
+        SDL_Texture* texture = atlas.textureFor(renderer);
+        if (!texture) return;
+        float width = (float)atlas.pixels()->w;
+        float height = (float)atlas.pixels()->h;
+        for (int i = 0; i < count; i++) addQuad(quads[i], width, height);
+        SDL_RenderGeometry(renderer, texture, vertices.data(), (int)vertices.size(),
+                           indices.data(), (int)indices.size());
+        vertices.clear();
+        indices.clear();
+    }
+
+    bool beginLayer(RenderLayer& layer) override {
+        SDL_Texture* target = layer.targetFor(renderer);
+        if (!target || SDL_SetRenderTarget(renderer, target) != 0) return false;
+        SDL_Color transparent = {0, 0, 0, 0};
+        clear(transparent);
+        return true;
+    }
+
+    void endLayer() override { SDL_SetRenderTarget(renderer, nullptr); }
+
+    void drawLayer(RenderLayer& layer, int x, int y) override {
+        SDL_Texture* target = layer.targetFor(renderer);
+        if (!target) return;
+        SDL_Rect dest = {x, y, layer.width(), layer.height()};
+        SDL_RenderCopy(renderer, target, nullptr, &dest);
+    }
+};
+
+#endif
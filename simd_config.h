@@ -0,0 +1,21 @@
+#ifndef SIMD_CONFIG_H
+#define SIMD_CONFIG_H
+
+// Picks the SIMD instruction set for the hand-written kernels from the
+// compiler's target flags: AVX2 (SIMD_FLAGS=-mavx2), else SSE2, else NEON,
+// else none. Define SI_NO_SIMD to force the scalar paths everywhere.
+// Exactly one of SI_SIMD_AVX2, SI_SIMD_SSE2 and SI_SIMD_NEON is defined,
+// or none.
+
+#if !defined(SI_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define SI_SIMD_AVX2 1
+#elif !defined(SI_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define SI_SIMD_SSE2 1
+#elif !defined(SI_NO_SIMD) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SI_SIMD_NEON 1
+#endif
+
+#endif
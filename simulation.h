@@ -0,0 +1,729 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+// Game simulation core: all game state and rules, with no SDL dependency.
+// The SDL front end (space_invaders.cpp) turns key presses into InputBits,
+// calls step() at a fixed 60 Hz and draws whatever state it finds here.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "game_types.h"
+#include "broadphase.h"
+#include "bullet_pool.h"
+#include "enemy_formation.h"
+#include "formation_tables.h"
+#include "game_events.h"
+#include "profiler.h"
+#include "state_blob.h"
+
+// Player input for one simulation step, as a bitmask
+typedef uint8_t InputBits;
+enum {
+    INPUT_LEFT  = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_FIRE  = 1 << 2,   // Space pressed: shoot, or continue/restart on overlays
+
+    // When in the tick's interval the fire press happened, in quarter
+    // ticks after the previous tick (0-3). A later press spawns the bullet
+    // further back along its path, so shots keep their exact spacing
+    // instead of snapping to tick boundaries. Zero is a press at the start
+    // of the interval, which is how every shot behaved before.
+    INPUT_FIRE_DELAY_SHIFT = 3,
+    INPUT_FIRE_DELAY = 3 << INPUT_FIRE_DELAY_SHIFT
+};
+
+// Seedable RNG (splitmix64 seeding, xorshift64* output). Same seed, same game.
+class Rng {
+private:
+    uint64_t state;
+
+public:
+    explicit Rng(uint64_t seed = 1) { reseed(seed); }
+
+    void reseed(uint64_t seed) {
+        uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        state = z ^ (z >> 31);
+        if (state == 0) state = 0x9E3779B97F4A7C15ULL;
+    }
+
+    uint32_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (uint32_t)((state * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+    // Uniform integer in [0, n)
+    int nextInt(int n) {
+        return (int)(((uint64_t)next() * (uint32_t)n) >> 32);
+    }
+
+    // Generator position, for snapshots
+    uint64_t rawState() const { return state; }
+    void setRawState(uint64_t raw) { state = raw ? raw : 0x9E3779B97F4A7C15ULL; }
+};
+
+class Simulation {
+public:
+    // Game state. Renderers read it; only step() changes it.
+    std::vector<Player> players;
+    EnemyFormation enemies;
+    BulletPool bullets;
+
+    Coord enemyDirection;       // +1 or -1
+    Coord enemySpeed;
+    int score;
+    int frameCount;
+    bool gameOver;
+    bool victory;
+
+    // Level system
+    int level;
+    int enemiesKilledThisLevel;
+    bool levelTransition;
+    int transitionTimer;
+    Pattern currentPattern;
+    int pathClock;              // Samples along the formation path since the level began
+    int pathScale;              // Size of this level's formation path
+    long long formationsBuilt;  // initEnemies() calls; the only place play may allocate
+
+    Rng rng;
+
+    // Gameplay events go here when set; not part of the game state
+    GameEventSink* events;
+
+    // Starts a new game at level 1, showing the level intro
+    explicit Simulation(uint64_t seed = 1, int playerCount = 1,
+                        int bulletCapacity = DEFAULT_BULLET_CAPACITY)
+        : bullets(bulletCapacity), enemyDirection(1), enemySpeed(0), score(0),
+          frameCount(0), gameOver(false), victory(false),
+          level(1), enemiesKilledThisLevel(0), levelTransition(false),
+          transitionTimer(0), currentPattern(PATTERN_CLASSIC), pathClock(0), pathScale(0), formationsBuilt(0), rng(seed), events(nullptr),
+          enemyGrid(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, COLLISION_CELL_SIZE),
+          playerGrid(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, COLLISION_CELL_SIZE),
+          boundsDirty(true) {
+        playerCount = std::max(1, std::min(playerCount, MAX_PLAYERS));
+        players.reserve(playerCount);
+        for (int i = 0; i < playerCount; i++) {
+            players.push_back(Player(spawnX(i, playerCount), SCREEN_HEIGHT - 80));
+        }
+        playerGrid.reserve(MAX_PLAYERS, MAX_PLAYERS * 4);
+        enemies.reserve(MAX_FORMATION_SIZE);
+        initEnemies();
+        levelTransition = true;  // Start with level intro
+    }
+
+    // New game at `startLevel`, straight into play, building one formation.
+    // Keeps the RNG running, so each restart plays out differently. Does not
+    // allocate.
+    void restart(int startLevel = 1) {
+        score = 0;
+        level = std::max(1, startLevel);
+        for (size_t i = 0; i < players.size(); i++) {
+            Player& player = players[i];
+            player.lives = 3;
+            player.x = spawnX((int)i, (int)players.size());
+            player.prevX = player.x;  // Don't interpolate across the respawn
+            player.active = true;
+        }
+        bullets.clear();
+        initEnemies();
+        gameOver = false;
+        victory = false;
+        levelTransition = false;
+    }
+
+    // Begin at `startLevel` instead of level 1, showing its intro
+    void startAtLevel(int startLevel) {
+        level = std::max(1, startLevel);
+        initEnemies();
+        levelTransition = true;
+    }
+
+    // Advance the game by one fixed tick (1/60 s) with one input per player
+    void step(const InputBits* inputs) {
+        savePreviousPositions();
+
+        // Any player's fire press works the overlays; otherwise everyone shoots
+        bool anyFire = false;
+        for (size_t i = 0; i < players.size(); i++) {
+            if (inputs[i] & INPUT_FIRE) anyFire = true;
+        }
+        if (anyFire && (gameOver || levelTransition || victory)) {
+            pressFire();
+        } else if (anyFire) {
+            for (size_t i = 0; i < players.size(); i++) {
+                if ((inputs[i] & INPUT_FIRE) && players[i].active) {
+                    shoot((int)i, (inputs[i] & INPUT_FIRE_DELAY) >> INPUT_FIRE_DELAY_SHIFT);
+                }
+            }
+        }
+
+        if (!gameOver && !victory && !levelTransition) {
+            for (size_t i = 0; i < players.size(); i++) {
+                Player& player = players[i];
+                if (!player.active) continue;
+                if (inputs[i] & INPUT_LEFT) {
+                    player.x -= PLAYER_SPEED;
+                    if (player.x < 0) player.x = 0;
+                }
+                if (inputs[i] & INPUT_RIGHT) {
+                    player.x += PLAYER_SPEED;
+                    if (player.x > SCREEN_WIDTH - PLAYER_WIDTH)
+                        player.x = SCREEN_WIDTH - PLAYER_WIDTH;
+                }
+            }
+        }
+
+        if (levelTransition) {
+            transitionTimer++;
+        } else if (!gameOver && !victory) {
+            updateEnemies();
+            updateBullets();
+            checkCollisions();
+            frameCount++;
+        }
+    }
+
+    // Single-player convenience: input goes to player 0, others idle
+    void step(InputBits input) {
+        InputBits inputs[MAX_PLAYERS] = {input};
+        step(inputs);
+    }
+
+    void initEnemies() {
+        enemies.clear();
+        formationsBuilt++;
+
+        // Determine pattern based on level; the tables size it for the level
+        currentPattern = (Pattern)(level % PATTERN_COUNT);
+        const FormationTables& tables = FormationTables::instance();
+        const std::vector<FormationSlot>& slots = tables.layout(currentPattern, level);
+        for (size_t i = 0; i < slots.size(); i++) {
+            enemies.add(slots[i].x, slots[i].y, slots[i].type, slots[i].phase, slots[i].column);
+        }
+
+        // Start everyone at their path's first sample, with nothing to
+        // interpolate from
+        pathClock = 0;
+        pathScale = FormationTables::pathScale(currentPattern, level);
+        enemies.samplePath(tables.path(currentPattern), pathScale, pathClock);
+        moveFormation(enemies, 0, 0, false, 0, 0);
+        enemies.savePreviousPositions();
+
+        formationChanged();
+        emit(EVENT_LEVEL_START, EVENT_NO_PLAYER, 0, 0, 0, enemies.size());
+
+        // Reset enemy movement, a little faster each level
+        enemyDirection = 1;
+#ifdef SI_FIXED_POINT
+        enemySpeed = Fixed::ratio(50 + level * 15, 100);
+#else
+        enemySpeed = 0.5f + (level * 0.15f);
+#endif
+        enemiesKilledThisLevel = 0;
+    }
+
+    // The phases of a playing tick, in the order step() runs them. Public so
+    // the benchmarks can time each one alone; game code should call step().
+    void updateEnemies() {
+        PROFILE_SCOPE(PHASE_UPDATE_ENEMIES);
+
+        if (enemies.empty()) {
+            victory = true;
+            emit(EVENT_LEVEL_END, EVENT_NO_PLAYER, 0, 0, 0, score);
+            return;
+        }
+
+        // Check if any enemy hit screen edge, using the bounds left by the
+        // last move (re-reduced only after a new level, or a kill on the edge)
+        if (boundsDirty) {
+            bounds = formationBounds(enemies);
+            boundsDirty = false;
+        }
+        bool shouldMoveDown =
+            (enemyDirection > 0 && bounds.maxX + ENEMY_WIDTH >= SCREEN_WIDTH - 10) ||
+            (enemyDirection < 0 && bounds.minX <= 10);
+
+        // Advance along the formation path: one table lookup per enemy
+        const FormationPath& path = FormationTables::instance().path(currentPattern);
+        if (path.step != 0) {
+            pathClock = (pathClock + path.step) & PATH_MASK;
+            enemies.samplePath(path, pathScale, pathClock);
+        }
+
+        // Move enemies, collecting next tick's bounds in the same sweep.
+        // Check if enemies reached the players' row when they step down, or
+        // on every tick while the path can carry them lower.
+        FormationMove move = moveFormation(enemies, enemyDirection * enemySpeed,
+                                           shouldMoveDown ? ENEMY_HEIGHT / 2 : 0,
+                                           shouldMoveDown || path.step != 0,
+                                           players[0].y, ENEMY_HEIGHT);
+        bounds = move.bounds;
+        if (move.reachedLine) {
+            gameOver = true;
+            emit(EVENT_GAME_OVER, EVENT_NO_PLAYER, 0, 0, 0, score);
+        }
+
+        if (shouldMoveDown) {
+            enemyDirection *= -1;
+        }
+
+        // Random enemy shooting (more frequent at higher levels)
+        int shootFrequency = std::max(30, 60 - level * 3);
+        if (frameCount % shootFrequency == 0) {
+            // Multiple enemies can shoot at higher levels
+            int numShooters = 1 + (level / 4);
+            if (numShooters > 3) numShooters = 3;
+
+            // Formations in columns fire from the bottom of a random column,
+            // the rest from any live enemy
+            int alive = enemies.aliveCount();
+            int columns = (int)enemies.liveColumns.size();
+            for (int i = 0; i < numShooters && i < alive; i++) {
+                int shooter = columns > 0 ? enemies.nthColumnBottom(rng.nextInt(columns))
+                                          : enemies.nthAlive(rng.nextInt(alive));
+                Coord bx = enemies.x[shooter] + ENEMY_WIDTH/2 - BULLET_WIDTH/2;
+                Coord by = enemies.y[shooter] + ENEMY_HEIGHT;
+                if (bullets.spawn(bx, by, false) != NULL_BULLET_HANDLE) {
+                    emit(EVENT_ENEMY_SHOT, EVENT_NO_PLAYER, enemies.type[shooter], bx, by, 0);
+                }
+            }
+        }
+    }
+
+    void updateBullets() {
+        PROFILE_SCOPE(PHASE_UPDATE_BULLETS);
+
+        for (int i = 0; i < bullets.size(); ) {
+            Bullet& bullet = bullets[i];
+
+            if (bullet.fromPlayer) {
+                bullet.y -= BULLET_SPEED;
+                if (bullet.y < 0) bullet.active = false;
+            } else {
+                bullet.y += ENEMY_BULLET_SPEED;
+                if (bullet.y > SCREEN_HEIGHT) bullet.active = false;
+            }
+
+            // Off-screen bullets go back to the pool; the last one moves into i
+            if (bullet.active) i++;
+            else bullets.removeAt(i);
+        }
+    }
+
+    void checkCollisions() {
+        PROFILE_SCOPE(PHASE_COLLISIONS);
+
+        int playerBullets = 0, enemyBullets = 0;
+        for (const auto& bullet : bullets) {
+            if (!bullet.active) continue;
+            if (bullet.fromPlayer) playerBullets++;
+            else enemyBullets++;
+        }
+
+        // Broadphase: bucket live enemies by grid cell when there are
+        // enough bullet/enemy pairs for the grid to pay for itself
+        bool enemyGridUsed = playerBullets * enemies.aliveCount() >= GRID_MIN_PAIRS;
+        if (enemyGridUsed) {
+            enemyGrid.clear();
+            enemies.forEachAlive([&](int i) {
+                enemyGrid.insert(i, enemies.x[i], enemies.y[i], ENEMY_WIDTH, ENEMY_HEIGHT);
+            });
+            enemyGrid.build();
+        }
+
+        // Player bullets vs enemies
+        int kills = 0;
+        for (auto& bullet : bullets) {
+            if (!bullet.active || !bullet.fromPlayer) continue;
+
+            int hit = findEnemyHit(bullet, enemyGridUsed);
+            if (hit < 0) continue;
+
+            bullet.active = false;
+            if (bounds.touches(enemies.x[hit], enemies.y[hit])) boundsDirty = true;
+            enemies.kill(hit);
+            // Score increases with level
+            int baseScore = (4 - enemies.type[hit]) * 10;
+            score += baseScore * level;
+            emit(EVENT_KILL, EVENT_NO_PLAYER, enemies.type[hit], enemies.x[hit], enemies.y[hit], baseScore * level);
+            enemiesKilledThisLevel++;
+            kills++;
+        }
+
+        // Enemy bullets vs players: each player loses at most one life per tick
+        bool playerGridUsed = enemyBullets * (int)players.size() >= GRID_MIN_PAIRS;
+        if (playerGridUsed) {
+            playerGrid.clear();
+            for (size_t i = 0; i < players.size(); i++) {
+                const Player& player = players[i];
+                if (player.active) playerGrid.insert((int)i, player.x, player.y, player.width, player.height);
+            }
+            playerGrid.build();
+        }
+
+        bool hitThisTick[MAX_PLAYERS] = {false};
+        for (auto& bullet : bullets) {
+            if (!bullet.active || bullet.fromPlayer) continue;
+
+            int hit = findPlayerHit(bullet, playerGridUsed, hitThisTick);
+            if (hit < 0) continue;
+
+            Player& player = players[hit];
+            bullet.active = false;
+            hitThisTick[hit] = true;
+            player.lives--;
+            emit(EVENT_PLAYER_HIT, hit, 0, player.x, player.y, player.lives);
+
+            if (player.lives <= 0) {
+                player.active = false;
+            }
+        }
+
+        bool anyAlive = false;
+        for (const auto& player : players) {
+            if (player.active) anyAlive = true;
+        }
+        if (!anyAlive && !gameOver) {
+            gameOver = true;
+            emit(EVENT_GAME_OVER, EVENT_NO_PLAYER, 0, 0, 0, score);
+        }
+
+        // Spent bullets go back to the pool
+        bullets.removeInactive();
+
+        // Drop dead slots once they dominate
+        if (kills > 0) {
+            enemies.compactIfSparse();
+        }
+    }
+
+    // Snapshots. saveState writes everything step() depends on into a flat
+    // blob (see state_blob.h); loadState puts it back, after which the game
+    // plays on exactly as it would have from the saved tick. The player
+    // count must match. Bullet handles do not survive a load.
+
+    template <typename Sink>
+    void serializeState(Sink& sink) const {
+        uint32_t header[5] = {STATE_MAGIC, STATE_VERSION | COORD_MODE << 16, (uint32_t)players.size(),
+                              (uint32_t)enemies.size(), (uint32_t)bullets.size()};
+        sink.write(header, sizeof(header));
+
+        int32_t flags = (gameOver ? 1 : 0) | (victory ? 2 : 0) | (levelTransition ? 4 : 0);
+        int32_t ints[STATE_INTS] = {score, frameCount, level, enemiesKilledThisLevel,
+                                    transitionTimer, (int32_t)currentPattern, flags, pathClock, pathScale};
+        sink.write(ints, sizeof(ints));
+        Coord motion[2] = {enemyDirection, enemySpeed};
+        sink.write(motion, sizeof(motion));
+        uint64_t rngState = rng.rawState();
+        sink.write(&rngState, sizeof(rngState));
+
+        for (const Player& player : players) {
+            Coord position[4] = {player.x, player.y, player.prevX, player.prevY};
+            int32_t status[2] = {player.lives, player.active ? 1 : 0};
+            sink.write(position, sizeof(position));
+            sink.write(status, sizeof(status));
+        }
+
+        size_t n = enemies.size();
+        sink.write(enemies.x.data(), n * sizeof(Coord));
+        sink.write(enemies.y.data(), n * sizeof(Coord));
+        sink.write(enemies.prevX.data(), n * sizeof(Coord));
+        sink.write(enemies.prevY.data(), n * sizeof(Coord));
+        sink.write(enemies.slotX.data(), n * sizeof(Coord));
+        sink.write(enemies.slotY.data(), n * sizeof(Coord));
+        sink.write(enemies.pathPhase.data(), n * sizeof(uint16_t));
+        sink.write(enemies.type.data(), n);
+        sink.write(enemies.column.data(), n);
+        sink.write(enemies.layoutSlot.data(), n * sizeof(uint16_t));
+        sink.write(enemies.alive.data(), n);
+
+        for (const Bullet& bullet : bullets) {
+            Coord position[4] = {bullet.x, bullet.y, bullet.prevX, bullet.prevY};
+            uint32_t status = (bullet.active ? 1u : 0u) | (bullet.fromPlayer ? 2u : 0u);
+            sink.write(position, sizeof(position));
+            sink.write(&status, sizeof(status));
+        }
+    }
+
+    size_t stateSize() const {
+        StateSizer sizer;
+        serializeState(sizer);
+        return sizer.size;
+    }
+
+    // Returns the bytes written, or 0 if `capacity` is too small
+    size_t saveState(uint8_t* out, size_t capacity) const {
+        StateWriter writer(out, capacity);
+        serializeState(writer);
+        return writer.overflow ? 0 : writer.size;
+    }
+
+    // Into a reusable buffer; only allocates when the state has grown
+    void saveState(std::vector<uint8_t>& out) const {
+        out.resize(stateSize());
+        saveState(out.data(), out.size());
+    }
+
+    bool loadState(const uint8_t* data, size_t size) {
+        StateReader reader(data, size);
+        uint32_t header[5];
+        if (!reader.read(header, sizeof(header))) return false;
+        if (header[0] != STATE_MAGIC || header[1] != (STATE_VERSION | COORD_MODE << 16)) return false;
+        if (header[2] != players.size() || (int)header[4] > bullets.capacity()) return false;
+        size_t n = header[3], bulletCount = header[4];
+        size_t expected = sizeof(header) + STATE_INTS * 4 + 8 + 8 +
+                          players.size() * 24 + n * 31 + bulletCount * 20;
+        if (size != expected) return false;
+
+        int32_t ints[STATE_INTS];
+        reader.read(ints, sizeof(ints));
+        score = ints[0];
+        frameCount = ints[1];
+        level = ints[2];
+        enemiesKilledThisLevel = ints[3];
+        transitionTimer = ints[4];
+        currentPattern = (Pattern)ints[5];
+        gameOver = (ints[6] & 1) != 0;
+        victory = (ints[6] & 2) != 0;
+        levelTransition = (ints[6] & 4) != 0;
+        pathClock = ints[7] & PATH_MASK;
+        pathScale = ints[8];
+        Coord motion[2];
+        reader.read(motion, sizeof(motion));
+        enemyDirection = motion[0];
+        enemySpeed = motion[1];
+        rng.setRawState(reader.get<uint64_t>());
+
+        for (Player& player : players) {
+            Coord position[4] = {0, 0, 0, 0};
+            int32_t status[2] = {0, 0};
+            reader.read(position, sizeof(position));
+            reader.read(status, sizeof(status));
+            player.x = position[0];
+            player.y = position[1];
+            player.prevX = position[2];
+            player.prevY = position[3];
+            player.lives = status[0];
+            player.active = status[1] != 0;
+        }
+
+        enemies.resize((int)n);
+        reader.read(enemies.x.data(), n * sizeof(Coord));
+        reader.read(enemies.y.data(), n * sizeof(Coord));
+        reader.read(enemies.prevX.data(), n * sizeof(Coord));
+        reader.read(enemies.prevY.data(), n * sizeof(Coord));
+        reader.read(enemies.slotX.data(), n * sizeof(Coord));
+        reader.read(enemies.slotY.data(), n * sizeof(Coord));
+        reader.read(enemies.pathPhase.data(), n * sizeof(uint16_t));
+        reader.read(enemies.type.data(), n);
+        reader.read(enemies.column.data(), n);
+        reader.read(enemies.layoutSlot.data(), n * sizeof(uint16_t));
+        reader.read(enemies.alive.data(), n);
+        enemies.rebuildIndex();
+        enemies.samplePath(FormationTables::instance().path(currentPattern), pathScale, pathClock);
+
+        Bullet* restored = bullets.resetTo((int)bulletCount);
+        for (size_t i = 0; i < bulletCount; i++) {
+            Coord position[4] = {0, 0, 0, 0};
+            uint32_t status = 0;
+            reader.read(position, sizeof(position));
+            reader.read(&status, sizeof(status));
+            Bullet& bullet = restored[i];
+            bullet = Bullet(position[0], position[1], (status & 2) != 0);
+            bullet.prevX = position[2];
+            bullet.prevY = position[3];
+            bullet.active = (status & 1) != 0;
+        }
+
+        formationChanged();
+        return true;
+    }
+
+    bool loadState(const std::vector<uint8_t>& blob) {
+        return loadState(blob.data(), blob.size());
+    }
+
+    // 64-bit hash of the saved state, for quick equality checks
+    uint64_t stateHash() const {
+        StateHasher hasher;
+        serializeState(hasher);
+        return hasher.finish();
+    }
+
+    // Hash of the gameplay state for replay checks. Unlike stateHash() it
+    // covers a fixed list of fields, versioned by CHECK_VERSION, and not the
+    // snapshot layout, so replays stay checkable across STATE_VERSION bumps.
+    // The list (version 2):
+    //   score, frameCount, level, enemiesKilledThisLevel, transitionTimer,
+    //   currentPattern, pathClock, pathScale, the game over / victory /
+    //   transition flags, enemyDirection, enemySpeed and the RNG state;
+    //   per player: x, y, lives, active;
+    //   per live enemy, in slot order: x, y, slotX, slotY, pathPhase, type,
+    //   column;
+    //   per bullet, in pool order: x, y, active, fromPlayer, and its pool
+    //   slot and generation.
+    // Previous positions are left out: they only feed interpolation. Change
+    // the list only together with CHECK_VERSION.
+    uint64_t checkHash() const {
+        StateHasher hasher;
+        int32_t flags = (gameOver ? 1 : 0) | (victory ? 2 : 0) | (levelTransition ? 4 : 0);
+        int32_t ints[9] = {score, frameCount, level, enemiesKilledThisLevel, transitionTimer,
+                           (int32_t)currentPattern, pathClock, pathScale, flags};
+        hasher.write(ints, sizeof(ints));
+        Coord motion[2] = {enemyDirection, enemySpeed};
+        hasher.write(motion, sizeof(motion));
+        uint64_t rngState = rng.rawState();
+        hasher.write(&rngState, sizeof(rngState));
+
+        for (const Player& player : players) {
+            Coord position[2] = {player.x, player.y};
+            int32_t status[2] = {player.lives, player.active ? 1 : 0};
+            hasher.write(position, sizeof(position));
+            hasher.write(status, sizeof(status));
+        }
+        for (int i = 0; i < enemies.size(); i++) {
+            if (!enemies.alive[i]) continue;
+            Coord position[4] = {enemies.x[i], enemies.y[i], enemies.slotX[i], enemies.slotY[i]};
+            uint8_t kind[4] = {(uint8_t)enemies.pathPhase[i], (uint8_t)(enemies.pathPhase[i] >> 8),
+                               enemies.type[i], enemies.column[i]};
+            hasher.write(position, sizeof(position));
+            hasher.write(kind, sizeof(kind));
+        }
+        for (int i = 0; i < bullets.size(); i++) {
+            const Bullet& bullet = bullets[i];
+            BulletHandle handle = bullets.handleAt(i);
+            Coord position[2] = {bullet.x, bullet.y};
+            uint32_t status[3] = {(bullet.active ? 1u : 0u) | (bullet.fromPlayer ? 2u : 0u),
+                                  handle.slot, handle.generation};
+            hasher.write(position, sizeof(position));
+            hasher.write(status, sizeof(status));
+        }
+        return hasher.finish();
+    }
+
+    // Call after filling `enemies` by hand (as the benchmarks do). Sizes the
+    // collision grid for the formation now, so play itself never allocates
+    // (an enemy overlaps at most 2x2 cells).
+    void formationChanged() {
+        int capacity = std::max(enemies.size(), MAX_FORMATION_SIZE);
+        enemyGrid.reserve(capacity, capacity * 4);
+        boundsDirty = true;
+    }
+
+private:
+    static const int STATE_INTS = 9;   // Integer fields in a snapshot
+
+    UniformGrid enemyGrid;     // Broadphase for player bullets vs enemies
+    UniformGrid playerGrid;    // Broadphase for enemy bullets vs players
+    FormationBounds bounds;    // Live enemies' extent, valid unless boundsDirty
+    bool boundsDirty;          // Set by new levels and kills on the edge
+
+    // Players start evenly spaced along the bottom
+    static Coord spawnX(int index, int count) {
+        return SCREEN_WIDTH * (index + 1) / (count + 1) - PLAYER_WIDTH / 2;
+    }
+
+    void savePreviousPositions() {
+        for (auto& player : players) {
+            player.prevX = player.x;
+            player.prevY = player.y;
+        }
+        enemies.savePreviousPositions();
+        for (auto& bullet : bullets) {
+            bullet.prevX = bullet.x;
+            bullet.prevY = bullet.y;
+        }
+    }
+
+    // Space bar on an overlay: restart after game over, skip the level
+    // intro, or advance after a cleared level
+    void pressFire() {
+        if (gameOver) {
+            restart();
+        } else if (levelTransition) {
+            // Skip level transition
+            levelTransition = false;
+            initEnemies();
+        } else if (victory) {
+            // Continue to next level
+            victory = false;
+            level++;
+            levelTransition = true;
+            transitionTimer = 0;
+        }
+    }
+
+    // `delayQuarters` of a tick late: the bullet covers that much less of
+    // its first tick's flight
+    void shoot(int index, int delayQuarters = 0) {
+        Coord x = players[index].x + PLAYER_WIDTH/2 - BULLET_WIDTH/2;
+        Coord y = players[index].y + Coord(BULLET_SPEED) * delayQuarters / 4;
+        if (bullets.spawn(x, y, true) != NULL_BULLET_HANDLE) {
+            emit(EVENT_SHOT, index, 0, x, y, 0);
+        }
+    }
+
+    // Hand an event to the sink, if there is one
+    void emit(GameEventType type, int player, int enemyType, Coord x, Coord y, int32_t value) {
+        if (!events) return;
+        GameEvent event = {(uint32_t)frameCount, (uint8_t)type, (uint8_t)player, (uint8_t)enemyType,
+                           (uint8_t)currentPattern, (uint16_t)level, (int16_t)coordToInt(x), (int16_t)coordToInt(y),
+                           value};
+        events->record(event);
+    }
+
+    // Find the lowest-index player hit by `bullet`, or -1, skipping players
+    // already hit this tick. Lowest index wins so the grid and the plain scan
+    // agree.
+    int findPlayerHit(const Bullet& bullet, bool useGrid, const bool* skip) const {
+        int hit = -1;
+        if (useGrid) {
+            playerGrid.query(bullet.x, bullet.y, bullet.width, bullet.height, [&](int i) {
+                if ((hit < 0 || i < hit) && !skip[i] && bullet.collidesWith(players[i])) hit = i;
+            });
+        } else {
+            for (size_t i = 0; i < players.size(); i++) {
+                if (!skip[i] && bullet.collidesWith(players[i])) return (int)i;
+            }
+        }
+        return hit;
+    }
+
+    bool bulletHitsEnemy(const Bullet& bullet, int i) const {
+        Coord ex = enemies.x[i], ey = enemies.y[i];
+        return bullet.active && enemies.isAlive(i) &&
+               bullet.x < ex + ENEMY_WIDTH &&
+               bullet.x + bullet.width > ex &&
+               bullet.y < ey + ENEMY_HEIGHT &&
+               bullet.y + bullet.height > ey;
+    }
+
+    // Lowest-index enemy hit by `bullet`, or -1
+    int findEnemyHit(const Bullet& bullet, bool useGrid) const {
+        int hit = -1;
+        if (useGrid) {
+            enemyGrid.query(bullet.x, bullet.y, bullet.width, bullet.height, [&](int i) {
+                if ((hit < 0 || i < hit) && bulletHitsEnemy(bullet, i)) hit = i;
+            });
+        } else {
+            // Straight scan over the coordinate arrays
+            const Coord bx0 = bullet.x, bx1 = bullet.x + bullet.width;
+            const Coord by0 = bullet.y, by1 = bullet.y + bullet.height;
+            const Coord* ex = enemies.x.data();
+            const Coord* ey = enemies.y.data();
+            const uint8_t* alive = enemies.alive.data();
+            for (int i = 0, n = enemies.size(); i < n; i++) {
+                if (alive[i] && bx0 < ex[i] + ENEMY_WIDTH && bx1 > ex[i] &&
+                    by0 < ey[i] + ENEMY_HEIGHT && by1 > ey[i]) return i;
+            }
+        }
+        return hit;
+    }
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef SNAPSHOT_RING_H
+#define SNAPSHOT_RING_H
+
+// The last N simulation snapshots, oldest overwritten first. Each slot
+// keeps its buffer, so once every slot has held a typical state, pushing
+// a snapshot is a flat copy with no allocation.
+
+#include <cstdint>
+#include <vector>
+#include "simulation.h"
+
+class SnapshotRing {
+private:
+    std::vector<std::vector<uint8_t>> slots;
+    std::vector<long long> ticks;   // Tick each slot was saved at
+    int newest;                     // Slot of the most recent snapshot
+    int count;
+
+public:
+    // `capacity` snapshots, each slot preallocated to `slotBytes`
+    explicit SnapshotRing(int capacity, size_t slotBytes = 4096)
+        : slots(capacity), ticks(capacity, 0), newest(-1), count(0) {
+        for (auto& slot : slots) slot.reserve(slotBytes);
+    }
+
+    int capacity() const { return (int)slots.size(); }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { newest = -1; count = 0; }
+
+    void push(const Simulation& sim, long long tick) {
+        if (slots.empty()) return;
+        newest = (newest + 1) % capacity();
+        sim.saveState(slots[newest]);
+        ticks[newest] = tick;
+        if (count < capacity()) count++;
+    }
+
+    // Tick of the snapshot `back` steps before the newest (0 = newest)
+    long long tickAt(int back) const {
+        return ticks[(newest - back + capacity()) % capacity()];
+    }
+
+    // Load the snapshot `back` steps before the newest into `sim`
+    bool restore(Simulation& sim, int back = 0) const {
+        if (back < 0 || back >= count) return false;
+        return sim.loadState(slots[(newest - back + capacity()) % capacity()]);
+    }
+
+    // Load the newest snapshot and drop it: one step of rewind
+    bool pop(Simulation& sim) {
+        if (count == 0 || !restore(sim, 0)) return false;
+        newest = (newest - 1 + capacity()) % capacity();
+        count--;
+        return true;
+    }
+};
+
+#endif
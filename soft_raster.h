@@ -0,0 +1,425 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+// RenderBackend that draws on the CPU into a caller-provided pixel buffer,
+// RGBA (same byte order as SDL_PIXELFORMAT_RGBA32) or 8-bit grayscale.
+// Needs no window, GPU or SDL_Init, so headless runs and agents can get
+// pixels, and CI can take screenshots.
+//
+// Rectangles are clipped to the buffer and filled a row span at a time with
+// SIMD kernels (see simd_config.h). Atlas quads are blended texel by
+// texel, except rows of opaque sprites, which are copied. Cached layers
+// are RGBA surfaces drawn and copied from the same way. Blending uses
+// SDL's software renderer arithmetic (each product divided by 255 and
+// truncated), so RGBA frames match SDL's software renderer pixel for pixel;
+// GPU renderers may round blended pixels differently. Grayscale targets
+// store BT.601 luma and blend it the same way.
+//
+// downsample() box-filters the frame into a small grayscale observation.
+// Nothing here allocates except downsample(), once, for its column sums.
+
+#include <SDL.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "render_backend.h"
+#include "render_layer.h"
+#include "texture_atlas.h"
+#include "simd_config.h"
+
+enum RasterFormat {
+    RASTER_RGBA32,   // 4 bytes per pixel: R, G, B, A
+    RASTER_GRAY8     // 1 byte per pixel: luma
+};
+
+class SoftRaster : public RenderBackend {
+private:
+    uint8_t* pixels;
+    int width, height;
+    int pitch;                   // Bytes from one row to the next
+    RasterFormat format;
+    int bytesPerPixel;
+    std::vector<uint32_t> columnSums;  // downsample() scratch
+
+    // The caller's target, while drawing into a layer
+    RenderLayer* layer;
+    uint8_t* outerPixels;
+    int outerWidth, outerHeight, outerPitch;
+    RasterFormat outerFormat;
+
+    static unsigned luma(unsigned r, unsigned g, unsigned b) {
+        return (r * 77 + g * 150 + b * 29) >> 8;
+    }
+
+    // SDL's DRAW_MUL: a * b / 255, truncated
+    static unsigned mul255(unsigned a, unsigned b) { return a * b / 255; }
+
+    // One pixel of `color` repeated to fill 16 bytes
+    void pattern(SDL_Color color, uint8_t* out) const {
+        if (format == RASTER_GRAY8) {
+            memset(out, (int)luma(color.r, color.g, color.b), 16);
+            return;
+        }
+        for (int i = 0; i < 16; i += 4) {
+            out[i] = color.r;
+            out[i + 1] = color.g;
+            out[i + 2] = color.b;
+            out[i + 3] = color.a;
+        }
+    }
+
+    // What blending `color` adds to each byte: the colour premultiplied by
+    // its alpha, plus alpha itself in the alpha byte
+    void blendPattern(SDL_Color color, uint8_t* out) const {
+        SDL_Color premultiplied = {(Uint8)mul255(color.r, color.a), (Uint8)mul255(color.g, color.a),
+                                   (Uint8)mul255(color.b, color.a), color.a};
+        if (format == RASTER_GRAY8) {
+            memset(out, (int)mul255(luma(color.r, color.g, color.b), color.a), 16);
+            return;
+        }
+        pattern(premultiplied, out);
+    }
+
+    // Intersect `rect` with the buffer; false if nothing is left
+    bool clip(const SDL_Rect& rect, int& x0, int& y0, int& x1, int& y1) const {
+        x0 = rect.x < 0 ? 0 : rect.x;
+        y0 = rect.y < 0 ? 0 : rect.y;
+        x1 = rect.x + rect.w > width ? width : rect.x + rect.w;
+        y1 = rect.y + rect.h > height ? height : rect.y + rect.h;
+        return x0 < x1 && y0 < y1;
+    }
+
+    uint8_t* row(int y) const { return pixels + (size_t)y * pitch; }
+
+    // Set `bytes` bytes (whole pixels) to `pattern`, which repeats every 16
+    static void fillSpan(uint8_t* p, size_t bytes, const uint8_t* pattern) {
+        size_t i = 0;
+#if defined(SI_SIMD_AVX2)
+        __m256i v = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)pattern));
+        for (; i + 32 <= bytes; i += 32) _mm256_storeu_si256((__m256i*)(p + i), v);
+#elif defined(SI_SIMD_SSE2)
+        __m128i v = _mm_loadu_si128((const __m128i*)pattern);
+        for (; i + 16 <= bytes; i += 16) _mm_storeu_si128((__m128i*)(p + i), v);
+#elif defined(SI_SIMD_NEON)
+        uint8x16_t v = vld1q_u8(pattern);
+        for (; i + 16 <= bytes; i += 16) vst1q_u8(p + i, v);
+#endif
+        for (; i < bytes; i++) p[i] = pattern[i & 15];
+    }
+
+    // Blend over `bytes` bytes: each byte d becomes d * inverse / 255 + add,
+    // with `add` repeating every 16 bytes. (x + (x >> 8) + 1) >> 8 equals
+    // x / 255 for every product of two bytes.
+    static void blendSpan(uint8_t* p, size_t bytes, unsigned inverse, const uint8_t* add) {
+        size_t i = 0;
+#if defined(SI_SIMD_AVX2)
+        __m256i zero = _mm256_setzero_si256();
+        __m256i one = _mm256_set1_epi16(1);
+        __m256i inv = _mm256_set1_epi16((short)inverse);
+        __m256i addv = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)add));
+        for (; i + 32 <= bytes; i += 32) {
+            __m256i d = _mm256_loadu_si256((const __m256i*)(p + i));
+            __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv);
+            __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv);
+            lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), one), 8);
+            hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), one), 8);
+            d = _mm256_add_epi8(_mm256_packus_epi16(lo, hi), addv);
+            _mm256_storeu_si256((__m256i*)(p + i), d);
+        }
+#elif defined(SI_SIMD_SSE2)
+        __m128i zero = _mm_setzero_si128();
+        __m128i one = _mm_set1_epi16(1);
+        __m128i inv = _mm_set1_epi16((short)inverse);
+        __m128i addv = _mm_loadu_si128((const __m128i*)add);
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv);
+            __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv);
+            lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), one), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), one), 8);
+            d = _mm_add_epi8(_mm_packus_epi16(lo, hi), addv);
+            _mm_storeu_si128((__m128i*)(p + i), d);
+        }
+#elif defined(SI_SIMD_NEON)
+        uint8x8_t inv = vdup_n_u8((uint8_t)inverse);
+        uint16x8_t one = vdupq_n_u16(1);
+        uint8x16_t addv = vld1q_u8(add);
+        for (; i + 16 <= bytes; i += 16) {
+            uint8x16_t d = vld1q_u8(p + i);
+            uint16x8_t lo = vmull_u8(vget_low_u8(d), inv);
+            uint16x8_t hi = vmull_u8(vget_high_u8(d), inv);
+            lo = vshrq_n_u16(vaddq_u16(vaddq_u16(lo, vshrq_n_u16(lo, 8)), one), 8);
+            hi = vshrq_n_u16(vaddq_u16(vaddq_u16(hi, vshrq_n_u16(hi, 8)), one), 8);
+            vst1q_u8(p + i, vaddq_u8(vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)), addv));
+        }
+#endif
+        for (; i < bytes; i++) p[i] = (uint8_t)(mul255(p[i], inverse) + add[i & 15]);
+    }
+
+    // Add row `p` of `n` pixels into per-column sums, as luma
+    static void addGrayRow(uint32_t* sums, const uint8_t* p, int n) {
+        int x = 0;
+#if defined(SI_SIMD_AVX2) || defined(SI_SIMD_SSE2)
+        __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= n; x += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(p + x));
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            __m128i* s = (__m128i*)(sums + x);
+            _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(lo, zero)));
+            _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(lo, zero)));
+            _mm_storeu_si128(s + 2, _mm_add_epi32(_mm_loadu_si128(s + 2), _mm_unpacklo_epi16(hi, zero)));
+            _mm_storeu_si128(s + 3, _mm_add_epi32(_mm_loadu_si128(s + 3), _mm_unpackhi_epi16(hi, zero)));
+        }
+#elif defined(SI_SIMD_NEON)
+        for (; x + 16 <= n; x += 16) {
+            uint8x16_t bytes = vld1q_u8(p + x);
+            uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+            uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+            vst1q_u32(sums + x, vaddw_u16(vld1q_u32(sums + x), vget_low_u16(lo)));
+            vst1q_u32(sums + x + 4, vaddw_u16(vld1q_u32(sums + x + 4), vget_high_u16(lo)));
+            vst1q_u32(sums + x + 8, vaddw_u16(vld1q_u32(sums + x + 8), vget_low_u16(hi)));
+            vst1q_u32(sums + x + 12, vaddw_u16(vld1q_u32(sums + x + 12), vget_high_u16(hi)));
+        }
+#endif
+        for (; x < n; x++) sums[x] += p[x];
+    }
+
+    static void addRgbaRow(uint32_t* sums, const uint8_t* p, int n) {
+        int x = 0;
+#if defined(SI_SIMD_AVX2) || defined(SI_SIMD_SSE2)
+        __m128i zero = _mm_setzero_si128();
+        __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+        for (; x + 4 <= n; x += 4) {
+            __m128i pixels4 = _mm_loadu_si128((const __m128i*)(p + x * 4));
+            // Per pixel: r*77 + g*150 and b*29, then the two added
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels4, zero), weights);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels4, zero), weights);
+            __m128 rg = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 b = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+            __m128i l = _mm_srli_epi32(_mm_add_epi32(_mm_castps_si128(rg), _mm_castps_si128(b)), 8);
+            __m128i* s = (__m128i*)(sums + x);
+            _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), l));
+        }
+#elif defined(SI_SIMD_NEON)
+        for (; x + 8 <= n; x += 8) {
+            uint8x8x4_t px = vld4_u8(p + x * 4);
+            uint16x8_t l = vmull_u8(px.val[0], vdup_n_u8(77));
+            l = vmlal_u8(l, px.val[1], vdup_n_u8(150));
+            l = vmlal_u8(l, px.val[2], vdup_n_u8(29));
+            l = vshrq_n_u16(l, 8);
+            vst1q_u32(sums + x, vaddw_u16(vld1q_u32(sums + x), vget_low_u16(l)));
+            vst1q_u32(sums + x + 4, vaddw_u16(vld1q_u32(sums + x + 4), vget_high_u16(l)));
+        }
+#endif
+        for (; x < n; x++) sums[x] += luma(p[x * 4], p[x * 4 + 1], p[x * 4 + 2]);
+    }
+
+    // Atlas texel `t` (RGBA), modulated by `color`, blended over the pixel
+    // at `p`. Glyph texels are white, so they come out in `color`.
+    void plotTexel(uint8_t* p, const uint8_t* t, SDL_Color color) const {
+        unsigned a = mul255(t[3], color.a);
+        if (a == 0) return;
+        unsigned r = mul255(t[0], color.r), g = mul255(t[1], color.g), b = mul255(t[2], color.b);
+        if (a == 255) {
+            if (format == RASTER_GRAY8) {
+                p[0] = (uint8_t)luma(r, g, b);
+            } else {
+                p[0] = (uint8_t)r;
+                p[1] = (uint8_t)g;
+                p[2] = (uint8_t)b;
+                p[3] = 255;
+            }
+            return;
+        }
+        unsigned inverse = 255 - a;
+        if (format == RASTER_GRAY8) {
+            p[0] = (uint8_t)(mul255(p[0], inverse) + mul255(luma(r, g, b), a));
+        } else {
+            p[0] = (uint8_t)(mul255(p[0], inverse) + mul255(r, a));
+            p[1] = (uint8_t)(mul255(p[1], inverse) + mul255(g, a));
+            p[2] = (uint8_t)(mul255(p[2], inverse) + mul255(b, a));
+            p[3] = (uint8_t)(mul255(p[3], inverse) + a);
+        }
+    }
+
+public:
+    SoftRaster()
+        : pixels(nullptr), width(0), height(0), pitch(0), format(RASTER_RGBA32), bytesPerPixel(4),
+          layer(nullptr), outerPixels(nullptr), outerWidth(0), outerHeight(0), outerPitch(0),
+          outerFormat(RASTER_RGBA32) {}
+
+    // Draw into `target`: width x height pixels, rows `rowPitch` bytes apart
+    SoftRaster(void* target, int w, int h, int rowPitch, RasterFormat pixelFormat) : SoftRaster() {
+        setTarget(target, w, h, rowPitch, pixelFormat);
+    }
+
+    void setTarget(void* target, int w, int h, int rowPitch, RasterFormat pixelFormat) {
+        pixels = (uint8_t*)target;
+        width = w;
+        height = h;
+        pitch = rowPitch;
+        format = pixelFormat;
+        bytesPerPixel = format == RASTER_GRAY8 ? 1 : 4;
+    }
+
+    // Bytes for a tightly packed buffer of this size and format
+    static size_t bufferSize(int w, int h, RasterFormat pixelFormat) {
+        return (size_t)w * h * (pixelFormat == RASTER_GRAY8 ? 1 : 4);
+    }
+
+    int targetWidth() const { return width; }
+    int targetHeight() const { return height; }
+    RasterFormat targetFormat() const { return format; }
+
+    void clear(SDL_Color color) override {
+        uint8_t fill[16];
+        pattern(color, fill);
+        size_t rowBytes = (size_t)width * bytesPerPixel;
+        if ((size_t)pitch == rowBytes) {
+            fillSpan(pixels, rowBytes * height, fill);
+            return;
+        }
+        for (int y = 0; y < height; y++) fillSpan(row(y), rowBytes, fill);
+    }
+
+    void fillRects(SDL_Color color, const SDL_Rect* rects, int count) override {
+        if (color.a == 0) return;
+        bool opaque = color.a == 255;
+        uint8_t bytes[16];
+        if (opaque) {
+            pattern(color, bytes);
+        } else {
+            blendPattern(color, bytes);
+        }
+
+        for (int i = 0; i < count; i++) {
+            int x0, y0, x1, y1;
+            if (!clip(rects[i], x0, y0, x1, y1)) continue;
+            size_t spanBytes = (size_t)(x1 - x0) * bytesPerPixel;
+            for (int y = y0; y < y1; y++) {
+                uint8_t* p = row(y) + (size_t)x0 * bytesPerPixel;
+                if (opaque) {
+                    fillSpan(p, spanBytes, bytes);
+                } else {
+                    blendSpan(p, spanBytes, 255 - color.a, bytes);
+                }
+            }
+        }
+    }
+
+    // Quads drawn in white from an indexed atlas (sprites) copy each row
+    // that is opaque throughout; the rest go texel by texel
+    void drawQuads(TextureAtlas& atlas, const AtlasQuad* quads, int count) override {
+        const SDL_Surface* surface = atlas.pixels();
+        if (!surface) return;
+        const uint8_t* texels = (const uint8_t*)surface->pixels;
+
+        for (int i = 0; i < count; i++) {
+            const AtlasQuad& quad = quads[i];
+            SDL_Rect dest = {quad.x, quad.y, quad.src.w, quad.src.h};
+            int x0, y0, x1, y1;
+            if (!clip(dest, x0, y0, x1, y1)) continue;
+            bool white = quad.color.r == 255 && quad.color.g == 255 &&
+                         quad.color.b == 255 && quad.color.a == 255;
+            int sx = quad.src.x + x0 - quad.x;
+            for (int y = y0; y < y1; y++) {
+                int sy = quad.src.y + y - quad.y;
+                const uint8_t* src = texels + (size_t)sy * surface->pitch + (size_t)sx * 4;
+                uint8_t* p = row(y) + (size_t)x0 * bytesPerPixel;
+                if (white && atlas.opaqueRun(sx, sy) >= x1 - x0) {
+                    if (format == RASTER_GRAY8) {
+                        memcpy(p, atlas.lumaRow(sx, sy), x1 - x0);
+                    } else {
+                        memcpy(p, src, (size_t)(x1 - x0) * 4);
+                    }
+                    continue;
+                }
+                for (int x = x0; x < x1; x++, src += 4, p += bytesPerPixel) {
+                    if (src[3]) plotTexel(p, src, quad.color);
+                }
+            }
+        }
+    }
+
+    // Layers are RGBA surfaces whatever the target's format; they blend
+    // onto it as atlases do
+    bool beginLayer(RenderLayer& into) override {
+        SDL_Surface* surface = into.surfaceForDrawing();
+        if (!surface || layer) return false;
+        layer = &into;
+        outerPixels = pixels;
+        outerWidth = width;
+        outerHeight = height;
+        outerPitch = pitch;
+        outerFormat = format;
+        setTarget(surface->pixels, surface->w, surface->h, surface->pitch, RASTER_RGBA32);
+        SDL_Color transparent = {0, 0, 0, 0};
+        clear(transparent);
+        return true;
+    }
+
+    void endLayer() override {
+        if (!layer) return;
+        layer->finishDrawing();
+        layer = nullptr;
+        setTarget(outerPixels, outerWidth, outerHeight, outerPitch, outerFormat);
+    }
+
+    void drawLayer(RenderLayer& from, int x, int y) override {
+        SDL_Color white = {255, 255, 255, 255};
+        AtlasQuad quad = {{0, 0, from.width(), from.height()}, x, y, white};
+        drawQuads(from, &quad, 1);
+    }
+
+    // Box-filter the frame down to outWidth x outHeight grayscale pixels
+    // into `out` (tightly packed). The sizes must divide the target's
+    // evenly, e.g. 800x600 to 200x150 or 100x75; false otherwise.
+    bool downsample(uint8_t* out, int outWidth, int outHeight) {
+        if (outWidth <= 0 || outHeight <= 0 || width % outWidth || height % outHeight) return false;
+        int fx = width / outWidth, fy = height / outHeight;
+        uint32_t area = (uint32_t)(fx * fy);
+        if (columnSums.size() < (size_t)width) columnSums.resize(width);
+        uint32_t* sums = columnSums.data();
+
+        for (int oy = 0; oy < outHeight; oy++) {
+            // Sum each column over the fy source rows, then fx columns per pixel
+            std::fill(sums, sums + width, 0);
+            for (int y = oy * fy; y < (oy + 1) * fy; y++) {
+                if (format == RASTER_GRAY8) {
+                    addGrayRow(sums, row(y), width);
+                } else {
+                    addRgbaRow(sums, row(y), width);
+                }
+            }
+            const uint32_t* column = sums;
+            for (int ox = 0; ox < outWidth; ox++, column += fx) {
+                uint32_t sum = 0;
+                for (int k = 0; k < fx; k++) sum += column[k];
+                out[(size_t)oy * outWidth + ox] = (uint8_t)((sum + area / 2) / area);
+            }
+        }
+        return true;
+    }
+
+    // Write the frame as a binary PPM (RGBA, alpha dropped) or PGM (gray)
+    bool writePnm(const char* path) const {
+        FILE* file = fopen(path, "wb");
+        if (!file) return false;
+        fprintf(file, "%s\n%d %d\n255\n", format == RASTER_GRAY8 ? "P5" : "P6", width, height);
+        bool ok = true;
+        for (int y = 0; y < height && ok; y++) {
+            const uint8_t* p = row(y);
+            if (format == RASTER_GRAY8) {
+                ok = fwrite(p, 1, width, file) == (size_t)width;
+                continue;
+            }
+            for (int x = 0; x < width && ok; x++, p += 4) ok = fwrite(p, 1, 3, file) == 3;
+        }
+        return fclose(file) == 0 && ok;
+    }
+};
+
+#endif
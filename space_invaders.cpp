@@ -4,241 +4,211 @@
 #include <vector>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <chrono>
 #include <algorithm>
-#include <string>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include "simulation.h"
+#include "game_renderer.h"
+#include "sdl_backend.h"
+#include "soft_raster.h"
+#include "frame_snapshot.h"
+#include "triple_buffer.h"
+#include "spsc_queue.h"
+#include "replay.h"
+#include "batch_sim.h"
+#include "snapshot_ring.h"
+#include "frame_capture.h"
+#include "event_log.h"
+#include "net_session.h"
+#include "latency_histogram.h"
+#include "autopilot.h"
+#include "particle_system.h"
+#include "alloc_counter.h"
 using namespace std;
 
-// Constants
-const int SCREEN_WIDTH = 800;
-const int SCREEN_HEIGHT = 600;
-const int PLAYER_WIDTH = 40;
-const int PLAYER_HEIGHT = 30;
-const int ENEMY_WIDTH = 30;
-const int ENEMY_HEIGHT = 30;
-const int BULLET_WIDTH = 4;
-const int BULLET_HEIGHT = 12;
-const int PLAYER_SPEED = 5;
-const int BULLET_SPEED = 7;
-const int ENEMY_BULLET_SPEED = 4;
-const int ENEMY_SPACING_X = 60;
-const int ENEMY_SPACING_Y = 50;
-
-// Enemy formation patterns
-enum Pattern {
-    PATTERN_CLASSIC,    // Traditional rows
-    PATTERN_DIAMOND,    // Diamond formation
-    PATTERN_V_SHAPE,    // V formation
-    PATTERN_CIRCLE,     // Circular formation
-    PATTERN_WAVE        // Wave pattern
-};
-
-// Entity structures
-struct Entity {
-    float x, y;
-    int width, height;
-    bool active;
-    
-    Entity(float x = 0, float y = 0, int w = 0, int h = 0) 
-        : x(x), y(y), width(w), height(h), active(true) {}
-    
-    bool collidesWith(const Entity& other) const {
-        return active && other.active &&
-               x < other.x + other.width &&
-               x + width > other.x &&
-               y < other.y + other.height &&
-               y + height > other.y;
+// Holds a target frame time using the high-resolution counter. SDL_Delay
+// alone can overshoot by a millisecond or more, so it sleeps until the
+// deadline is within the worst oversleep seen so far, then spins the rest.
+// The sleep can be taken in one-millisecond slices with a callback between
+// them, so input keeps being read while the frame waits.
+class FramePacer {
+private:
+    Uint64 frequency;
+    Uint64 frameTicks;     // Target frame length in counter ticks (0 = uncapped)
+    Uint64 nextFrame;      // Counter value of the next frame deadline
+    Uint64 spinMargin;     // Leave this much to the spin loop after sleeping
+    
+public:
+    explicit FramePacer(double targetFps)
+        : frequency(SDL_GetPerformanceFrequency()), frameTicks(0), nextFrame(0) {
+        spinMargin = frequency / 500;  // Start at 2 ms, adapt from there
+        setTargetFps(targetFps);
+    }
+    
+    void setTargetFps(double targetFps) {
+        frameTicks = targetFps > 0 ? (Uint64)(frequency / targetFps) : 0;
+        nextFrame = SDL_GetPerformanceCounter() + frameTicks;
+    }
+    
+    // Block until the current frame's deadline
+    void wait() { wait([] {}); }
+    
+    // Block until the current frame's deadline, calling `idle` about once
+    // a millisecond until the last slice
+    template<typename Idle>
+    void wait(Idle idle) {
+        if (frameTicks == 0) return;
+        
+        Uint64 slice = frequency / 1000;
+        Uint64 now = SDL_GetPerformanceCounter();
+        while (now < nextFrame && nextFrame - now > spinMargin + slice) {
+            idle();
+            Uint64 before = SDL_GetPerformanceCounter();
+            SDL_Delay(1);
+            now = SDL_GetPerformanceCounter();
+            if (now - before > slice && now - before - slice > spinMargin) {
+                spinMargin = now - before - slice;
+            }
+        }
+        
+        if (now < nextFrame && nextFrame - now > spinMargin) {
+            Uint64 sleepTicks = nextFrame - now - spinMargin;
+            Uint32 sleepMs = (Uint32)(sleepTicks * 1000 / frequency);
+            if (sleepMs > 0) {
+                SDL_Delay(sleepMs);
+                Uint64 woke = SDL_GetPerformanceCounter();
+                Uint64 requested = (Uint64)sleepMs * frequency / 1000;
+                Uint64 slept = woke - now;
+                if (slept > requested && slept - requested > spinMargin) {
+                    spinMargin = slept - requested;
+                }
+            }
+        }
+        
+        while (SDL_GetPerformanceCounter() < nextFrame) {
+            // Spin out the last fraction of a millisecond
+        }
+        
+        nextFrame += frameTicks;
+        
+        // If we fell more than a frame behind, don't try to catch up in a burst
+        now = SDL_GetPerformanceCounter();
+        if (now > nextFrame) nextFrame = now + frameTicks;
     }
 };
 
-struct Player : Entity {
-    int lives;
-    Player(float x, float y) : Entity(x, y, PLAYER_WIDTH, PLAYER_HEIGHT), lives(3) {}
-};
+const int REWIND_TICKS = 10 * SIM_TICKS_PER_SECOND;  // How far Backspace can rewind
+const int SIM_STATS_INTERVAL = 30;  // Ticks between copies of the sim thread's phase timings
 
-struct Enemy : Entity {
-    int type;
-    float originalX, originalY;  // For pattern movement
-    Enemy(float x, float y, int t = 0) 
-        : Entity(x, y, ENEMY_WIDTH, ENEMY_HEIGHT), type(t), originalX(x), originalY(y) {}
-};
+// Where playback stopped matching the recording: one tick when every tick
+// is checked, otherwise the check interval it happened in
+void reportDesync(const ReplayReader& replay) {
+    cout << "Replay desync ";
+    if (replay.desyncFrom() == replay.desyncTick()) cout << "at tick " << replay.desyncTick();
+    else cout << "between ticks " << replay.desyncFrom() << " and " << replay.desyncTick();
+    cout << ": the state no longer matches the recording" << endl;
+}
 
-struct Bullet : Entity {
-    bool fromPlayer;
-    Bullet(float x, float y, bool fp) 
-        : Entity(x, y, BULLET_WIDTH, BULLET_HEIGHT), fromPlayer(fp) {}
+// Keyboard state sampled on the main thread, for the simulation's next
+// ticks. Times are on the steady clock, taken from the SDL events.
+struct InputMessage {
+    InputBits held;        // Movement keys down when sampled
+    bool fire;             // Space pressed since the last message
+    bool rewind;           // Backspace down (and rewinding allowed)
+    int64_t fireNs;        // When Space was pressed, if `fire`
+    int64_t changeNs;      // When `held` changed from the last message (0: it didn't)
 };
 
-// Game class
+// Game class: SDL window, input and rendering around a Simulation. By
+// default the simulation runs on its own thread at a fixed tick rate and
+// publishes a FrameSnapshot after every tick; the main thread owns SDL,
+// forwards input through a queue and draws the newest snapshot. Neither
+// thread waits on the other, so a slow frame never delays a tick. In a
+// networked game the same thread talks to the server instead of ticking.
 class SpaceInvaders {
 private:
     SDL_Window* window;
     SDL_Renderer* renderer;
     TTF_Font* font;
     TTF_Font* largeFont;
-    bool running;
-    
-    Player player;
-    vector<Enemy> enemies;
-    vector<Bullet> bullets;
-    
-    float enemyDirection;
-    float enemySpeed;
-    int score;
-    int frameCount;
-    bool gameOver;
-    bool victory;
-    
-    // Level system
-    int level;
-    int enemiesKilledThisLevel;
-    bool levelTransition;
-    int transitionTimer;
-    Pattern currentPattern;
-    
-    void initEnemies() {
-        enemies.clear();
-        
-        // Determine pattern based on level
-        currentPattern = (Pattern)(level % 5);
-        
-        // Calculate number of enemies (increases with level)
-        int rows = 4 + (level / 3);  // More rows every 3 levels
-        int cols = 8 + (level / 2);  // More columns every 2 levels
-        
-        // Cap maximum enemies
-        if (rows > 8) rows = 8;
-        if (cols > 12) cols = 12;
-        
-        float centerX = SCREEN_WIDTH / 2;
-        float centerY = 150;
-        
-        switch(currentPattern) {
-            case PATTERN_CLASSIC:
-                createClassicPattern(rows, cols);
-                break;
-            case PATTERN_DIAMOND:
-                createDiamondPattern();
-                break;
-            case PATTERN_V_SHAPE:
-                createVPattern();
-                break;
-            case PATTERN_CIRCLE:
-                createCirclePattern();
-                break;
-            case PATTERN_WAVE:
-                createWavePattern(rows, cols);
-                break;
-        }
-        
-        // Reset enemy movement
-        enemyDirection = 1.0f;
-        enemySpeed = 0.5f + (level * 0.15f);  // Faster each level
-        enemiesKilledThisLevel = 0;
-    }
+    SdlBackend backend;         // Submits draws to `renderer`
+    GameRenderer view;          // Draws snapshots through `backend`
+    atomic<bool> running;       // Cleared by either thread to end the game
+    bool threaded;              // Simulation on its own thread
     
-    void createClassicPattern(int rows, int cols) {
-        float startX = (SCREEN_WIDTH - (cols * ENEMY_SPACING_X)) / 2;
-        float startY = 80;
-        
-        for (int row = 0; row < rows; row++) {
-            for (int col = 0; col < cols; col++) {
-                float x = startX + col * ENEMY_SPACING_X;
-                float y = startY + row * ENEMY_SPACING_Y;
-                int type = row % 4;
-                enemies.push_back(Enemy(x, y, type));
-            }
-        }
-    }
+    double targetFps;
+    float renderAlpha;     // How far between the last two sim steps we are drawing
+    bool firePressed;      // Space seen but not yet sent to the simulation
+    int64_t fireNs;        // When that press happened
+    int64_t moveNs;        // Oldest movement key event not yet sent
+    InputBits sentHeld;    // Movement keys in the last message sent
+    bool sentRewind;
+    bool lateInput;        // Keep reading input while the pacer waits
+    LatencyHistogram latency;  // Key event to present, per tick that applied input
+    int64_t measuredInputNs;   // Snapshot input time last added to `latency`
     
-    void createDiamondPattern() {
-        float centerX = SCREEN_WIDTH / 2;
-        float startY = 80;
-        int size = 5 + level / 2;
-        if (size > 8) size = 8;
-        
-        for (int row = 0; row < size; row++) {
-            int enemiesInRow = (row < size/2) ? (row * 2 + 1) : ((size - row - 1) * 2 + 1);
-            float rowWidth = enemiesInRow * ENEMY_SPACING_X;
-            float startX = centerX - rowWidth / 2;
-            
-            for (int i = 0; i < enemiesInRow; i++) {
-                float x = startX + i * ENEMY_SPACING_X;
-                float y = startY + row * ENEMY_SPACING_Y;
-                enemies.push_back(Enemy(x, y, row % 4));
-            }
-        }
-    }
+    SpscQueue<InputMessage> inputQueue;       // Main thread -> simulation
+    TripleBuffer<FrameSnapshot> frames;       // Simulation -> main thread
+    thread simThread;
     
-    void createVPattern() {
-        float centerX = SCREEN_WIDTH / 2;
-        float startY = 80;
-        int size = 6 + level / 2;
-        if (size > 10) size = 10;
-        
-        for (int row = 0; row < size; row++) {
-            // Left arm of V
-            float leftX = centerX - row * 30;
-            float y = startY + row * ENEMY_SPACING_Y;
-            enemies.push_back(Enemy(leftX, y, row % 4));
-            
-            // Right arm of V
-            float rightX = centerX + row * 30;
-            enemies.push_back(Enemy(rightX, y, row % 4));
-        }
-    }
+    // Simulation side: only the simulation thread touches these while it runs
+    Simulation sim;
+    ReplayReader* replay;  // Inputs come from here instead of the keyboard
+    ReplayWriter* recorder;// Every step's inputs are appended here
+    SnapshotRing history;  // Recent ticks, for rewinding with Backspace
+    long long ticksRun;
+    InputBits heldInput;   // Latest input received from the main thread
+    bool fireLatched;      // A fire press not yet consumed by a tick
+    int64_t fireLatchedNs; // When that press happened
+    bool subframeShots;    // Time shots within the tick (INPUT_FIRE_DELAY)
+    int64_t stepDueNs;     // When the tick being run was due
+    int64_t pendingInputNs;// Oldest key event received but not yet ticked
+    int64_t appliedInputNs;// Oldest key event of the last tick that applied any
+    bool rewinding;
+    PhaseStats simStats[3];
+    bool hasSimStats;
     
-    void createCirclePattern() {
-        float centerX = SCREEN_WIDTH / 2;
-        float centerY = 150;
-        float radius = 100 + level * 10;
-        int numEnemies = 12 + level * 2;
-        if (numEnemies > 30) numEnemies = 30;
-        
-        for (int i = 0; i < numEnemies; i++) {
-            float angle = (2 * M_PI * i) / numEnemies;
-            float x = centerX + radius * cos(angle) - ENEMY_WIDTH / 2;
-            float y = centerY + radius * sin(angle) - ENEMY_HEIGHT / 2;
-            enemies.push_back(Enemy(x, y, i % 4));
-        }
+    FrameCapture* capture; // Presented frames are recorded here
+    NetClient* net;        // Remote game: input goes to the server, worlds come back
+    
+    // Effects: the simulation's events reach the particles through the
+    // feed, and the event log (if any) through the tee as well
+    GameEventSink* eventLog;
+    ParticleFeed particleFeed;
+    GameEventTee eventTee;
+    ParticleSystem particles;
+    bool particlesOn;
+    
+    long long totalDrawCalls;
+    long long framesDrawn;
+    int maxDrawCalls;
+    
+    static int64_t steadyNowNs() {
+        return chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
     }
     
-    void createWavePattern(int rows, int cols) {
-        float startX = (SCREEN_WIDTH - (cols * ENEMY_SPACING_X)) / 2;
-        float startY = 80;
-        
-        for (int row = 0; row < rows; row++) {
-            for (int col = 0; col < cols; col++) {
-                float x = startX + col * ENEMY_SPACING_X;
-                // Create sine wave
-                float waveOffset = sin((col / (float)cols) * M_PI * 2) * 30;
-                float y = startY + row * ENEMY_SPACING_Y + waveOffset;
-                enemies.push_back(Enemy(x, y, row % 4));
-            }
-        }
+    // An SDL event timestamp (milliseconds since SDL_Init) on the steady clock
+    static int64_t eventNs(Uint32 timestamp) {
+        Uint32 age = SDL_GetTicks() - timestamp;
+        if (age > 1000) age = 0;  // Timestamp from the future or long stale
+        return steadyNowNs() - (int64_t)age * 1000000;
     }
     
-    void renderText(const string& text, int x, int y, SDL_Color color, TTF_Font* fontToUse = nullptr) {
-        if (fontToUse == nullptr) fontToUse = font;
-        if (!fontToUse) return;
-        
-        SDL_Surface* surface = TTF_RenderText_Solid(fontToUse, text.c_str(), color);
-        if (!surface) return;
-        
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-        if (!texture) {
-            SDL_FreeSurface(surface);
-            return;
-        }
-        
-        SDL_Rect destRect = {x, y, surface->w, surface->h};
-        SDL_RenderCopy(renderer, texture, nullptr, &destRect);
-        
-        SDL_DestroyTexture(texture);
-        SDL_FreeSurface(surface);
+    static bool isMoveKey(SDL_Scancode key) {
+        return key == SDL_SCANCODE_LEFT || key == SDL_SCANCODE_A ||
+               key == SDL_SCANCODE_RIGHT || key == SDL_SCANCODE_D;
     }
     
+    // Poll SDL events. Space is latched until it has been sent to the
+    // simulation, so a press is never lost between ticks.
     void handleInput() {
+        PROFILE_SCOPE(PHASE_INPUT);
+        
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
@@ -246,343 +216,268 @@ private:
             }
             
             if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_SPACE) {
-                if (gameOver) {
-                    // Restart game
-                    score = 0;
-                    level = 1;
-                    player.lives = 3;
-                    player.x = SCREEN_WIDTH / 2 - PLAYER_WIDTH / 2;
-                    player.active = true;
-                    bullets.clear();
-                    initEnemies();
-                    gameOver = false;
-                    victory = false;
-                    levelTransition = false;
-                } else if (levelTransition) {
-                    // Skip level transition
-                    levelTransition = false;
-                    initEnemies();
-                } else if (victory) {
-                    // Continue to next level
-                    victory = false;
-                    level++;
-                    levelTransition = true;
-                    transitionTimer = 0;
-                } else {
-                    // Shoot
-                    bullets.push_back(Bullet(player.x + PLAYER_WIDTH/2 - BULLET_WIDTH/2, 
-                                            player.y, true));
-                }
+                if (!firePressed) fireNs = eventNs(event.key.timestamp);
+                firePressed = true;
             }
-        }
-        
-        if (!gameOver && !victory && !levelTransition) {
-            const Uint8* keyState = SDL_GetKeyboardState(NULL);
             
-            if (keyState[SDL_SCANCODE_LEFT] || keyState[SDL_SCANCODE_A]) {
-                player.x -= PLAYER_SPEED;
-                if (player.x < 0) player.x = 0;
+            if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && !event.key.repeat &&
+                isMoveKey(event.key.keysym.scancode) && moveNs == 0) {
+                moveNs = eventNs(event.key.timestamp);
             }
-            if (keyState[SDL_SCANCODE_RIGHT] || keyState[SDL_SCANCODE_D]) {
-                player.x += PLAYER_SPEED;
-                if (player.x > SCREEN_WIDTH - PLAYER_WIDTH) 
-                    player.x = SCREEN_WIDTH - PLAYER_WIDTH;
+            
+            // F3 toggles the phase timing overlay
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+                view.toggleProfile();
+            }
+            
+            // Some renderers (Direct3D) drop what was drawn into render
+            // targets, which holds the cached panels
+            if (event.type == SDL_RENDER_TARGETS_RESET) {
+                view.invalidatePanels();
             }
         }
     }
     
-    void updateEnemies() {
-        if (enemies.empty()) {
-            victory = true;
-            return;
-        }
-        
-        bool shouldMoveDown = false;
+    // Backspace held: run time backwards, one snapshot per sim step. Off
+    // while recording or replaying, where every tick must move forward.
+    bool rewindHeld() const {
+        if (replay || recorder || net) return false;
+        return SDL_GetKeyboardState(NULL)[SDL_SCANCODE_BACKSPACE] != 0;
+    }
+    
+    // Send the keyboard state to the simulation if it has changed or Space
+    // was pressed. A fire press stays latched here if the queue is full and
+    // goes out with the next message.
+    void sendInput() {
+        InputMessage message = {0, firePressed, rewindHeld(), firePressed ? fireNs : 0, 0};
+        const Uint8* keyState = SDL_GetKeyboardState(NULL);
         
-        // Check if any enemy hit screen edge
-        for (auto& enemy : enemies) {
-            if (!enemy.active) continue;
-            
-            if ((enemyDirection > 0 && enemy.x + ENEMY_WIDTH >= SCREEN_WIDTH - 10) ||
-                (enemyDirection < 0 && enemy.x <= 10)) {
-                shouldMoveDown = true;
-                break;
-            }
+        if (keyState[SDL_SCANCODE_LEFT] || keyState[SDL_SCANCODE_A]) {
+            message.held |= INPUT_LEFT;
         }
-        
-        // Move enemies
-        for (auto& enemy : enemies) {
-            if (!enemy.active) continue;
-            
-            enemy.x += enemyDirection * enemySpeed;
-            
-            if (shouldMoveDown) {
-                enemy.y += ENEMY_HEIGHT / 2;
-                
-                // Check if enemies reached player
-                if (enemy.y + ENEMY_HEIGHT >= player.y) {
-                    gameOver = true;
-                }
-            }
+        if (keyState[SDL_SCANCODE_RIGHT] || keyState[SDL_SCANCODE_D]) {
+            message.held |= INPUT_RIGHT;
         }
         
-        if (shouldMoveDown) {
-            enemyDirection *= -1;
+        if (!message.fire && message.held == sentHeld && message.rewind == sentRewind) {
+            moveNs = 0;  // A key event that changed nothing (Left with A down)
+            return;
         }
-        
-        // Random enemy shooting (more frequent at higher levels)
-        int shootFrequency = max(30, 60 - level * 3);
-        if (frameCount % shootFrequency == 0 && !enemies.empty()) {
-            vector<Enemy*> activeEnemies;
-            for (auto& enemy : enemies) {
-                if (enemy.active) activeEnemies.push_back(&enemy);
-            }
-            
-            if (!activeEnemies.empty()) {
-                // Multiple enemies can shoot at higher levels
-                int numShooters = 1 + (level / 4);
-                if (numShooters > 3) numShooters = 3;
-                
-                for (int i = 0; i < numShooters && i < (int)activeEnemies.size(); i++) {
-                    Enemy* shooter = activeEnemies[rand() % activeEnemies.size()];
-                    bullets.push_back(Bullet(shooter->x + ENEMY_WIDTH/2 - BULLET_WIDTH/2,
-                                            shooter->y + ENEMY_HEIGHT, false));
-                }
-            }
+        if (message.held != sentHeld) message.changeNs = moveNs ? moveNs : steadyNowNs();
+        if (inputQueue.push(message)) {
+            firePressed = false;
+            moveNs = 0;
+            sentHeld = message.held;
+            sentRewind = message.rewind;
         }
     }
     
-    void updateBullets() {
-        for (auto& bullet : bullets) {
-            if (!bullet.active) continue;
-            
-            if (bullet.fromPlayer) {
-                bullet.y -= BULLET_SPEED;
-                if (bullet.y < 0) bullet.active = false;
-            } else {
-                bullet.y += ENEMY_BULLET_SPEED;
-                if (bullet.y > SCREEN_HEIGHT) bullet.active = false;
+    // Read and forward input; the pacer calls this while the frame waits
+    void pumpInput() {
+        handleInput();
+        sendInput();
+    }
+    
+    // Simulation side: take every message sent since the last tick
+    void receiveInput() {
+        InputMessage message;
+        while (inputQueue.pop(message)) {
+            heldInput = message.held;
+            rewinding = message.rewind;
+            if (message.fire && !fireLatched) {
+                fireLatched = true;
+                fireLatchedNs = message.fireNs;
             }
+            noteInput(message.changeNs);
+            if (message.fire) noteInput(message.fireNs);
         }
-        
-        // Remove inactive bullets
-        bullets.erase(remove_if(bullets.begin(), bullets.end(),
-            [](const Bullet& b) { return !b.active; }), bullets.end());
     }
     
-    void checkCollisions() {
-        // Player bullets vs enemies
-        for (auto& bullet : bullets) {
-            if (!bullet.active || !bullet.fromPlayer) continue;
-            
-            for (auto& enemy : enemies) {
-                if (!enemy.active) continue;
-                
-                if (bullet.collidesWith(enemy)) {
-                    bullet.active = false;
-                    enemy.active = false;
-                    // Score increases with level
-                    int baseScore = (4 - enemy.type) * 10;
-                    score += baseScore * level;
-                    enemiesKilledThisLevel++;
-                    break;
-                }
-            }
+    void noteInput(int64_t ns) {
+        if (ns != 0 && (pendingInputNs == 0 || ns < pendingInputNs)) pendingInputNs = ns;
+    }
+    
+    // INPUT_FIRE_DELAY for a press at `pressNs`: how far into the interval
+    // before the tick due at stepDueNs it came
+    InputBits fireDelay(int64_t pressNs) const {
+        const int64_t tickNs = 1000000000LL / SIM_TICKS_PER_SECOND;
+        if (pressNs == 0 || stepDueNs == 0) return 0;
+        int64_t quarters = (pressNs - (stepDueNs - tickNs)) * 4 / tickNs;
+        quarters = max<int64_t>(0, min<int64_t>(3, quarters));
+        return (InputBits)(quarters << INPUT_FIRE_DELAY_SHIFT);
+    }
+    
+    // Inputs for the next sim step, from the replay when there is one.
+    // False once the replay has run out.
+    bool nextStepInputs(InputBits* inputs) {
+        if (replay) return replay->next(inputs);
+        inputs[0] = heldInput;
+        if (fireLatched) {
+            inputs[0] |= INPUT_FIRE;
+            if (subframeShots) inputs[0] |= fireDelay(fireLatchedNs);
+            fireLatched = false;
         }
-        
-        // Enemy bullets vs player
-        for (auto& bullet : bullets) {
-            if (!bullet.active || bullet.fromPlayer) continue;
-            
-            if (bullet.collidesWith(player)) {
-                bullet.active = false;
-                player.lives--;
-                
-                if (player.lives <= 0) {
-                    gameOver = true;
-                    player.active = false;
-                }
-                break;
-            }
+        return true;
+    }
+    
+    // One sim step, or one step back while rewinding. False when the
+    // replay has run out or stopped matching the recorded states.
+    bool tick() {
+        if (rewinding) {
+            if (history.pop(sim)) ticksRun--;
+            return true;
         }
-        
-        // Remove dead enemies
-        enemies.erase(remove_if(enemies.begin(), enemies.end(),
-            [](const Enemy& e) { return !e.active; }), enemies.end());
+        InputBits inputs[MAX_PLAYERS] = {0};
+        if (!nextStepInputs(inputs)) {
+            cout << "Replay finished after " << replay->ticksDone() << " ticks" << endl;
+            return false;
+        }
+        history.push(sim, ticksRun);
+        sim.step(inputs);
+        ticksRun++;
+        if (recorder) recorder->record(inputs, sim);
+        if (replay && !replay->verify(sim)) {
+            reportDesync(*replay);
+            return false;
+        }
+        return true;
     }
     
-    void drawPlayer() {
-        if (!player.active) return;
-        
-        SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
-        
-        // Draw player ship
-        SDL_Rect body = {(int)player.x, (int)player.y + 10, PLAYER_WIDTH, 20};
-        SDL_RenderFillRect(renderer, &body);
-        
-        // Draw cockpit
-        SDL_Rect cockpit = {(int)player.x + 15, (int)player.y, 10, 15};
-        SDL_RenderFillRect(renderer, &cockpit);
+    // Snapshot the state after a tick for the renderer. `dueNs` is when the
+    // tick was scheduled, on the steady clock. The input time carries over
+    // to later snapshots, so it is not lost if the renderer skips one.
+    void publishFrame(int64_t dueNs) {
+        if (pendingInputNs != 0) {
+            appliedInputNs = pendingInputNs;
+            pendingInputNs = 0;
+        }
+        FrameSnapshot& frame = frames.writeBuffer();
+        frame.capture(sim, ticksRun, dueNs);
+        frame.inputNs = appliedInputNs;
+        frame.hasSimStats = hasSimStats;
+        copy(simStats, simStats + 3, frame.simStats);
+        frames.publish();
     }
     
-    void drawEnemies() {
-        for (const auto& enemy : enemies) {
-            if (!enemy.active) continue;
+    // The simulation thread: tick on a fixed schedule, sleeping in between,
+    // and publish a snapshot after every tick. If it falls more than a few
+    // ticks behind (a stall, a debugger) it resets the schedule instead of
+    // catching up in a burst.
+    void simLoop() {
+        const chrono::nanoseconds tickLength(1000000000LL / SIM_TICKS_PER_SECOND);
+        const int MAX_LAG_TICKS = 5;
+        
+        // This thread's profiler; its phase timings reach the overlay
+        // through the snapshots
+        Profiler& profiler = frameProfiler();
+        profiler.setActive(true);
+        
+        chrono::steady_clock::time_point due = chrono::steady_clock::now();
+        while (running) {
+            this_thread::sleep_until(due);
+            receiveInput();
+            stepDueNs = chrono::duration_cast<chrono::nanoseconds>(due.time_since_epoch()).count();
             
-            // Different colors for different types
-            switch(enemy.type) {
-                case 0: SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255); break;
-                case 1: SDL_SetRenderDrawColor(renderer, 255, 128, 0, 255); break;
-                case 2: SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255); break;
-                case 3: SDL_SetRenderDrawColor(renderer, 128, 255, 0, 255); break;
+            PROFILE_BEGIN_FRAME();
+            bool more = tick();
+            PROFILE_END_FRAME();
+            if (!more) {
+                running = false;
+                break;
             }
             
-            // Draw enemy body
-            SDL_Rect body = {(int)enemy.x, (int)enemy.y, ENEMY_WIDTH, ENEMY_HEIGHT};
-            SDL_RenderFillRect(renderer, &body);
+            if (ticksRun % SIM_STATS_INTERVAL == 0) {
+                for (int p = 0; p < 3; p++) {
+                    simStats[p] = profiler.stats((ProfilePhase)(PHASE_UPDATE_ENEMIES + p));
+                }
+                hasSimStats = true;
+            }
+            publishFrame(stepDueNs);
             
-            // Draw eyes
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_Rect eye1 = {(int)enemy.x + 8, (int)enemy.y + 10, 4, 4};
-            SDL_Rect eye2 = {(int)enemy.x + 18, (int)enemy.y + 10, 4, 4};
-            SDL_RenderFillRect(renderer, &eye1);
-            SDL_RenderFillRect(renderer, &eye2);
+            due += tickLength;
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            if (now - due > tickLength * MAX_LAG_TICKS) due = now;
         }
     }
     
-    void drawBullets() {
-        for (const auto& bullet : bullets) {
-            if (!bullet.active) continue;
-            
-            if (bullet.fromPlayer) {
-                SDL_SetRenderDrawColor(renderer, 0, 255, 255, 255);
-            } else {
-                SDL_SetRenderDrawColor(renderer, 255, 0, 255, 255);
+    // The simulation thread's job in a networked game: send the input to
+    // the server every tick, and publish each world as soon as it arrives
+    void netLoop() {
+        const chrono::nanoseconds tickLength(1000000000LL / SIM_TICKS_PER_SECOND);
+        const int MAX_LAG_TICKS = 5;
+        
+        chrono::steady_clock::time_point due = chrono::steady_clock::now();
+        while (running) {
+            if (net->waitForWorld(due)) {
+                net->fillFrame(frames.writeBuffer(), steadyNowNs());
+                frames.publish();
             }
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            if (now < due) continue;
+            
+            receiveInput();
+            InputBits inputs[MAX_PLAYERS] = {0};
+            nextStepInputs(inputs);
+            net->sendInput(inputs[0]);
             
-            SDL_Rect rect = {(int)bullet.x, (int)bullet.y, BULLET_WIDTH, BULLET_HEIGHT};
-            SDL_RenderFillRect(renderer, &rect);
+            due += tickLength;
+            if (now - due > tickLength * MAX_LAG_TICKS) due = now;
         }
     }
     
-    void drawUI() {
-        SDL_Color white = {255, 255, 255, 255};
-        SDL_Color yellow = {255, 255, 0, 255};
-        
-        // Draw lives text and count
-        string livesText = "Lives: " + to_string(player.lives);
-        renderText(livesText, 10, 10, white);
-        
-        // Draw score
-        string scoreText = "Score: " + to_string(score);
-        renderText(scoreText, SCREEN_WIDTH / 2 - 60, 10, white);
-        
-        // Draw level
-        string levelText = "Level: " + to_string(level);
-        renderText(levelText, SCREEN_WIDTH - 120, 10, yellow);
+    // Spawn effects for the events the simulation has sent, then move every
+    // particle on by `dt` seconds
+    void updateParticles(float dt) {
+        PROFILE_SCOPE(PHASE_PARTICLES);
+        GameEvent event;
+        while (particleFeed.pop(event)) particles.spawn(event);
+        particles.update(dt);
     }
     
-    void renderTextCentered(const string& text, int centerX, int y, SDL_Color color, TTF_Font* fontToUse = nullptr) {
-        if (fontToUse == nullptr) fontToUse = font;
-        if (!fontToUse) return;
-        
-        SDL_Surface* surface = TTF_RenderText_Solid(fontToUse, text.c_str(), color);
-        if (!surface) return;
-        
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-        if (!texture) {
-            SDL_FreeSurface(surface);
-            return;
+    // Read the finished frame back into a free capture buffer, or drop it
+    // if the writer is behind. Runs before present, while the back buffer
+    // still holds the frame.
+    void captureFrame() {
+        PROFILE_SCOPE(PHASE_CAPTURE);
+        uint8_t* pixels = capture->acquire();
+        if (!pixels) return;
+        if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA32, pixels, SCREEN_WIDTH * 4) == 0) {
+            capture->submit();
+        } else {
+            capture->abandon();
         }
-        
-        // Center the text
-        int textWidth = surface->w;
-        SDL_Rect destRect = {centerX - textWidth/2, y, surface->w, surface->h};
-        SDL_RenderCopy(renderer, texture, nullptr, &destRect);
-        
-        SDL_DestroyTexture(texture);
-        SDL_FreeSurface(surface);
     }
     
-    void drawLevelTransition() {
-        // Draw semi-transparent overlay
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
-        SDL_Rect overlay = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-        SDL_RenderFillRect(renderer, &overlay);
-        
-        // Draw box
-        SDL_SetRenderDrawColor(renderer, 0, 150, 255, 255);
-        SDL_Rect box = {SCREEN_WIDTH/2 - 200, SCREEN_HEIGHT/2 - 100, 400, 200};
-        SDL_RenderFillRect(renderer, &box);
-        
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_Rect innerBox = {SCREEN_WIDTH/2 - 195, SCREEN_HEIGHT/2 - 95, 390, 190};
-        SDL_RenderFillRect(renderer, &innerBox);
-        
-        // Draw text
-        SDL_Color white = {255, 255, 255, 255};
-        SDL_Color cyan = {0, 255, 255, 255};
-        
-        string levelText = "LEVEL " + to_string(level);
-        string patternText = "Pattern: ";
-        
-        switch(currentPattern) {
-            case PATTERN_CLASSIC: patternText += "Classic"; break;
-            case PATTERN_DIAMOND: patternText += "Diamond"; break;
-            case PATTERN_V_SHAPE: patternText += "V-Formation"; break;
-            case PATTERN_CIRCLE: patternText += "Circle"; break;
-            case PATTERN_WAVE: patternText += "Wave"; break;
-        }
-        
-        string readyText = "Press SPACE to continue";
-        
-        renderTextCentered(levelText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 60, cyan, largeFont);
-        renderTextCentered(patternText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 10, white);
-        renderTextCentered(readyText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 40, white);
+public:
+    SpaceInvaders(uint64_t seed, double fps, int playerCount = 1, int startLevel = 1,
+                  ReplayReader* replayIn = nullptr, ReplayWriter* recorderOut = nullptr,
+                  bool simThread = true, FrameCapture* captureOut = nullptr, NetClient* netClient = nullptr,
+                  GameEventSink* eventSink = nullptr)
+        : window(nullptr), renderer(nullptr), font(nullptr), largeFont(nullptr),
+          running(true), threaded(simThread || netClient), targetFps(fps), renderAlpha(1.0f), firePressed(false),
+          fireNs(0), moveNs(0), sentHeld(0), sentRewind(false), lateInput(true), measuredInputNs(0), inputQueue(256), sim(seed, playerCount), replay(replayIn), recorder(recorderOut),
+          history(REWIND_TICKS), ticksRun(0), heldInput(0), fireLatched(false),
+          fireLatchedNs(0), subframeShots(false), stepDueNs(0), pendingInputNs(0), appliedInputNs(0), rewinding(false),
+          hasSimStats(false), capture(captureOut), net(netClient), eventLog(eventSink),
+          eventTee(eventSink, &particleFeed), particlesOn(true), totalDrawCalls(0), framesDrawn(0), maxDrawCalls(0) {
+        sim.events = &eventTee;
+        if (startLevel > 1) sim.startAtLevel(startLevel);
+        for (int p = 0; p < 3; p++) simStats[p] = PhaseStats();
+        for (int i = 0; i < 3; i++) frames.buffer(i).capture(sim, ticksRun);
     }
     
-    void drawGameOver() {
-        // Draw semi-transparent overlay
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
-        SDL_Rect overlay = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
-        SDL_RenderFillRect(renderer, &overlay);
-        
-        // Draw box
-        SDL_Color boxColor = gameOver ? (SDL_Color){255, 0, 0, 255} : (SDL_Color){0, 255, 0, 255};
-        SDL_SetRenderDrawColor(renderer, boxColor.r, boxColor.g, boxColor.b, 255);
-        SDL_Rect box = {SCREEN_WIDTH/2 - 200, SCREEN_HEIGHT/2 - 120, 400, 240};
-        SDL_RenderFillRect(renderer, &box);
-        
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_Rect innerBox = {SCREEN_WIDTH/2 - 195, SCREEN_HEIGHT/2 - 115, 390, 230};
-        SDL_RenderFillRect(renderer, &innerBox);
-        
-        // Draw text
-        SDL_Color white = {255, 255, 255, 255};
-        SDL_Color bright = {255, 255, 100, 255};  // Brighter yellow for main text
-        string mainText = gameOver ? "GAME OVER!" : "LEVEL COMPLETE!";
-        string levelText = "Level Reached: " + to_string(level);
-        string scoreText = "Final Score: " + to_string(score);
-        string restartText = gameOver ? "Press SPACE to restart" : "Press SPACE for next level";
-        
-        // Use large font only for GAME OVER, regular font for LEVEL COMPLETE
-        TTF_Font* titleFont = gameOver ? largeFont : font;
-        renderTextCentered(mainText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 70, bright, titleFont);
-        renderTextCentered(levelText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 - 20, white);
-        renderTextCentered(scoreText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 10, white);
-        renderTextCentered(restartText, SCREEN_WIDTH/2, SCREEN_HEIGHT/2 + 60, white);
+    // `sampleLate`: read input through the pacer's wait, not only once a
+    // frame. `subframe`: time shots within the tick (not over the network,
+    // whose inputs carry only the basic bits).
+    void setInputTiming(bool sampleLate, bool subframe) {
+        lateInput = sampleLate;
+        subframeShots = subframe && !net;
     }
     
-public:
-    SpaceInvaders() : window(nullptr), renderer(nullptr), font(nullptr), largeFont(nullptr),
-                      running(true), player(SCREEN_WIDTH/2 - PLAYER_WIDTH/2, SCREEN_HEIGHT - 80),
-                      enemyDirection(1.0f), enemySpeed(0.5f), score(0), 
-                      frameCount(0), gameOver(false), victory(false),
-                      level(1), enemiesKilledThisLevel(0), levelTransition(false), 
-                      transitionTimer(0), currentPattern(PATTERN_CLASSIC) {
-        srand(time(NULL));
+    // Explosions and muzzle flashes on or off
+    void setParticles(bool on) {
+        particlesOn = on;
+        sim.events = on ? &eventTee : eventLog;
     }
     
     bool init() {
@@ -621,70 +516,142 @@ public:
         }
         
         // Try to load system fonts
-        const char* fontPaths[] = {
-            "/System/Library/Fonts/Helvetica.ttc",
-            "/System/Library/Fonts/Supplemental/Arial.ttf",
-            "/Library/Fonts/Arial.ttf",
-            "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
-        };
-        
-        for (const char* path : fontPaths) {
-            font = TTF_OpenFont(path, 24);
-            if (font) {
-                cout << "Font loaded: " << path << endl;
-                break;
-            }
+        const char* fontPath = nullptr;
+        font = openSystemFont(24, &fontPath);
+        if (font) {
+            cout << "Font loaded: " << fontPath << endl;
         }
+        largeFont = openSystemFont(48);
         
-        for (const char* path : fontPaths) {
-            largeFont = TTF_OpenFont(path, 48);
-            if (largeFont) break;
-        }
+        // Text is drawn from glyph atlases built once here
+        backend.setRenderer(renderer);
+        view.init(&backend, font, largeFont);
         
-        initEnemies();
-        levelTransition = true;  // Start with level intro
         cout << "Game initialized. Starting level 1..." << endl;
         return true;
     }
     
+    // Fixed-timestep loop: the simulation always advances in 1/60 s ticks,
+    // however long rendering takes, and frames are drawn interpolated
+    // between the last two ticks at whatever rate the pacer allows. The
+    // ticks run on the simulation thread, or inline here if threading is off.
     void run() {
-        cout << "Game running!" << endl;
+        cout << "Game running" << (threaded ? " (simulation thread)" : "") << "!" << endl;
+        
+        const int MAX_STEPS_PER_FRAME = 5;  // Don't spiral if a frame stalls
+        const double tickNs = 1e9 / SIM_TICKS_PER_SECOND;
+        Uint64 frequency = SDL_GetPerformanceFrequency();
+        Uint64 previous = SDL_GetPerformanceCounter();
+        Uint64 accumulator = 0;  // Elapsed time in units of 1/(frequency * tick rate) s
+        FramePacer pacer(targetFps);
+        Uint64 titleUpdated = previous;
+        Uint64 particlesUpdated = previous;
+        long long framesAtTitle = 0;
+        frameProfiler().setActive(true);
+        
+        if (threaded) simThread = thread(net ? &SpaceInvaders::netLoop : &SpaceInvaders::simLoop, this);
         
         while (running) {
-            handleInput();
+            PROFILE_BEGIN_FRAME();
+            Uint64 now = SDL_GetPerformanceCounter();
+            
+            pumpInput();
             
-            if (levelTransition) {
-                transitionTimer++;
-            } else if (!gameOver && !victory) {
-                updateEnemies();
-                updateBullets();
-                checkCollisions();
-                frameCount++;
+            if (threaded) {
+                frames.update();
+                double sinceTick = (double)(steadyNowNs() - frames.readBuffer().tickDueNs);
+                renderAlpha = (float)max(0.0, min(1.0, sinceTick / tickNs));
+            } else {
+                accumulator += (now - previous) * SIM_TICKS_PER_SECOND;
+                previous = now;
+                
+                int steps = 0;
+                while (accumulator >= frequency && steps < MAX_STEPS_PER_FRAME) {
+                    receiveInput();
+                    stepDueNs = steadyNowNs();
+                    if (!tick()) {
+                        running = false;
+                        break;
+                    }
+                    publishFrame(0);
+                    accumulator -= frequency;
+                    steps++;
+                }
+                if (accumulator >= frequency) accumulator %= frequency;
+                renderAlpha = (float)((double)accumulator / frequency);
+                frames.update();
             }
             
-            // Render
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
+            if (particlesOn) {
+                updateParticles(min(0.1f, (float)(now - particlesUpdated) / frequency));
+                particlesUpdated = now;
+            }
             
-            drawPlayer();
-            drawEnemies();
-            drawBullets();
-            drawUI();
+            // Render the newest snapshot
+            int drawCalls = view.drawFrame(frames.readBuffer(), renderAlpha, particlesOn ? &particles : nullptr);
+            if (capture) captureFrame();
+            {
+                PROFILE_SCOPE(PHASE_PRESENT);
+                SDL_RenderPresent(renderer);
+            }
             
-            if (levelTransition) {
-                drawLevelTransition();
-            } else if (gameOver || victory) {
-                drawGameOver();
+            // Input to present: once per tick that applied input, the first
+            // time a frame showing it is presented
+            int64_t inputNs = frames.readBuffer().inputNs;
+            if (inputNs != 0 && inputNs != measuredInputNs) {
+                latency.add(steadyNowNs() - inputNs);
+                measuredInputNs = inputNs;
             }
             
-            SDL_RenderPresent(renderer);
-            SDL_Delay(16); // ~60 FPS
+            totalDrawCalls += drawCalls;
+            framesDrawn++;
+            if (drawCalls > maxDrawCalls) maxDrawCalls = drawCalls;
+            
+            // Live frame rate and draw-call count, once a second
+            if (now - titleUpdated >= frequency) {
+                char title[128];
+                snprintf(title, sizeof(title), "Space Invaders - Multi-Level Edition (%lld fps, %d draw calls)",
+                         framesDrawn - framesAtTitle, drawCalls);
+                SDL_SetWindowTitle(window, title);
+                titleUpdated = now;
+                framesAtTitle = framesDrawn;
+            }
+            
+            {
+                PROFILE_SCOPE(PHASE_PACING);
+                if (lateInput) {
+                    pacer.wait([this] { pumpInput(); });
+                } else {
+                    pacer.wait();
+                }
+            }
+            PROFILE_END_FRAME();
         }
         
-        cout << "Game ended. Final score: " << score << " Level: " << level << endl;
+        if (simThread.joinable()) simThread.join();
+        
+        if (net) {
+            cout << "Game ended. Final score: " << frames.readBuffer().score
+                 << " Level: " << frames.readBuffer().level << endl;
+            net->printStats();
+        } else {
+            cout << "Game ended. Final score: " << sim.score << " Level: " << sim.level << endl;
+        }
+        if (framesDrawn > 0) {
+            cout << "Draw calls per frame: avg " << (double)totalDrawCalls / framesDrawn
+                 << ", max " << maxDrawCalls << " over " << framesDrawn << " frames" << endl;
+        }
+        if (particles.droppedParticles() > 0) {
+            cout << "Particles dropped at the " << particles.budget() << " budget: "
+                 << particles.droppedParticles() << endl;
+        }
+        if (latency.count() > 0) {
+            latency.print(cout, lateInput ? "Input to present" : "Input to present (input read once a frame)");
+        }
     }
     
     void cleanup() {
+        view.destroy();
         if (largeFont) TTF_CloseFont(largeFont);
         if (font) TTF_CloseFont(font);
         if (renderer) SDL_DestroyRenderer(renderer);
@@ -694,10 +661,667 @@ public:
     }
 };
 
+// Scripted input for headless runs: sweep left and right, firing steadily.
+// Fire also skips level intros and restarts after game over, so a long run
+// keeps cycling through levels without anyone at the keyboard. Each player
+// sweeps out of phase with the others.
+InputBits headlessInput(long long tick, int playerIndex) {
+    tick += playerIndex * 60;
+    InputBits input = ((tick / 120) & 1) ? INPUT_LEFT : INPUT_RIGHT;
+    if (tick % 8 == 0) input |= INPUT_FIRE;
+    return input;
+}
+
+// Draws simulation states on the CPU for headless runs: fonts, a
+// GameRenderer and a SoftRaster pointed at whatever buffer the caller has
+class HeadlessView {
+private:
+    bool ttf;
+    TTF_Font* font;
+    TTF_Font* largeFont;
+    SoftRaster raster;
+    GameRenderer view;
+    FrameSnapshot frame;
+    
+public:
+    HeadlessView() : ttf(TTF_Init() == 0), font(nullptr), largeFont(nullptr) {
+        if (ttf) {
+            font = openSystemFont(24);
+            largeFont = openSystemFont(48);
+        }
+        view.init(&raster, font, largeFont);
+    }
+    
+    ~HeadlessView() {
+        view.destroy();
+        if (largeFont) TTF_CloseFont(largeFont);
+        if (font) TTF_CloseFont(font);
+        if (ttf) TTF_Quit();
+    }
+    
+    // Draw `snapshot` (and `particles`, if given) into a tightly packed
+    // SCREEN_WIDTH x SCREEN_HEIGHT buffer
+    SoftRaster& draw(const FrameSnapshot& snapshot, uint8_t* pixels, RasterFormat format,
+                     ParticleSystem* particles = nullptr) {
+        raster.setTarget(pixels, SCREEN_WIDTH, SCREEN_HEIGHT,
+                         format == RASTER_GRAY8 ? SCREEN_WIDTH : SCREEN_WIDTH * 4, format);
+        view.drawFrame(snapshot, 1.0f, particles);
+        return raster;
+    }
+    
+    SoftRaster& draw(const Simulation& sim, long long tick, uint8_t* pixels, RasterFormat format,
+                     ParticleSystem* particles = nullptr) {
+        frame.capture(sim, tick);
+        return draw(frame, pixels, format, particles);
+    }
+};
+
+// Rasterize `frame` on the CPU and write it to `path`: grayscale PGM if the
+// name ends in .pgm, otherwise an RGB PPM. Needs no window.
+bool writeScreenshot(const FrameSnapshot& frame, const char* path) {
+    size_t length = strlen(path);
+    bool gray = length >= 4 && strcmp(path + length - 4, ".pgm") == 0;
+    RasterFormat format = gray ? RASTER_GRAY8 : RASTER_RGBA32;
+    vector<uint8_t> pixels(SoftRaster::bufferSize(SCREEN_WIDTH, SCREEN_HEIGHT, format));
+    HeadlessView view;
+    return view.draw(frame, pixels.data(), format).writePnm(path);
+}
+
+bool writeScreenshot(const Simulation& sim, long long tick, const char* path) {
+    FrameSnapshot frame;
+    frame.capture(sim, tick);
+    return writeScreenshot(frame, path);
+}
+
+// Step the simulation as fast as the CPU allows, with no SDL at all. With a
+// replay, its inputs drive every tick and the run lasts as long as it does.
+// A screenshot of the last tick is written to `screenshotPath` if given.
+// With `capture`, every tick is rasterized and recorded, effects included;
+// there is no frame deadline here, so the run waits for the writer rather
+// than dropping. Gameplay events go to `eventLog` if given.
+int runHeadless(long long frames, uint64_t seed, int playerCount, int startLevel,
+                ReplayReader* replay, ReplayWriter* recorder, const char* screenshotPath,
+                FrameCapture* capture, GameEventSink* eventLog) {
+    cout << "Headless run: " << frames << " frames, seed " << seed
+         << ", " << playerCount << " player(s), " << coordModeName(COORD_MODE) << " coordinates" << endl;
+    
+    // Captured frames show particles, advanced a tick at a time
+    ParticleFeed particleFeed;
+    GameEventTee eventTee(eventLog, &particleFeed);
+    ParticleSystem* particles = capture ? new ParticleSystem() : nullptr;
+    
+    Simulation sim(seed, playerCount);
+    sim.events = particles ? &eventTee : eventLog;
+    if (startLevel > 1) sim.startAtLevel(startLevel);
+    InputBits inputs[MAX_PLAYERS] = {0};
+    int gamesOver = 0;
+    int highestLevel = sim.level;
+    unsigned long long playAllocations = 0;  // Outside ticks that built a formation
+    
+    // Each tick is a profiler frame; the clock is only read when tracing
+    frameProfiler().setActive(!frameProfiler().traceFile().empty());
+    HeadlessView* captureView = capture ? new HeadlessView() : nullptr;
+    
+    auto start = chrono::steady_clock::now();
+    for (long long tick = 0; tick < frames; tick++) {
+        PROFILE_BEGIN_FRAME();
+        bool wasOver = sim.gameOver;
+        if (replay) {
+            if (!replay->next(inputs)) {
+                frames = tick;
+                break;
+            }
+        } else {
+            for (int p = 0; p < (int)sim.players.size(); p++) {
+                inputs[p] = headlessInput(tick, p);
+            }
+        }
+        long long formations = sim.formationsBuilt;
+        unsigned long long allocations = heapAllocationCount();
+        sim.step(inputs);
+        if (sim.formationsBuilt == formations) {
+            playAllocations += heapAllocationCount() - allocations;
+        }
+        if (recorder) recorder->record(inputs, sim);
+        if (replay && !replay->verify(sim)) {
+            reportDesync(*replay);
+            PROFILE_END_FRAME();
+            delete captureView;
+            delete particles;
+            return 1;
+        }
+        if (sim.gameOver && !wasOver) gamesOver++;
+        if (sim.level > highestLevel) highestLevel = sim.level;
+        if (captureView) {
+            {
+                PROFILE_SCOPE(PHASE_PARTICLES);
+                GameEvent event;
+                while (particleFeed.pop(event)) particles->spawn(event);
+                particles->update(1.0f / SIM_TICKS_PER_SECOND);
+            }
+            PROFILE_SCOPE(PHASE_CAPTURE);
+            captureView->draw(sim, tick + 1, capture->acquire(true), RASTER_RGBA32, particles);
+            capture->submit();
+        }
+        PROFILE_END_FRAME();
+    }
+    delete captureView;
+    delete particles;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    cout << "Stepped " << frames << " frames in " << seconds << " s ("
+         << (seconds > 0 ? frames / seconds : 0) << " frames/s)" << endl;
+    cout << "Games over: " << gamesOver << "  Highest level: " << highestLevel
+         << "  Final score: " << sim.score << " Level: " << sim.level << endl;
+    cout << "Heap allocations during play: " << playAllocations
+         << "  Dropped bullet spawns: " << sim.bullets.droppedSpawns() << endl;
+    
+    if (screenshotPath) {
+        if (!writeScreenshot(sim, frames, screenshotPath)) {
+            cerr << "Cannot write screenshot " << screenshotPath << endl;
+            return 1;
+        }
+        cout << "Screenshot: " << screenshotPath << endl;
+    }
+    return 0;
+}
+
+// Let the autopilot play until it has cleared `levels` levels (or `frames`
+// ticks pass), then report survival and score per level and pattern and how
+// long the simulation's ticks took. A game over is counted and play goes on
+// from the same level with fresh lives, so a run always gets through.
+int runAutopilot(int levels, long long frames, uint64_t seed, int playerCount, int startLevel,
+                 int threads, double thinkMs, int rollouts, GameEventSink* eventLog) {
+    struct LevelStats {
+        Pattern pattern;
+        int attempts, clears, livesLost;
+        long long score;
+        vector<float> stepUs;
+    };
+    struct PatternStats {
+        int attempts, clears;
+        long long score, ticks;
+    };
+    
+    Simulation sim(seed, playerCount);
+    sim.events = eventLog;
+    if (startLevel > 1) sim.startAtLevel(startLevel);
+    ThreadPool pool(threads);
+    Autopilot pilot(pool, sim, thinkMs, rollouts);
+    cout << "Autopilot: " << levels << " level(s), seed " << seed << ", " << sim.players.size()
+         << " player(s), " << pilot.threadCount() << " thread(s), ";
+    if (thinkMs > 0) cout << "up to " << rollouts << " rollouts in " << thinkMs << " ms per move" << endl;
+    else cout << rollouts << " rollouts per move" << endl;
+    
+    vector<LevelStats> byLevel;
+    PatternStats byPattern[PATTERN_COUNT] = {};
+    int cleared = 0, gamesOver = 0;
+    double thinkTotalMs = 0, thinkMaxMs = 0;
+    long long moves = 0;
+    bool wasPlaying = false;
+    long long tick = 0;
+    
+    auto start = chrono::steady_clock::now();
+    for (; tick < frames && cleared < levels; tick++) {
+        if (sim.gameOver) {
+            gamesOver++;
+            sim.restart(sim.level);
+            wasPlaying = false;
+            continue;
+        }
+        
+        InputBits inputs[MAX_PLAYERS] = {0};
+        bool playing = !sim.victory && !sim.levelTransition;
+        if (!playing) {
+            inputs[0] = INPUT_FIRE;  // Skip the level intro and result screens
+        } else {
+            auto thinkStart = chrono::steady_clock::now();
+            for (int p = 0; p < (int)sim.players.size(); p++) {
+                if (sim.players[p].active) inputs[p] = pilot.choose(sim, p);
+            }
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - thinkStart).count();
+            thinkTotalMs += ms;
+            thinkMaxMs = max(thinkMaxMs, ms);
+            moves++;
+        }
+        
+        int level = sim.level;
+        if ((int)byLevel.size() <= level) byLevel.resize(level + 1, LevelStats());
+        LevelStats& stats = byLevel[level];
+        PatternStats& pattern = byPattern[sim.currentPattern];
+        if (playing && !wasPlaying) {
+            stats.pattern = sim.currentPattern;
+            stats.attempts++;
+            pattern.attempts++;
+        }
+        wasPlaying = playing;
+        int score = sim.score;
+        int lives = 0;
+        for (const Player& player : sim.players) lives += player.lives;
+        
+        auto stepStart = chrono::steady_clock::now();
+        sim.step(inputs);
+        float us = chrono::duration<float, micro>(chrono::steady_clock::now() - stepStart).count();
+        if (!playing) continue;
+        
+        stats.stepUs.push_back(us);
+        stats.score += sim.score - score;
+        pattern.score += sim.score - score;
+        pattern.ticks++;
+        for (const Player& player : sim.players) lives -= player.lives;
+        stats.livesLost += lives;
+        if (sim.victory) {
+            stats.clears++;
+            pattern.clears++;
+            cleared++;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    
+    cout << "Cleared " << cleared << " level(s) in " << tick << " ticks (" << tick / SIM_TICKS_PER_SECOND
+         << " s of play, " << seconds << " s to run), " << gamesOver << " game(s) over" << endl;
+    if (moves > 0) {
+        cout << "Rollouts per move: " << pilot.rolloutsPerDecision() << "  Think time: avg "
+             << thinkTotalMs / moves << " ms, max " << thinkMaxMs << " ms" << endl;
+    }
+    
+    char line[160];
+    cout << "Level  Pattern      Tries  Clears  Lives lost  Score   Ticks  Step us: avg    p99    max" << endl;
+    for (size_t level = 0; level < byLevel.size(); level++) {
+        LevelStats& stats = byLevel[level];
+        if (stats.attempts == 0) continue;
+        vector<float>& us = stats.stepUs;
+        double total = 0;
+        for (float t : us) total += t;
+        sort(us.begin(), us.end());
+        snprintf(line, sizeof(line), "%5zu  %-11s %6d %7d %11d %6lld %7zu %13.2f %6.2f %6.2f",
+                 level, patternName(stats.pattern), stats.attempts, stats.clears, stats.livesLost,
+                 stats.score, us.size(), us.empty() ? 0 : total / us.size(),
+                 us.empty() ? 0 : us[min(us.size() - 1, us.size() * 99 / 100)], us.empty() ? 0 : us.back());
+        cout << line << endl;
+    }
+    
+    cout << "Pattern      Tries  Clears  Survival  Score  Score/min" << endl;
+    for (int p = 0; p < PATTERN_COUNT; p++) {
+        const PatternStats& stats = byPattern[p];
+        if (stats.attempts == 0) continue;
+        snprintf(line, sizeof(line), "%-11s %6d %7d %8.0f%% %6lld %10.0f", patternName((Pattern)p),
+                 stats.attempts, stats.clears, 100.0 * stats.clears / stats.attempts, stats.score,
+                 stats.ticks > 0 ? stats.score * 60.0 * SIM_TICKS_PER_SECOND / stats.ticks : 0);
+        cout << line << endl;
+    }
+    return 0;
+}
+
+// Host a networked co-op game on `port` until `frames` ticks have run or
+// every player has left
+int runServer(int port, long long frames, uint64_t seed, int playerCount, int startLevel,
+              GameEventSink* eventLog) {
+    NetServer server(seed, playerCount, startLevel, eventLog);
+    if (!server.open(port)) return 1;
+    cout << "Server on port " << port << ": seed " << seed << ", "
+         << server.simulation().players.size() << " player(s)" << endl;
+    server.run(frames);
+    return 0;
+}
+
+// A networked player with no window: the scripted input goes to the server
+// every tick for `frames` ticks, then the link's stats are reported. A
+// screenshot of the last world received is written to `screenshotPath`.
+int runHeadlessClient(NetClient& client, long long frames, const char* screenshotPath) {
+    const chrono::nanoseconds tickLength(1000000000LL / SIM_TICKS_PER_SECOND);
+    chrono::steady_clock::time_point due = chrono::steady_clock::now();
+    for (long long tick = 0; tick < frames; ) {
+        client.waitForWorld(due);
+        if (chrono::steady_clock::now() < due) continue;
+        client.sendInput(headlessInput(tick++, client.playerIndex()));
+        due += tickLength;
+    }
+    client.disconnect();
+    
+    if (client.hasWorld()) {
+        cout << "Final score: " << client.latest().score << " Level: " << client.latest().level << endl;
+    }
+    client.printStats();
+    
+    if (screenshotPath && client.hasWorld()) {
+        FrameSnapshot frame;
+        client.fillFrame(frame, 0);
+        if (!writeScreenshot(frame, screenshotPath)) {
+            cerr << "Cannot write screenshot " << screenshotPath << endl;
+            return 1;
+        }
+        cout << "Screenshot: " << screenshotPath << endl;
+    }
+    return 0;
+}
+
+// Exercise snapshots: every second of game time, save, play on for a
+// second, then load and play the same second again; both runs must end in
+// the same state hash. Also reports snapshot size and timings.
+int runRollbackCheck(long long frames, uint64_t seed, int playerCount) {
+    const int SPAN = SIM_TICKS_PER_SECOND;
+    cout << "Rollback check: " << frames << " frames, seed " << seed
+         << ", " << playerCount << " player(s)" << endl;
+    
+    Simulation sim(seed, playerCount);
+    InputBits inputs[MAX_PLAYERS] = {0};
+    vector<uint8_t> snapshot;
+    snapshot.reserve(64 * 1024);
+    long long checks = 0, mismatches = 0;
+    size_t largest = 0;
+    double saveNs = 0, loadNs = 0, hashNs = 0;
+    
+    auto playSpan = [&](long long from) {
+        for (long long tick = from; tick < from + SPAN; tick++) {
+            for (int p = 0; p < (int)sim.players.size(); p++) {
+                inputs[p] = headlessInput(tick, p);
+            }
+            sim.step(inputs);
+        }
+    };
+    
+    for (long long tick = 0; tick + SPAN <= frames; tick += SPAN) {
+        auto t0 = chrono::steady_clock::now();
+        sim.saveState(snapshot);
+        auto t1 = chrono::steady_clock::now();
+        playSpan(tick);
+        auto t2 = chrono::steady_clock::now();
+        uint64_t first = sim.stateHash();
+        auto t3 = chrono::steady_clock::now();
+        bool loaded = sim.loadState(snapshot);
+        auto t4 = chrono::steady_clock::now();
+        playSpan(tick);
+        
+        if (!loaded || sim.stateHash() != first) mismatches++;
+        checks++;
+        largest = max(largest, snapshot.size());
+        saveNs += chrono::duration<double, nano>(t1 - t0).count();
+        hashNs += chrono::duration<double, nano>(t3 - t2).count();
+        loadNs += chrono::duration<double, nano>(t4 - t3).count();
+    }
+    
+    cout << "Checks: " << checks << "  Mismatches: " << mismatches
+         << "  Largest snapshot: " << largest << " bytes" << endl;
+    if (checks > 0) {
+        cout << "Average ns: save " << saveNs / checks << ", load " << loadNs / checks
+             << ", hash " << hashNs / checks << endl;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Step `instances` games together for `ticks` ticks on the batch API, with
+// scripted players, and report throughput
+int runBatch(int instances, long long ticks, uint64_t seed, int playerCount, int threads) {
+    BatchSimulator batch(instances, seed, playerCount, threads);
+    cout << "Batch run: " << instances << " games x " << ticks << " ticks, "
+         << batch.playerCount() << " player(s) each, " << batch.threadCount() << " thread(s)" << endl;
+    
+    vector<InputBits> actions((size_t)instances * batch.playerCount());
+    vector<float> observations((size_t)instances * BatchSimulator::observationSize());
+    batch.observe(observations.data());
+    
+    unsigned long long allocationsBefore = heapAllocationCount();
+    auto start = chrono::steady_clock::now();
+    for (long long tick = 0; tick < ticks; tick++) {
+        for (int i = 0; i < instances; i++) {
+            for (int p = 0; p < batch.playerCount(); p++) {
+                // Offset each game's script so they don't move in lockstep
+                actions[(size_t)i * batch.playerCount() + p] = headlessInput(tick + i * 7, p);
+            }
+        }
+        batch.step(actions.data(), observations.data());
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    unsigned long long allocations = heapAllocationCount() - allocationsBefore;
+    
+    double gameTicks = (double)instances * ticks;
+    cout << "Stepped " << gameTicks << " game ticks in " << seconds << " s ("
+         << (seconds > 0 ? gameTicks / seconds : 0) << " ticks/s)" << endl;
+    cout << "Episodes finished: " << batch.episodesFinished() << " ("
+         << (seconds > 0 ? batch.episodesFinished() / seconds : 0) << " episodes/s)"
+         << "  Heap allocations while stepping: " << allocations << endl;
+    return 0;
+}
+
+// Write the trace if the run ended before the last traced frame
+void reportTrace() {
+    Profiler& profiler = frameProfiler();
+    if (profiler.traceFile().empty()) return;
+    profiler.writeTrace();
+    cout << "Trace: " << profiler.traceEventCount() << " events in " << profiler.traceFile() << endl;
+}
+
+// Flush the event log and say how much went into it
+void reportEvents(EventLog* events) {
+    if (!events) return;
+    events->close();
+    cout << "Logged " << events->eventsWritten() << " events to " << events->target()
+         << " (" << events->eventsDropped() << " dropped)" << endl;
+    if (events->writeFailed()) cerr << "Event log: write failed" << endl;
+}
+
+// Flush the capture writer and say where the frames went
+void reportCapture(FrameCapture* capture) {
+    if (!capture) return;
+    capture->close();
+    cout << "Captured " << capture->framesWritten() << " frames to " << capture->target()
+         << " (" << capture->framesDropped() << " dropped)" << endl;
+    if (capture->writeFailed()) cerr << "Capture: " << capture->lastError() << endl;
+}
+
 int main(int argc, char* argv[]) {
     cout << "=== Space Invaders - Multi-Level Edition ===" << endl;
     
-    SpaceInvaders game;
+    bool headless = false;
+    long long frames = 1000000;
+    double fps = 60;
+    int playerCount = 1;
+    uint64_t seed = (uint64_t)time(NULL);
+    int startLevel = 1;
+    int batchSize = 0;
+    bool checkRollback = false;
+    int threads = 0;
+    const char* tracePath = nullptr;
+    long long traceFirst = 0, traceLast = 599;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    int checkInterval = REPLAY_CHECK_INTERVAL;
+    bool simThread = true;
+    const char* screenshotPath = nullptr;
+    const char* capturePath = nullptr;
+    const char* eventsPath = nullptr;
+    int serverPort = 0;
+    const char* connectTo = nullptr;
+    bool playersSet = false;
+    bool frameInput = false;
+    int autopilotLevels = 0;
+    double thinkMs = 4;
+    int rollouts = 4096;
+    bool subframeShots = false;
+    bool particles = true;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            playerCount = atoi(argv[++i]);
+            playersSet = true;
+        } else if (strcmp(argv[i], "--check-rollback") == 0) {
+            checkRollback = true;
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            startLevel = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--check-interval") == 0 && i + 1 < argc) {
+            checkInterval = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc) {
+            screenshotPath = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            eventsPath = argv[++i];
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            serverPort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            connectTo = argv[++i];
+        } else if (strcmp(argv[i], "--autopilot") == 0 && i + 1 < argc) {
+            autopilotLevels = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--think-ms") == 0 && i + 1 < argc) {
+            thinkMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rollouts") == 0 && i + 1 < argc) {
+            rollouts = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--no-particles") == 0) {
+            particles = false;
+        } else if (strcmp(argv[i], "--frame-input") == 0) {
+            frameInput = true;
+        } else if (strcmp(argv[i], "--subframe-shots") == 0) {
+            subframeShots = true;
+        } else if (strcmp(argv[i], "--single-thread") == 0) {
+            simThread = false;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--trace-frames") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%lld:%lld", &traceFirst, &traceLast) == 2) {
+            i++;
+        } else {
+            cerr << "Usage: " << argv[0] << " [--headless] [--frames N] [--seed N] [--fps N]"
+                 << " [--players N] [--level N] [--batch N [--threads N]] [--record FILE [--check-interval N] | --replay FILE]"
+                 << " [--screenshot FILE] [--capture FILE] [--single-thread] [--trace FILE] [--trace-frames FIRST:LAST]"
+                 << " [--events FILE] [--server PORT | --connect [HOST:]PORT] [--frame-input] [--subframe-shots] [--no-particles]"
+                 << " [--autopilot LEVELS [--think-ms MS] [--rollouts N] [--threads N]]" << endl;
+            return 1;
+        }
+    }
+    
+    if (checkRollback) {
+        return runRollbackCheck(frames, seed, playerCount);
+    }
+    
+    if (batchSize > 0) {
+        return runBatch(batchSize, frames, seed, playerCount, threads);
+    }
+    
+    // Gameplay events from whichever process runs the simulation
+    EventLog events;
+    if (eventsPath) {
+        if (connectTo) {
+            cerr << "--events logs the simulation; give it to the server" << endl;
+            return 1;
+        }
+        if (!events.open(eventsPath)) {
+            cerr << "Event log: " << events.lastError() << endl;
+            return 1;
+        }
+    }
+    EventLog* eventLog = events.isOpen() ? &events : nullptr;
+    
+    if (autopilotLevels > 0) {
+        int result = runAutopilot(autopilotLevels, frames, seed, playerCount, startLevel, threads, thinkMs,
+                                  rollouts, eventLog);
+        reportEvents(eventLog);
+        return result;
+    }
+    
+    // Co-op means two players unless told otherwise
+    if (serverPort > 0) {
+        int result = runServer(serverPort, frames, seed, playersSet ? playerCount : 2, startLevel, eventLog);
+        reportEvents(eventLog);
+        return result;
+    }
+    
+    NetClient client;
+    NetClient* netClient = nullptr;
+    if (connectTo) {
+        NetAddress address;
+        if (!NetAddress::parse(connectTo, address)) {
+            cerr << "Cannot resolve " << connectTo << endl;
+            return 1;
+        }
+        if (replayPath || recordPath) {
+            cerr << "--record and --replay are for local games" << endl;
+            return 1;
+        }
+        if (!client.connect(address, 5000)) return 1;
+        cout << "Connected to " << address.toString() << " as player " << client.playerIndex() + 1
+             << " of " << client.playerCount() << endl;
+        if (headless) return runHeadlessClient(client, frames, screenshotPath);
+        netClient = &client;
+    }
+    
+    if (tracePath) {
+#ifdef SI_PROFILE
+        frameProfiler().traceFrames(tracePath, traceFirst, traceLast);
+#else
+        cerr << "--trace ignored: the profiler is compiled out of release builds" << endl;
+#endif
+    }
+    
+    // A replay fixes the seed, players and start level it was recorded with
+    ReplayReader replay;
+    ReplayWriter recorder;
+    if (replayPath) {
+        if (!replay.open(replayPath)) {
+            cerr << "Replay: " << replay.lastError() << endl;
+            return 1;
+        }
+        seed = replay.info().seed;
+        playerCount = replay.info().playerCount;
+        startLevel = replay.info().startLevel;
+        frames = (long long)replay.info().tickCount;
+        cout << "Replaying " << replayPath << ": " << frames << " ticks"
+             << (replay.hasChecks() ? "" : " (no state checks)") << endl;
+    } else if (recordPath) {
+        playerCount = max(1, min(playerCount, MAX_PLAYERS));
+        if (!headless) playerCount = 1;
+        if (!recorder.open(recordPath, seed, playerCount, max(1, startLevel), checkInterval)) {
+            cerr << "Cannot write replay " << recordPath << endl;
+            return 1;
+        }
+    }
+    ReplayReader* replayIn = replay.isOpen() ? &replay : nullptr;
+    ReplayWriter* recorderOut = recorder.isOpen() ? &recorder : nullptr;
+    
+    // Headless captures get one frame per tick; windowed ones one per present
+    FrameCapture capture;
+    if (capturePath) {
+        int captureFps = headless ? SIM_TICKS_PER_SECOND : (fps > 0 ? (int)(fps + 0.5) : 60);
+        if (!capture.open(capturePath, SCREEN_WIDTH, SCREEN_HEIGHT, captureFps)) {
+            cerr << "Capture: " << capture.lastError() << endl;
+            return 1;
+        }
+    }
+    FrameCapture* captureOut = capture.isOpen() ? &capture : nullptr;
+    
+    if (headless) {
+        int result = runHeadless(frames, seed, playerCount, startLevel, replayIn, recorderOut,
+                                 screenshotPath, captureOut, eventLog);
+        if (recorderOut) {
+            recorder.close();
+            cout << "Recorded " << recorder.ticks() << " ticks to " << recordPath << endl;
+        }
+        reportCapture(captureOut);
+        reportEvents(eventLog);
+        reportTrace();
+        return result;
+    }
+    
+    SpaceInvaders game(seed, fps, replayIn ? playerCount : 1, startLevel, replayIn, recorderOut,
+                       simThread, captureOut, netClient, eventLog);
+    game.setInputTiming(!frameInput, subframeShots);
+    game.setParticles(particles);
     
     if (!game.init()) {
         cerr << "Failed to initialize game!" << endl;
@@ -706,6 +1330,14 @@ int main(int argc, char* argv[]) {
     
     game.run();
     game.cleanup();
+    if (netClient) client.disconnect();
+    if (recorderOut) {
+        recorder.close();
+        cout << "Recorded " << recorder.ticks() << " ticks to " << recordPath << endl;
+    }
+    reportCapture(captureOut);
+    reportEvents(eventLog);
+    reportTrace();
     
     cout << "Thanks for playing!" << endl;
     return 0;
@@ -0,0 +1,150 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+// Entity sprites, rasterized once into a single atlas at startup: every
+// enemy type in each animation frame, the player ship, both kinds of
+// bullet and two white particle dots (tinted per particle). Entities are
+// queued as quads and drawn in one drawQuads call per frame, however many
+// there are and whatever colour they are. The art is
+// drawn here from rectangles with SoftRaster; replacing it with real pixel
+// art only means filling the same cells differently.
+
+#include <SDL.h>
+#include <vector>
+#include "game_types.h"
+#include "render_backend.h"
+#include "soft_raster.h"
+#include "texture_atlas.h"
+
+class SpriteAtlas : public TextureAtlas {
+public:
+    static const int ENEMY_TYPES = 4;
+    static const int ENEMY_FRAMES = 2;     // Animation frames per enemy type
+
+    enum Sprite {
+        SPRITE_PLAYER,
+        SPRITE_PLAYER_BULLET,
+        SPRITE_ENEMY_BULLET,
+        SPRITE_SPARK,                      // 2x2 particle
+        SPRITE_DEBRIS,                     // 3x3 particle
+        SPRITE_ENEMY,                      // ENEMY_TYPES x ENEMY_FRAMES, by type then frame
+        SPRITE_COUNT = SPRITE_ENEMY + ENEMY_TYPES * ENEMY_FRAMES
+    };
+
+private:
+    static const int ATLAS_WIDTH = 256;
+    static const int ATLAS_HEIGHT = 64;
+    static const int CELL = 32;            // Enemy cell pitch; sprites keep a 1px gap
+    static const int MAX_QUADS = 1024;     // Per flush before the buffer grows
+
+    SDL_Rect cells[SPRITE_COUNT];
+    std::vector<AtlasQuad> quads;          // Pending sprites, reused every flush
+
+    void place(Sprite sprite, int x, int y, int w, int h) {
+        SDL_Rect cell = {x, y, w, h};
+        cells[sprite] = cell;
+    }
+
+    // Fill `rect` of `sprite`, in sprite coordinates
+    void paint(SoftRaster& raster, Sprite sprite, SDL_Color color, int x, int y, int w, int h) {
+        SDL_Rect rect = {cells[sprite].x + x, cells[sprite].y + y, w, h};
+        raster.fillRects(color, &rect, 1);
+    }
+
+public:
+    SpriteAtlas() {
+        for (int i = 0; i < SPRITE_COUNT; i++) place((Sprite)i, 0, 0, 0, 0);
+    }
+
+    static SDL_Color enemyColor(int type) {
+        static const SDL_Color typeColors[ENEMY_TYPES] = {
+            {255, 0, 0, 255}, {255, 128, 0, 255}, {255, 255, 0, 255}, {128, 255, 0, 255}
+        };
+        return typeColors[type & 3];
+    }
+
+    static Sprite enemySprite(int type, int frame) {
+        return (Sprite)(SPRITE_ENEMY + (type & 3) * ENEMY_FRAMES + frame % ENEMY_FRAMES);
+    }
+
+    // Lay out the cells and draw every sprite into them
+    bool build() {
+        destroy();
+        if (!createSurface(ATLAS_WIDTH, ATLAS_HEIGHT)) return false;
+
+        for (int type = 0; type < ENEMY_TYPES; type++) {
+            for (int frame = 0; frame < ENEMY_FRAMES; frame++) {
+                int cell = type * ENEMY_FRAMES + frame;
+                place(enemySprite(type, frame), cell * CELL, 0, ENEMY_WIDTH, ENEMY_HEIGHT);
+            }
+        }
+        place(SPRITE_PLAYER, 0, CELL, PLAYER_WIDTH, PLAYER_HEIGHT);
+        place(SPRITE_PLAYER_BULLET, PLAYER_WIDTH + 8, CELL, BULLET_WIDTH, BULLET_HEIGHT);
+        place(SPRITE_ENEMY_BULLET, PLAYER_WIDTH + 16, CELL, BULLET_WIDTH, BULLET_HEIGHT);
+        place(SPRITE_SPARK, PLAYER_WIDTH + 24, CELL, 2, 2);
+        place(SPRITE_DEBRIS, PLAYER_WIDTH + 32, CELL, 3, 3);
+
+        SoftRaster raster(surface->pixels, surface->w, surface->h, surface->pitch, RASTER_RGBA32);
+
+        // Enemies: a body in the type's colour with two eyes. Frame 0 is a
+        // solid block; frame 1 stands on three legs.
+        SDL_Color black = {0, 0, 0, 255};
+        for (int type = 0; type < ENEMY_TYPES; type++) {
+            Sprite still = enemySprite(type, 0), walking = enemySprite(type, 1);
+            paint(raster, still, enemyColor(type), 0, 0, ENEMY_WIDTH, ENEMY_HEIGHT);
+            paint(raster, walking, enemyColor(type), 0, 0, ENEMY_WIDTH, ENEMY_HEIGHT - 4);
+            for (int leg = 0; leg < 3; leg++) {
+                paint(raster, walking, enemyColor(type), 2 + leg * 10, ENEMY_HEIGHT - 4, 6, 4);
+            }
+            for (int frame = 0; frame < ENEMY_FRAMES; frame++) {
+                paint(raster, enemySprite(type, frame), black, 8, 10, 4, 4);
+                paint(raster, enemySprite(type, frame), black, 18, 10, 4, 4);
+            }
+        }
+
+        // Player: a hull with a cockpit on top
+        SDL_Color green = {0, 255, 0, 255};
+        paint(raster, SPRITE_PLAYER, green, 0, 10, PLAYER_WIDTH, 20);
+        paint(raster, SPRITE_PLAYER, green, 15, 0, 10, 15);
+
+        SDL_Color cyan = {0, 255, 255, 255};
+        SDL_Color magenta = {255, 0, 255, 255};
+        paint(raster, SPRITE_PLAYER_BULLET, cyan, 0, 0, BULLET_WIDTH, BULLET_HEIGHT);
+        paint(raster, SPRITE_ENEMY_BULLET, magenta, 0, 0, BULLET_WIDTH, BULLET_HEIGHT);
+        SDL_Color white = {255, 255, 255, 255};
+        paint(raster, SPRITE_SPARK, white, 0, 0, 2, 2);
+        paint(raster, SPRITE_DEBRIS, white, 0, 0, 3, 3);
+
+        indexOpaque();
+        quads.reserve(MAX_QUADS);
+        return true;
+    }
+
+    void destroy() {
+        release();
+        quads.clear();
+    }
+
+    // Queue `sprite` with its top-left corner at (x, y); drawn on the next flush()
+    void queue(Sprite sprite, int x, int y) {
+        SDL_Color white = {255, 255, 255, 255};
+        AtlasQuad quad = {cells[sprite], x, y, white};
+        quads.push_back(quad);
+    }
+
+    // Where `sprite` is in the atlas, for callers building their own quads
+    const SDL_Rect& cell(Sprite sprite) const { return cells[sprite]; }
+
+    // Submit all queued sprites in a single draw call. Returns draw calls issued.
+    int flush(RenderBackend& backend) {
+        if (quads.empty() || !surface) {
+            quads.clear();
+            return 0;
+        }
+        backend.drawQuads(*this, quads.data(), (int)quads.size());
+        quads.clear();
+        return 1;
+    }
+};
+
+#endif
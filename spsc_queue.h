@@ -0,0 +1,56 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Fixed storage, no allocation after construction; push() fails
+// rather than blocking when the queue is full.
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class SpscQueue {
+private:
+    std::vector<T> items;
+    size_t mask;                      // Capacity - 1 (capacity is a power of two)
+    char padHead[64];                 // Keep the two ends on separate cache lines
+    std::atomic<size_t> head;         // Next slot to pop; written by the consumer
+    char padTail[64];
+    std::atomic<size_t> tail;         // Next slot to push; written by the producer
+
+public:
+    // Rounds `capacity` up to a power of two
+    explicit SpscQueue(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        items.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const { return items.size(); }
+
+    // Producer
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == items.size()) return false;
+        items[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif
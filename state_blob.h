@@ -0,0 +1,168 @@
+#ifndef STATE_BLOB_H
+#define STATE_BLOB_H
+
+// Helpers for Simulation::saveState/loadState. The simulation lists its
+// fields once, in serializeState(), against a "sink" with write(ptr, bytes);
+// the same list then measures (StateSizer), copies (StateWriter) or hashes
+// (StateHasher) the state. StateReader walks a blob back in the same order.
+//
+// Blobs are flat native-endian memory meant for in-process snapshots
+// (rewind, rollback, search), not for files or the network: they are only
+// valid for the build that wrote them. The version word carries the
+// coordinate mode (COORD_MODE) in its high half, so float and fixed-point
+// builds refuse each other's blobs. Replay files never store blobs or their
+// hashes; their checks come from Simulation::checkHash(), whose field list
+// is versioned separately by CHECK_VERSION.
+
+#include <cstdint>
+#include <cstring>
+
+const uint32_t STATE_MAGIC = 0x54534953;  // "SIST"
+const uint32_t STATE_VERSION = 5;
+const uint32_t CHECK_VERSION = 2;         // Fields in Simulation::checkHash()
+
+struct StateSizer {
+    size_t size;
+    StateSizer() : size(0) {}
+    void write(const void*, size_t bytes) { size += bytes; }
+};
+
+// Copies into a caller buffer; `overflow` is set if it was too small
+struct StateWriter {
+    uint8_t* out;
+    size_t capacity;
+    size_t size;
+    bool overflow;
+
+    StateWriter(uint8_t* buffer, size_t bytes) : out(buffer), capacity(bytes), size(0), overflow(false) {}
+
+    void write(const void* data, size_t bytes) {
+        if (size + bytes > capacity) {
+            overflow = true;
+            return;
+        }
+        memcpy(out + size, data, bytes);
+        size += bytes;
+    }
+};
+
+struct StateReader {
+    const uint8_t* in;
+    size_t size;
+    size_t offset;
+    bool underflow;
+
+    StateReader(const uint8_t* data, size_t bytes) : in(data), size(bytes), offset(0), underflow(false) {}
+
+    bool read(void* data, size_t bytes) {
+        if (underflow || offset + bytes > size) {
+            underflow = true;
+            return false;
+        }
+        memcpy(data, in + offset, bytes);
+        offset += bytes;
+        return true;
+    }
+
+    // Point at `bytes` of the blob in place, or null if it is too short
+    const uint8_t* view(size_t bytes) {
+        if (underflow || offset + bytes > size) {
+            underflow = true;
+            return nullptr;
+        }
+        const uint8_t* p = in + offset;
+        offset += bytes;
+        return p;
+    }
+
+    template <typename T>
+    T get() {
+        T value = T();
+        read(&value, sizeof(T));
+        return value;
+    }
+};
+
+// 64-bit hash of the written bytes. Not cryptographic; meant for quick
+// equality checks between states, cheap enough to run every tick. Writes
+// are gathered in a small buffer, since most are a few bytes, and hashed a
+// buffer at a time: 32 bytes per step as four words, each mixed into its
+// own lane so the lanes' multiplies overlap. The lanes are combined at the
+// end.
+class StateHasher {
+private:
+    static const size_t BUFFER = 1024;    // A multiple of 32
+
+    uint64_t lanes[4];
+    uint64_t total;                       // Bytes hashed out of the buffer
+    size_t buffered;
+    uint8_t buffer[BUFFER];
+
+    static uint64_t mix(uint64_t h, uint64_t word) {
+        h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 29);
+    }
+
+    // Fold whole 32-byte steps of `p` into `h`
+    static void hashBlocks(uint64_t* h, const uint8_t* p, size_t bytes) {
+        uint64_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (; bytes >= 32; bytes -= 32, p += 32) {
+            uint64_t w[4];
+            memcpy(w, p, 32);
+            a = mix(a, w[0]);
+            b = mix(b, w[1]);
+            c = mix(c, w[2]);
+            d = mix(d, w[3]);
+        }
+        h[0] = a; h[1] = b; h[2] = c; h[3] = d;
+    }
+
+    // Separate from write() so the common case inlines to a fixed-size copy
+    void spill(const uint8_t* p, size_t bytes) {
+        while (buffered + bytes > BUFFER) {
+            size_t take = BUFFER - buffered;
+            memcpy(buffer + buffered, p, take);
+            hashBlocks(lanes, buffer, BUFFER);
+            total += BUFFER;
+            buffered = 0;
+            p += take;
+            bytes -= take;
+        }
+        memcpy(buffer + buffered, p, bytes);
+        buffered += bytes;
+    }
+
+public:
+    StateHasher() : total(0), buffered(0) {
+        lanes[0] = 0x243F6A8885A308D3ULL;
+        lanes[1] = 0x13198A2E03707344ULL;
+        lanes[2] = 0xA4093822299F31D0ULL;
+        lanes[3] = 0x082EFA98EC4E6C89ULL;
+    }
+
+    void write(const void* data, size_t bytes) {
+        if (buffered + bytes > BUFFER) {
+            spill((const uint8_t*)data, bytes);
+            return;
+        }
+        memcpy(buffer + buffered, data, bytes);
+        buffered += bytes;
+    }
+
+    uint64_t finish() const {
+        uint64_t h[4] = {lanes[0], lanes[1], lanes[2], lanes[3]};
+        size_t whole = buffered & ~(size_t)31;
+        hashBlocks(h, buffer, whole);
+        uint8_t tail[32] = {0};
+        memcpy(tail, buffer + whole, buffered - whole);
+        hashBlocks(h, tail, 32);
+
+        uint64_t z = total + buffered;
+        for (int k = 0; k < 4; k++) z = mix(z, h[k]);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif
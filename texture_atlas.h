@@ -0,0 +1,90 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+// Pixels that RenderBackend::drawQuads draws from: one RGBA32 surface,
+// uploaded as a texture the first time an SDL_Renderer draws it. GlyphAtlas
+// (text) and SpriteAtlas (entities) fill it in.
+//
+// Atlases of opaque art can also be indexed for the software rasterizer: for
+// every texel, how many opaque texels start there on its row, and its luma.
+// A quad row that is opaque throughout is then a plain copy.
+
+#include <SDL.h>
+#include <cstdint>
+#include <vector>
+
+class TextureAtlas {
+protected:
+    SDL_Surface* surface;                // RGBA32 texels
+    SDL_Texture* texture;                // Uploaded copy, for textureFor()
+    SDL_Renderer* textureRenderer;       // Renderer that owns `texture`
+    std::vector<uint16_t> opaqueRuns;    // Per texel, if indexed: opaque texels from here to the right
+    std::vector<uint8_t> lumaTexels;     // Per texel, if indexed: BT.601 luma
+
+    // Replace the surface with a blank (transparent) w x h one
+    bool createSurface(int w, int h) {
+        release();
+        surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (surface) SDL_FillRect(surface, nullptr, 0);
+        return surface != nullptr;
+    }
+
+    // Build the opaque-run and luma index from the surface's texels
+    void indexOpaque() {
+        int w = surface->w, h = surface->h;
+        opaqueRuns.assign((size_t)w * h, 0);
+        lumaTexels.assign((size_t)w * h, 0);
+        for (int y = 0; y < h; y++) {
+            const uint8_t* texel = (const uint8_t*)surface->pixels + (size_t)y * surface->pitch;
+            uint16_t* runs = &opaqueRuns[(size_t)y * w];
+            uint8_t* luma = &lumaTexels[(size_t)y * w];
+            uint16_t run = 0;
+            for (int x = w - 1; x >= 0; x--) {
+                const uint8_t* t = texel + x * 4;
+                run = t[3] == 255 ? (uint16_t)(run + 1) : 0;
+                runs[x] = run;
+                luma[x] = (uint8_t)((t[0] * 77 + t[1] * 150 + t[2] * 29) >> 8);
+            }
+        }
+    }
+
+    void release() {
+        if (texture) SDL_DestroyTexture(texture);
+        if (surface) SDL_FreeSurface(surface);
+        texture = nullptr;
+        textureRenderer = nullptr;
+        surface = nullptr;
+        opaqueRuns.clear();
+        lumaTexels.clear();
+    }
+
+public:
+    TextureAtlas() : surface(nullptr), texture(nullptr), textureRenderer(nullptr) {}
+    virtual ~TextureAtlas() { release(); }
+
+    bool ready() const { return surface != nullptr; }
+
+    // The texels, RGBA32
+    const SDL_Surface* pixels() const { return surface; }
+
+    // The atlas as a texture of `renderer`, uploaded on first use
+    SDL_Texture* textureFor(SDL_Renderer* renderer) {
+        if (!surface) return nullptr;
+        if (texture && textureRenderer == renderer) return texture;
+        if (texture) SDL_DestroyTexture(texture);
+        texture = SDL_CreateTextureFromSurface(renderer, surface);
+        textureRenderer = texture ? renderer : nullptr;
+        if (texture) SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        return texture;
+    }
+
+    // Opaque texels from (x, y) rightwards; 0 if the atlas is not indexed
+    int opaqueRun(int x, int y) const {
+        return opaqueRuns.empty() ? 0 : opaqueRuns[(size_t)y * surface->w + x];
+    }
+
+    // Luma of the texels from (x, y) rightwards; only valid if indexed
+    const uint8_t* lumaRow(int x, int y) const { return &lumaTexels[(size_t)y * surface->w + x]; }
+};
+
+#endif
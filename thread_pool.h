@@ -0,0 +1,223 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// Fixed set of worker threads for data-parallel loops. parallelFor() splits
+// [0, count) into chunks that the workers and the calling thread claim from
+// a shared counter until none are left, then returns. stealingFor() instead
+// gives each thread its own share of the indices to work through, and a
+// thread that runs out steals half of what another has left, for tasks
+// whose cost varies a lot. Workers sleep on a condition variable between
+// calls.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+    // One thread's unclaimed indices for stealingFor(), begin << 32 | end,
+    // padded so each sits on its own cache line. The owner takes from the
+    // front and thieves split off the back, both by compare-and-swap.
+    struct StealRange {
+        std::atomic<uint64_t> range;
+        char pad[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;       // Workers wait here for a new job
+    std::condition_variable finished;   // parallelFor waits here for workers
+
+    // The current job, type-erased; only changed while no worker is inside it
+    void (*invoke)(void* fn, int begin, int end);
+    void (*invokeTask)(void* fn, int thread, int index);  // Set for stealingFor() jobs
+    void* jobFn;
+    int jobCount;
+    int chunkSize;
+    std::atomic<int> nextIndex;
+    long long generation;               // Bumped for every job
+    int busyWorkers;
+    bool stopping;
+    std::unique_ptr<StealRange[]> ranges;  // One per thread, the caller first
+
+    static uint64_t packRange(uint32_t begin, uint32_t end) { return (uint64_t)begin << 32 | end; }
+
+    // Take the first index of `thread`'s own range
+    bool takeOwn(int thread, int& index) {
+        std::atomic<uint64_t>& slot = ranges[thread].range;
+        uint64_t range = slot.load();
+        for (;;) {
+            uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+            if (begin >= end) return false;
+            if (slot.compare_exchange_weak(range, packRange(begin + 1, end))) {
+                index = (int)begin;
+                return true;
+            }
+        }
+    }
+
+    // Move the back half of some other thread's range into `thread`'s.
+    // False once every range is empty.
+    bool steal(int thread) {
+        int threads = threadCount();
+        for (int offset = 1; offset < threads; offset++) {
+            std::atomic<uint64_t>& victim = ranges[(thread + offset) % threads].range;
+            uint64_t range = victim.load();
+            for (;;) {
+                uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+                if (begin >= end) break;
+                uint32_t split = end - (end - begin + 1) / 2;
+                if (victim.compare_exchange_weak(range, packRange(begin, split))) {
+                    ranges[thread].range.store(packRange(split, end));
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Work through the current job as `thread`
+    void runJob(int thread) {
+        if (!invokeTask) {
+            runChunks();
+            return;
+        }
+        for (;;) {
+            int index;
+            if (takeOwn(thread, index)) {
+                invokeTask(jobFn, thread, index);
+            } else if (!steal(thread)) {
+                break;
+            }
+        }
+    }
+
+    // Claim chunks of the current job until it is exhausted
+    void runChunks() {
+        while (true) {
+            int begin = nextIndex.fetch_add(chunkSize);
+            if (begin >= jobCount) break;
+            invoke(jobFn, begin, std::min(begin + chunkSize, jobCount));
+        }
+    }
+
+    void workerLoop(int thread) {
+        long long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            lock.unlock();
+            runJob(thread);
+            lock.lock();
+            if (--busyWorkers == 0) finished.notify_one();
+        }
+    }
+
+public:
+    // `threads` counts the calling thread; 0 uses every hardware thread
+    explicit ThreadPool(int threads = 0)
+        : invoke(nullptr), invokeTask(nullptr), jobFn(nullptr), jobCount(0), chunkSize(1), nextIndex(0),
+          generation(0), busyWorkers(0), stopping(false) {
+        if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        ranges.reset(new StealRange[threads]);
+        for (int i = 0; i < threads; i++) ranges[i].range.store(0);
+        for (int i = 1; i < threads; i++) {
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    int threadCount() const { return (int)workers.size() + 1; }
+
+    template <typename Fn>
+    static void invokeAs(void* fn, int begin, int end) {
+        (*(Fn*)fn)(begin, end);
+    }
+
+    template <typename Fn>
+    static void invokeTaskAs(void* fn, int thread, int index) {
+        (*(Fn*)fn)(thread, index);
+    }
+
+    // Call fn(begin, end) over chunks covering [0, count), in parallel, and
+    // return when all are done. Chunks default to a few per thread. Does
+    // not allocate.
+    template <typename Fn>
+    void parallelFor(int count, Fn fn, int chunk = 0) {
+        if (count <= 0) return;
+        if (chunk <= 0) chunk = std::max(1, count / (threadCount() * 4));
+        if (workers.empty() || count <= chunk) {
+            fn(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            invoke = &ThreadPool::invokeAs<Fn>;
+            invokeTask = nullptr;
+            jobFn = &fn;
+            jobCount = count;
+            chunkSize = chunk;
+            nextIndex.store(0);
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&]() { return busyWorkers == 0; });
+    }
+
+    // Call fn(thread, i) for every i in [0, count), in parallel, and return
+    // when all are done. `thread` is 0 for the calling thread and below
+    // threadCount() for the rest, for per-thread scratch space. Each thread
+    // starts on an equal contiguous share and steals when it runs dry. Does
+    // not allocate.
+    template <typename Fn>
+    void stealingFor(int count, Fn fn) {
+        if (count <= 0) return;
+        if (workers.empty()) {
+            for (int i = 0; i < count; i++) fn(0, i);
+            return;
+        }
+
+        int threads = threadCount();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int t = 0; t < threads; t++) {
+                uint32_t begin = (uint32_t)((long long)count * t / threads);
+                uint32_t end = (uint32_t)((long long)count * (t + 1) / threads);
+                ranges[t].range.store(packRange(begin, end));
+            }
+            invokeTask = &ThreadPool::invokeTaskAs<Fn>;
+            jobFn = &fn;
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        runJob(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&]() { return busyWorkers == 0; });
+    }
+};
+
+#endif
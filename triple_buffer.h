@@ -0,0 +1,56 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// Lock-free triple buffer for handing whole values from one producer thread
+// to one consumer thread. The producer fills its back buffer and publishes
+// it; the consumer picks up the newest published buffer whenever it likes.
+// Neither side ever waits: the producer never overwrites what the consumer
+// is reading, and the consumer only ever sees complete values (older ones
+// are skipped if it falls behind).
+//
+// The three buffers rotate roles by swapping indices, so a published value
+// is never copied.
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer {
+private:
+    static const uint8_t FRESH = 4;  // Set on `middle` when it holds an unread value
+
+    T buffers[3];
+    int back;                        // Producer's buffer
+    int front;                       // Consumer's buffer
+    std::atomic<uint8_t> middle;     // Index of the spare buffer | FRESH
+
+public:
+    TripleBuffer() : back(0), front(1), middle(2) {}
+
+    // Producer: the buffer to fill next. Its old contents are whatever was
+    // published two or more rounds ago.
+    T& writeBuffer() { return buffers[back]; }
+
+    // Producer: hand the filled buffer to the consumer
+    void publish() {
+        uint8_t previous = middle.exchange((uint8_t)(back | FRESH), std::memory_order_acq_rel);
+        back = previous & 3;
+    }
+
+    // Consumer: switch to the newest published value, if there is one.
+    // Returns true when readBuffer() changed.
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        uint8_t previous = middle.exchange((uint8_t)front, std::memory_order_acq_rel);
+        front = previous & 3;
+        return true;
+    }
+
+    // Consumer: the newest value picked up by update()
+    const T& readBuffer() const { return buffers[front]; }
+
+    // Direct access for setup before either thread starts
+    T& buffer(int i) { return buffers[i]; }
+};
+
+#endif